@@ -1,8 +1,10 @@
 
 #pragma once
 #include <ul/ul_Include.hpp>
+#include <array>
 #include <ul/fs/fs_Stdio.hpp>
 #include <ul/loader/loader_TargetTypes.hpp>
+#include <ul/menu/menu_Cache.hpp>
 #include <ul/util/util_String.hpp>
 #include <ul/util/util_Json.hpp>
 
@@ -19,6 +21,8 @@ namespace ul::cfg {
     struct Theme {
         std::string name;
         ThemeManifest manifest;
+        // Cached preview icon, only filled by FindThemes (empty if the theme has no icon)
+        std::string icon_path;
 
         inline bool IsValid() const {
             return !this->name.empty();
@@ -36,9 +40,15 @@ namespace ul::cfg {
         HomebrewApplicationTakeoverApplicationId,
         ViewerUsbEnabled,
         ActiveThemeName,
-        MenuEntryHeightCount
+        MenuEntryHeightCount,
+        CacheWorkerCount,
+        CacheBudgetSize,
+
+        Count
     };
 
+    constexpr size_t ConfigEntryCount = static_cast<size_t>(ConfigEntryId::Count);
+
     enum class ConfigEntryType : u8 {
         Bool,
         U64,
@@ -52,231 +62,238 @@ namespace ul::cfg {
         u8 pad;
     };
 
-    struct ConfigEntry {
-        ConfigEntryHeader header;
-        bool bool_value;
-        u64 u64_value;
-        std::string str_value;
+    // Every entry is described (type, default value, bounds) by a single schema table, indexed by entry ID
+    // Values are stored in a fixed array following it, thus typed access is just an index lookup (and unknown IDs or mismatching types fail to compile)
 
-        template<typename T>
-        inline bool Get(T &out_t) const {
-            switch(this->header.type) {
-                case ConfigEntryType::Bool: {
-                    if constexpr(std::is_same_v<T, bool>) {
-                        out_t = this->bool_value;
-                        return true;
-                    }
-                    else {
-                        return false;
-                    }
-                }
-                case ConfigEntryType::U64: {
-                    if constexpr(std::is_same_v<T, u64>) {
-                        out_t = this->u64_value;
-                        return true;
-                    }
-                    else {
-                        return false;
-                    }
-                }
-                case ConfigEntryType::String: {
-                    if constexpr(std::is_same_v<T, std::string>) {
-                        out_t = this->str_value;
-                        return true;
-                    }
-                    else {
-                        return false;
-                    }
-                }
-            }
+    // String sizes must fit in ConfigEntryHeader::size
+    constexpr size_t ConfigEntryMaxStringLength = 0xFF;
+
+    struct ConfigEntrySchema {
+        ConfigEntryId id;
+        ConfigEntryType type;
+        bool default_bool;
+        u64 default_u64;
+        const char *default_str;
+        // Inclusive value bounds for U64 entries, maximum length for String entries
+        u64 min_u64;
+        u64 max_u64;
+    };
+
+    constexpr ConfigEntrySchema MakeBoolConfigEntrySchema(const ConfigEntryId id, const bool default_val) {
+        return { id, ConfigEntryType::Bool, default_val, 0, "", 0, 0 };
+    }
+
+    constexpr ConfigEntrySchema MakeU64ConfigEntrySchema(const ConfigEntryId id, const u64 default_val, const u64 min_val = 0, const u64 max_val = UINT64_MAX) {
+        return { id, ConfigEntryType::U64, false, default_val, "", min_val, max_val };
+    }
+
+    constexpr ConfigEntrySchema MakeStringConfigEntrySchema(const ConfigEntryId id, const char *default_val, const u64 max_len = ConfigEntryMaxStringLength) {
+        return { id, ConfigEntryType::String, false, 0, default_val, 0, max_len };
+    }
+
+    constexpr ConfigEntrySchema ConfigSchema[] = {
+        // Take over eShop by default
+        MakeU64ConfigEntrySchema(ConfigEntryId::MenuTakeoverProgramId, 0x010000000000100B),
+        // Take over parental control applet by default
+        MakeU64ConfigEntrySchema(ConfigEntryId::HomebrewAppletTakeoverProgramId, 0x0100000000001001),
+        // No donor title by default
+        MakeU64ConfigEntrySchema(ConfigEntryId::HomebrewApplicationTakeoverApplicationId, 0),
+        // Disabled by default, it might interfer with other homebrews
+        MakeBoolConfigEntrySchema(ConfigEntryId::ViewerUsbEnabled, false),
+        // Empty by default
+        MakeStringConfigEntrySchema(ConfigEntryId::ActiveThemeName, ""),
+        MakeU64ConfigEntrySchema(ConfigEntryId::MenuEntryHeightCount, 3, 1, 10),
+        // Zero workers means caching is done inline
+        MakeU64ConfigEntrySchema(ConfigEntryId::CacheWorkerCount, menu::DefaultCacheWorkerCount, 0, menu::MaxCacheWorkerCount),
+        // Zero means no budget
+        MakeU64ConfigEntrySchema(ConfigEntryId::CacheBudgetSize, menu::DefaultCacheBudgetSize)
+    };
+
+    constexpr bool IsConfigSchemaValid() {
+        if(std::size(ConfigSchema) != ConfigEntryCount) {
             return false;
         }
-
-        template<typename T>
-        inline bool Set(const T &t) {
-            switch(this->header.type) {
-                case ConfigEntryType::Bool: {
-                    if constexpr(std::is_same_v<T, bool>) {
-                        this->bool_value = t;
-                        return true;
-                    }
-                    else {
-                        return false;
-                    }
-                }
-                case ConfigEntryType::U64: {
-                    if constexpr(std::is_same_v<T, u64>) {
-                        this->u64_value = t;
-                        return true;
-                    }
-                    else {
-                        return false;
-                    }
-                }
-                case ConfigEntryType::String: {
-                    if constexpr(std::is_same_v<T, std::string>) {
-                        this->str_value = t;
-                        this->header.size = this->str_value.length();
-                        return true;
-                    }
-                    else {
-                        return false;
-                    }
-                }
+        for(size_t i = 0; i < std::size(ConfigSchema); i++) {
+            const auto &schema = ConfigSchema[i];
+            if(static_cast<size_t>(schema.id) != i) {
+                return false;
+            }
+            if((schema.type == ConfigEntryType::U64) && ((schema.default_u64 < schema.min_u64) || (schema.default_u64 > schema.max_u64))) {
+                return false;
+            }
+            if((schema.type == ConfigEntryType::String) && (schema.max_u64 > ConfigEntryMaxStringLength)) {
+                return false;
             }
-            return false;
         }
+        return true;
+    }
+    static_assert(IsConfigSchemaValid(), "Config schema must list every entry ID in order, with defaults within bounds");
+    // Set entries are tracked as a bitmask
+    static_assert(ConfigEntryCount <= 32);
+
+    constexpr const ConfigEntrySchema &GetConfigEntrySchema(const ConfigEntryId id) {
+        return ConfigSchema[static_cast<size_t>(id)];
+    }
+
+    constexpr bool IsKnownConfigEntryId(const ConfigEntryId id) {
+        return static_cast<size_t>(id) < ConfigEntryCount;
+    }
+
+    template<ConfigEntryType Type>
+    struct ConfigEntryTypeTraits;
+
+    template<>
+    struct ConfigEntryTypeTraits<ConfigEntryType::Bool> {
+        using ValueType = bool;
     };
 
+    template<>
+    struct ConfigEntryTypeTraits<ConfigEntryType::U64> {
+        using ValueType = u64;
+    };
+
+    template<>
+    struct ConfigEntryTypeTraits<ConfigEntryType::String> {
+        using ValueType = std::string;
+    };
+
+    template<ConfigEntryId Id>
+    using ConfigEntryValueType = typename ConfigEntryTypeTraits<GetConfigEntrySchema(Id).type>::ValueType;
+
+    inline bool IsConfigEntryValueValid(const ConfigEntrySchema &schema, const u64 val) {
+        return (val >= schema.min_u64) && (val <= schema.max_u64);
+    }
+
+    inline bool IsConfigEntryValueValid(const ConfigEntrySchema &schema, const std::string &val) {
+        return val.length() <= schema.max_u64;
+    }
+
+    struct ConfigEntryValue {
+        bool bool_value;
+        u64 u64_value;
+        std::string str_value;
+    };
+
+    // The whole config is written at once to a temporary file, which then replaces the previous one (kept as a backup until the next save)
+    // Any copy failing the size/CRC32 checks is skipped when loading, falling back to the next one (or to defaults if none is valid)
+
     struct ConfigHeader {
+        static constexpr u32 Magic = 0x47464355; // "UCFG"
+        // Version 1 had no version, size nor checksum (just the magic and entry count)
+        static constexpr u32 CurrentVersion = 2;
+        static constexpr size_t LegacyHeaderSize = 2 * sizeof(u32);
+
         u32 magic;
+        u32 version;
         u32 entry_count;
+        u32 data_size;
+        u32 data_crc32;
+        u32 reserved;
 
-        static constexpr u32 Magic = 0x47464355; // "UCFG"
+        inline bool IsValid() const {
+            return (this->magic == Magic) && (this->version == CurrentVersion);
+        }
     };
+    static_assert(sizeof(ConfigHeader) == 0x18);
 
     struct Config {
-        std::vector<ConfigEntry> entries;
+        std::array<ConfigEntryValue, ConfigEntryCount> values;
+        // Only entries explicitly set are saved, the rest keep following the schema defaults
+        u32 set_entry_mask;
 
-        template<typename T>
-        inline bool SetEntry(const ConfigEntryId id, const T &t) {
-            for(auto &entry : this->entries) {
-                if(entry.header.id == id) {
-                    return entry.Set(t);
-                }
-            }
-            // Create new entry
-            ConfigEntry new_entry = {
-                .header = {
-                    .id = id
-                }
-            };
-            switch(id) {
-                case ConfigEntryId::MenuTakeoverProgramId:
-                case ConfigEntryId::HomebrewAppletTakeoverProgramId:
-                case ConfigEntryId::HomebrewApplicationTakeoverApplicationId: {
-                    if constexpr(std::is_same_v<T, u64>) {
-                        new_entry.header.type = ConfigEntryType::U64;
-                        new_entry.header.size = sizeof(t);
-                        new_entry.u64_value = t;
-                        break;
-                    }
-                    else {
-                        return false;
-                    }
-                }
-                case ConfigEntryId::ViewerUsbEnabled: {
-                    if constexpr(std::is_same_v<T, bool>) {
-                        new_entry.header.type = ConfigEntryType::Bool;
-                        new_entry.header.size = sizeof(t);
-                        new_entry.bool_value = t;
-                        break;
-                    }
-                    else {
-                        return false;
-                    }
-                }
-                case ConfigEntryId::ActiveThemeName: {
-                    if constexpr(std::is_same_v<T, std::string>) {
-                        new_entry.header.type = ConfigEntryType::String;
-                        new_entry.header.size = t.length();
-                        new_entry.str_value = t;
-                        break;
-                    }
-                    else {
-                        return false;
-                    }
-                }
-                case ConfigEntryId::MenuEntryHeightCount: {
-                    if constexpr(std::is_same_v<T, u64>) {
-                        new_entry.header.type = ConfigEntryType::U64;
-                        new_entry.header.size = sizeof(t);
-                        new_entry.u64_value = t;
-                        break;
-                    }
-                    else {
-                        return false;
-                    }
-                }
+        Config() : set_entry_mask(0) {
+            for(size_t i = 0; i < ConfigEntryCount; i++) {
+                this->ResetEntry(static_cast<ConfigEntryId>(i));
             }
-            this->entries.push_back(std::move(new_entry));
-            return true;
         }
-        
-        template<typename T>
-        inline bool GetEntry(const ConfigEntryId id, T &out_t) const {
-            for(const auto &entry : this->entries) {
-                if(entry.header.id == id) {
-                    return entry.Get(out_t);
-                }
+
+        inline void ResetEntry(const ConfigEntryId id) {
+            const auto &schema = GetConfigEntrySchema(id);
+            auto &value = this->values[static_cast<size_t>(id)];
+            value.bool_value = schema.default_bool;
+            value.u64_value = schema.default_u64;
+            value.str_value = schema.default_str;
+            this->set_entry_mask &= ~BIT(static_cast<u32>(id));
+        }
+
+        inline bool IsEntrySet(const ConfigEntryId id) const {
+            return this->set_entry_mask & BIT(static_cast<u32>(id));
+        }
+
+        template<ConfigEntryId Id>
+        inline const ConfigEntryValueType<Id> &GetEntry() const {
+            static_assert(IsKnownConfigEntryId(Id), "Unknown config entry ID");
+            constexpr auto type = GetConfigEntrySchema(Id).type;
+            const auto &value = this->values[static_cast<size_t>(Id)];
+            if constexpr(type == ConfigEntryType::Bool) {
+                return value.bool_value;
             }
+            else if constexpr(type == ConfigEntryType::U64) {
+                return value.u64_value;
+            }
+            else {
+                return value.str_value;
+            }
+        }
 
-            // Default values
-            switch(id) {
-                case ConfigEntryId::MenuTakeoverProgramId: {
-                    if constexpr(std::is_same_v<T, u64>) {
-                        // Take over eShop by default
-                        out_t = 0x010000000000100B;
-                        return true;
-                    }
-                    else {
-                        return false;
-                    }
-                }
-                case ConfigEntryId::HomebrewAppletTakeoverProgramId: {
-                    if constexpr(std::is_same_v<T, u64>) {
-                        // Take over parental control applet by default
-                        out_t = 0x0100000000001001;
-                        return true;
-                    }
-                    else {
-                        return false;
-                    }
-                }
-                case ConfigEntryId::HomebrewApplicationTakeoverApplicationId: {
-                    if constexpr(std::is_same_v<T, u64>) {
-                        // No donor title by default
-                        out_t = 0;
-                        return true;
-                    }
-                    else {
-                        return false;
-                    }
-                }
-                case ConfigEntryId::ViewerUsbEnabled: {
-                    if constexpr(std::is_same_v<T, bool>) {
-                        // Disabled by default, it might interfer with other homebrews
-                        out_t = false;
-                        return true;
-                    }
-                    else {
-                        return false;
-                    }
+        // Fails (leaving the entry untouched) if the value is out of the schema bounds
+        template<ConfigEntryId Id>
+        inline bool SetEntry(const ConfigEntryValueType<Id> &t) {
+            static_assert(IsKnownConfigEntryId(Id), "Unknown config entry ID");
+            constexpr auto &schema = GetConfigEntrySchema(Id);
+            auto &value = this->values[static_cast<size_t>(Id)];
+            if constexpr(schema.type == ConfigEntryType::Bool) {
+                value.bool_value = t;
+            }
+            else {
+                if(!IsConfigEntryValueValid(schema, t)) {
+                    return false;
                 }
-                case ConfigEntryId::ActiveThemeName: {
-                    if constexpr(std::is_same_v<T, std::string>) {
-                        // Empty by default
-                        out_t = "";
-                        return true;
-                    }
-                    else {
-                        return false;
-                    }
+                if constexpr(schema.type == ConfigEntryType::U64) {
+                    value.u64_value = t;
                 }
-                case ConfigEntryId::MenuEntryHeightCount: {
-                    if constexpr(std::is_same_v<T, u64>) {
-                        out_t = 3;
-                        return true;
-                    }
-                    else {
-                        return false;
-                    }
+                else {
+                    value.str_value = t;
                 }
             }
-            return false;
+            this->set_entry_mask |= BIT(static_cast<u32>(Id));
+            return true;
         }
     };
 
+    // uSystem owns the config in memory (and saves it), other processes send it single entry updates
+
+    struct ConfigEntryDelta {
+        ConfigEntryId id;
+        u8 pad[7];
+        // Bool entries use it too
+        u64 u64_value;
+        char str_value[ConfigEntryMaxStringLength + 1];
+    };
+
+    template<ConfigEntryId Id>
+    inline ConfigEntryDelta MakeConfigEntryDelta(const ConfigEntryValueType<Id> &t) {
+        ConfigEntryDelta delta = {
+            .id = Id
+        };
+        if constexpr(GetConfigEntrySchema(Id).type == ConfigEntryType::String) {
+            util::CopyToStringBuffer(delta.str_value, t);
+        }
+        else {
+            delta.u64_value = t;
+        }
+        return delta;
+    }
+
+    // Deltas come from other processes, thus they are checked against the schema like loaded entries
+    bool ApplyConfigEntryDelta(Config &cfg, const ConfigEntryDelta &delta);
+
+    // Serialized configs have the same layout as the config file
+    constexpr size_t ConfigMaxSerializedSize = sizeof(ConfigHeader) + ConfigEntryCount * (sizeof(ConfigEntryHeader) + ConfigEntryMaxStringLength);
+
+    void SerializeConfig(const Config &cfg, std::vector<u8> &out_data);
+    bool DeserializeConfig(const u8 *data, const size_t data_size, Config &out_cfg);
+
     constexpr u32 CurrentThemeFormatVersion = 2;
 
     inline bool IsThemeOutdated(const Theme &theme) {
@@ -286,8 +303,73 @@ namespace ul::cfg {
     Result TryLoadTheme(const std::string &theme_name, Theme &out_theme);
     Result TryCacheLoadThemeIcon(const Theme &theme, std::string &out_icon_path);
 
+    // Themes found are kept in a catalog (along with their preview icons), keyed by theme zip name, size and modification time
+    // Thus only new/changed theme zips are opened, and invalid ones are remembered as such
+
+    constexpr const char ThemeCatalogPath[] = "sdmc:/ulaunch/cache/preview/catalog.bin";
+
+    struct ThemeCatalogHeader {
+        static constexpr u32 Magic = 0x43544C55; // "ULTC"
+        static constexpr u32 CurrentVersion = 1;
+
+        u32 magic;
+        u32 version;
+        u32 entry_count;
+        u32 data_size;
+        u32 data_crc32;
+        u32 reserved;
+
+        inline bool IsValid() const {
+            return (this->magic == Magic) && (this->version == CurrentVersion);
+        }
+    };
+    static_assert(sizeof(ThemeCatalogHeader) == 0x18);
+
+    // Followed by the theme zip name, manifest name/release/description/author and icon path (each one as a u32 length and the non-NUL-terminated string)
+    struct ThemeCatalogEntry {
+        u64 theme_size;
+        u64 theme_mtime;
+        // Result of loading the theme manifest
+        Result load_rc;
+        u32 format_version;
+    };
+    static_assert(sizeof(ThemeCatalogEntry) == 0x18);
+
     std::vector<Theme> FindThemes();
 
+    // The active theme is extracted incrementally: a manifest keeps the CRC32/size of every extracted file, thus only changed files are extracted again (and removed ones deleted)
+    // The manifest is removed before changing anything and written back once done, thus an interrupted extraction just starts over
+
+    constexpr const char ActiveThemeCacheManifestPath[] = "sdmc:/ulaunch/cache/active/manifest.bin";
+
+    struct ActiveThemeCacheManifestHeader {
+        static constexpr u32 Magic = 0x4D544C55; // "ULTM"
+        static constexpr u32 CurrentVersion = 2;
+
+        u32 magic;
+        u32 version;
+        u32 entry_count;
+        u32 reserved;
+        // Theme zip size and modification time, to notice themes replaced with a different version
+        u64 theme_size;
+        u64 theme_mtime;
+        char theme_name[ConfigEntryMaxStringLength + 1];
+
+        inline bool IsValid() const {
+            return (this->magic == Magic) && (this->version == CurrentVersion);
+        }
+    };
+    static_assert(sizeof(ActiveThemeCacheManifestHeader) == 0x120);
+
+    // Followed by the entry path (relative to the cache path, not NUL-terminated)
+    struct ActiveThemeCacheManifestEntry {
+        u32 crc32;
+        u32 path_len;
+        u64 size;
+    };
+    static_assert(sizeof(ActiveThemeCacheManifestEntry) == 0x10);
+
+    // Only extracts the active theme if the cache belongs to another theme (or was removed)
     void EnsureCacheActiveTheme(const Config &cfg);
     void CacheActiveTheme(const Config &cfg);
     void RemoveActiveThemeCache();
@@ -3,6 +3,7 @@
 #include <switch.h>
 #include <sys/stat.h>
 #include <dirent.h>
+#include <vector>
 #include <ul/util/util_String.hpp>
 
 namespace ul::fs {
@@ -99,6 +100,27 @@ namespace ul::fs {
         }
     }
 
+    template<typename S>
+    inline bool ReadFileContents(const S &path, std::vector<u8> &out_data) {
+        // Size the buffer from the opened file itself, so that the whole file is read at once
+        auto f = fopen(util::GetCString(path), "rb");
+        if(f) {
+            auto ok = false;
+            if(fseek(f, 0, SEEK_END) == 0) {
+                const auto f_size = ftell(f);
+                if((f_size >= 0) && (fseek(f, 0, SEEK_SET) == 0)) {
+                    out_data.resize(f_size);
+                    ok = (f_size == 0) || (fread(out_data.data(), f_size, 1, f) == 1);
+                }
+            }
+            fclose(f);
+            return ok;
+        }
+        else {
+            return false;
+        }
+    }
+
     template<typename S>
     inline size_t GetFileSize(const S &path) {
         struct stat st;
@@ -110,6 +132,19 @@ namespace ul::fs {
         }
     }
 
+    template<typename S>
+    inline bool GetFileSizeAndModificationTime(const S &path, size_t &out_size, u64 &out_mtime) {
+        struct stat st;
+        if(stat(util::GetCString(path), &st) == 0) {
+            out_size = st.st_size;
+            out_mtime = st.st_mtime;
+            return true;
+        }
+        else {
+            return false;
+        }
+    }
+
     template<typename S>
     inline bool ReadFileString(const S &path, std::string &out) {
         const auto f_size = GetFileSize(path);
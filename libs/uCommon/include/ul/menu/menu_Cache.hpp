@@ -3,18 +3,126 @@
 #include <ul/ul_Include.hpp>
 #include <ul/fs/fs_Stdio.hpp>
 #include <ul/util/util_String.hpp>
+#include <ul/menu/menu_ControlStrings.hpp>
 
 namespace ul::menu {
 
+    // Cache extraction can be done by worker threads on other cores, with zero workers it's all done by the calling thread
+    // uSystem may only use core 3 (see uSystem.json), thus it caches inline by default
+    constexpr u32 DefaultCacheWorkerCount = 0;
+    constexpr u32 MaxCacheWorkerCount = 3;
+
+    void SetCacheWorkerCount(const u32 count);
+
+    // Homebrew cache is kept across boots, only new/changed NROs are (re)cached and vanished ones are removed
     void CacheHomebrew(const std::string &hb_base_path = RootHomebrewPath);
-    void CacheApplications(const std::vector<NsApplicationRecord> &records);
-    void CacheSingleApplication(const u64 app_id);
+    void ResetHomebrewCache();
+    // Same goes for applications, tied to their version and last record event: meant to be called at boot and on every application record change
+    // Returns the IDs of the applications which were (re)cached
+    std::vector<u64> CacheApplications(const std::vector<NsApplicationRecord> &records);
+    void ResetApplicationCache();
 
-    inline std::string GetApplicationCacheIconPath(const u64 app_id) {
-        return fs::JoinPath(ApplicationCachePath, util::FormatProgramId(app_id) + ".jpg");
+    inline std::string GetApplicationCacheNacpPath(const u64 app_id) {
+        return fs::JoinPath(ApplicationCachePath, util::FormatProgramId(app_id) + ".nacp");
     }
 
-    std::string GetHomebrewCacheIconPath(const std::string &nro_path);
-    std::string GetHomebrewCacheNacpPath(const std::string &nro_path);
+    struct HomebrewCacheLocation {
+        // Also the key in the homebrew icon packs
+        u64 icon_key;
+        std::string nacp_path;
+    };
+
+    // Both are derived from a hash of the NRO path, memoised (along with whether the NACP is cached at all) for the whole process
+    HomebrewCacheLocation GetHomebrewCacheLocation(const std::string &nro_path);
+    bool ReadHomebrewCacheNacp(const std::string &nro_path, NacpStruct &out_nacp);
+    // Straight from the NRO, for homebrew whose cache was evicted
+    bool ReadHomebrewNroNacp(const std::string &nro_path, NacpStruct &out_nacp);
+
+    // Icons are stored in an icon pack per cache (see menu_IconPack.hpp), opened on first read and kept open afterwards
+    bool ReadApplicationCacheIcon(const u64 app_id, std::vector<u8> &out_icon_data);
+    bool ReadHomebrewCacheIcon(const std::string &nro_path, std::vector<u8> &out_icon_data);
+    // Resolved for the system language at cache time (see menu_ControlStrings.hpp)
+    bool FindApplicationCacheControlStrings(const u64 app_id, ControlStrings &out_strs);
+    bool FindHomebrewCacheControlStrings(const std::string &nro_path, ControlStrings &out_strs);
+
+    // Picks up icons/strings cached after they were loaded (like those of newly installed applications)
+    void RefreshCaches();
+
+    // uMenu also keeps icons decoded (RGBA) and scaled to the current entry size, LZ4-compressed in another pack per cache (only written by uMenu)
+    // Scaled icons are tied to the source icon (by its CRC32) and to their size, thus they are just regenerated if either changes
+
+    constexpr const char ScaledIconPackName[] = "icons_scaled";
+
+    struct ScaledCacheIconHeader {
+        u32 source_crc32;
+        u32 size;
+        u32 rgba_size;
+        u32 reserved;
+    };
+    static_assert(sizeof(ScaledCacheIconHeader) == 0x10);
+
+    bool ReadApplicationCacheScaledIcon(const u64 app_id, const u32 size, std::vector<u8> &out_rgba_data);
+    bool WriteApplicationCacheScaledIcon(const u64 app_id, const u32 size, const std::vector<u8> &rgba_data);
+    bool ReadHomebrewCacheScaledIcon(const std::string &nro_path, const u32 size, std::vector<u8> &out_rgba_data);
+    bool WriteHomebrewCacheScaledIcon(const std::string &nro_path, const u32 size, const std::vector<u8> &rgba_data);
+    // Saves anything uMenu wrote to the caches meanwhile (scaled icons, access times)
+    void FlushCaches();
+
+    // Caches are kept under a byte budget: uSystem evicts (at boot, with no uMenu running) homebrew assets not referenced by any menu entry, least recently used first
+    // Caches which can't be evicted still count towards the budget, homebrew assets are only evicted down to whatever they leave
+    // Evicted homebrew are just cached again once referenced, and applications are never evicted (every installed one has a menu entry)
+
+    constexpr u64 DefaultCacheBudgetSize = 128 * 1024 * 1024;
+    // Kept across boots, like the application/homebrew caches
+    constexpr const char CacheBudgetStatsFileName[] = "budget.bin";
+
+    inline std::string MakeCacheBudgetStatsPath() {
+        return fs::JoinPath(RootCachePath, CacheBudgetStatsFileName);
+    }
+
+    // Statistics are logged (by uMenu) on this interval
+    constexpr s64 CacheStatsLogIntervalSeconds = 5 * 60;
+
+    struct CacheStats {
+        // Lookups done by this process
+        u64 icon_hit_count;
+        u64 icon_miss_count;
+        u64 scaled_icon_hit_count;
+        u64 scaled_icon_miss_count;
+        u64 strings_hit_count;
+        u64 strings_miss_count;
+        // Saved by uSystem on every budget check
+        u64 eviction_count;
+        u64 evicted_size;
+        u64 total_size;
+        u64 budget_size;
+
+        inline u64 GetHitCount() const {
+            return this->icon_hit_count + this->scaled_icon_hit_count + this->strings_hit_count;
+        }
+
+        inline u64 GetMissCount() const {
+            return this->icon_miss_count + this->scaled_icon_miss_count + this->strings_miss_count;
+        }
+    };
+
+    void SetCacheBudgetSize(const u64 size);
+    void EnforceCacheBudget(const std::vector<std::string> &referenced_nro_paths);
+    CacheStats GetCacheStats();
+    void LogCacheStats();
+
+    // uSystem verifies cached entries in the background (only while the console is idle), one entry per step, so that caches never need to be started over
+    // Entries are checked by themselves (icon CRC32 and JPEG structure, NACP size, strings) and against their source (NS control data, the NRO), bad ones are cached again in place
+
+    enum class CacheVerifyResult {
+        Valid,
+        Repaired,
+        // Bad but its source is unavailable (like a gamecard not inserted), thus it's removed and cached again later
+        Dropped,
+        // Every entry was verified, the next step starts a new pass
+        PassFinished
+    };
+
+    CacheVerifyResult VerifyNextCacheEntry();
 
 }
@@ -0,0 +1,82 @@
+
+#pragma once
+#include <ul/ul_Include.hpp>
+#include <unordered_map>
+
+namespace ul::menu {
+
+    // Names/authors/versions of every cached application/homebrew, already resolved for the system language, so that they can be looked up with no NACP reads (or NS commands)
+    // Saved by the caching side as a compact file (entries plus one string blob) next to each cache, and loaded once (and on refreshes) by the others
+
+    constexpr const char ControlStringsIndexFileName[] = "strings.bin";
+
+    struct ControlStringsIndexHeader {
+        static constexpr u32 Magic = 0x53434C55; // "ULCS"
+        static constexpr u32 CurrentVersion = 1;
+
+        u32 magic;
+        u32 version;
+        // Strings for other languages are never used, the index is rebuilt instead
+        u32 language;
+        u32 entry_count;
+        u32 string_data_size;
+        u32 reserved;
+
+        inline bool IsValid() const {
+            return (this->magic == Magic) && (this->version == CurrentVersion);
+        }
+    };
+    static_assert(sizeof(ControlStringsIndexHeader) == 0x18);
+
+    // Name, author and version are stored one after the other (non-NUL-terminated) at the string offset
+    struct ControlStringsIndexEntry {
+        u64 key;
+        u32 string_offset;
+        u16 name_length;
+        u16 author_length;
+        u16 version_length;
+        u8 reserved[6];
+    };
+    static_assert(sizeof(ControlStringsIndexEntry) == 0x18);
+
+    struct ControlStrings {
+        std::string name;
+        std::string author;
+        std::string version;
+    };
+
+    // Picks the system language's entry (or else the first one with a name and author)
+    bool ResolveControlStrings(NacpStruct *nacp, ControlStrings &out_strs);
+    SetLanguage GetControlStringsLanguage();
+
+    class ControlStringsIndex {
+        private:
+            std::string path;
+            u32 language;
+            std::unordered_map<u64, ControlStrings> strings;
+            bool loaded;
+            bool load_attempted;
+            bool dirty;
+            RecursiveMutex lock;
+
+        public:
+            ControlStringsIndex(const std::string &path) : path(path), language(0), strings(), loaded(false), load_attempted(false), dirty(false), lock() {}
+
+            // Fails (leaving the index empty) if it's missing, invalid or made for another language
+            bool Load(const u32 language);
+            // Starts an empty index from scratch
+            void Reset(const u32 language);
+            bool Save();
+
+            inline bool IsLoaded() {
+                ScopedLock lk(this->lock);
+                return this->loaded;
+            }
+
+            // Loads the index on first use
+            bool Find(const u64 key, ControlStrings &out_strs);
+            void Set(const u64 key, const ControlStrings &strs);
+            void Remove(const u64 key);
+    };
+
+}
@@ -4,6 +4,7 @@
 #include <ul/fs/fs_Stdio.hpp>
 #include <ul/ul_Include.hpp>
 #include <vector>
+#include <functional>
 
 namespace ul::menu {
 
@@ -25,6 +26,8 @@ namespace ul::menu {
         u64 app_id;
         NsApplicationRecord record;
         NsApplicationContentMetaStatus meta_status;
+        // Meta status is loaded on demand (see Entry::TryLoadApplicationMetaStatus), since it requires a NS command per entry
+        bool meta_status_loaded;
 
         inline bool IsInstalledNew() const {
             return this->record.type == 0x03;
@@ -50,12 +53,13 @@ namespace ul::menu {
     };
 
     struct EntryHomebrewInfo {
-        loader::TargetInput nro_target;
+        std::string nro_path;
+        std::string nro_argv;
     };
 
     struct EntryFolderInfo {
-        char name[FS_MAX_PATH];
-        char fs_name[FS_MAX_PATH];
+        std::string name;
+        std::string fs_name;
     };
 
     struct EntryControlData {
@@ -65,25 +69,35 @@ namespace ul::menu {
         bool custom_author;
         std::string version;
         bool custom_version;
+        // Only set for custom icons, cached ones are read from the icon packs instead (see menu_Cache.hpp)
         std::string icon_path;
         bool custom_icon_path;
 
         inline bool IsLoaded() {
-            return !this->name.empty() && !this->author.empty() && !this->version.empty() && !this->icon_path.empty();
+            return !this->name.empty() && !this->author.empty() && !this->version.empty();
         }
     };
 
+    // For folders, these are aggregated from their entries (updated on every change to the folder's contents)
+    struct EntryStats {
+        u64 size;
+        u64 last_launch_time;
+        u32 child_count;
+
+        inline bool operator==(const EntryStats &other) const = default;
+    };
+
     struct Entry {
         EntryType type;
         std::string entry_path;
         u32 index;
         EntryControlData control;
+        EntryStats stats;
 
-        union {
-            EntryApplicationInfo app_info;
-            EntryHomebrewInfo hb_info;
-            EntryFolderInfo folder_info;
-        };
+        // Strings are kept out of line, thus entries stay small (and cheap to move around)
+        EntryApplicationInfo app_info;
+        EntryHomebrewInfo hb_info;
+        EntryFolderInfo folder_info;
 
         template<EntryType Type>
         inline constexpr bool Is() const {
@@ -108,7 +122,10 @@ namespace ul::menu {
             return fs::JoinPath(fs::GetBaseDirectory(this->entry_path), this->folder_info.fs_name);
         }
 
+        // Runtime info (records, cached icons, etc.) is not stored in the menu, and it's safe to load it from other threads
+        bool LoadRuntimeInfo();
         void TryLoadControlData();
+        void TryLoadApplicationMetaStatus();
         void ReloadApplicationInfo();
 
         void MoveTo(const std::string &new_folder_path);
@@ -126,15 +143,36 @@ namespace ul::menu {
 
         void Save() const;
         std::vector<Entry> Remove();
+
+        void NotifyLaunched();
     };
 
     void InitializeEntries();
     void EnsureApplicationEntry(const NsApplicationRecord &app_record);
 
-    std::vector<Entry> LoadEntries(const std::string &path);
+    // uSystem loads the whole menu tree in memory and shares it as a snapshot (see menu_EntrySnapshot.hpp), which uMenu loads entries from instead of the SD card
+    // Every committed change is reported through the callback below (with the affected folder paths), so that the other side can stay in sync
+
+    using OnEntriesChangedCallback = std::function<void(const std::vector<std::string>&)>;
+
+    bool InitializeEntriesFromSnapshot(const void *snapshot_addr, const size_t snapshot_size);
+    void LoadEntryTree();
+    void ReloadEntryTreeFolders(const std::vector<std::string> &folder_paths);
+    // Resolves again the search strings of every entry whose cached strings changed (meant to be called by the owner after caching)
+    void RefreshEntrySearchIndex();
+    // NRO paths of every homebrew entry in the loaded tree
+    std::vector<std::string> ListEntryTreeHomebrewPaths();
+    bool WriteEntryTreeSnapshot(void *shmem_addr, const size_t shmem_size);
+    void SetOnEntriesChanged(OnEntriesChangedCallback callback);
+
+    std::vector<Entry> LoadEntries(const std::string &path, const bool load_runtime_info = true);
+    void ExportEntries(const std::string &path);
     
     Entry CreateFolderEntry(const std::string &base_path, const std::string &folder_name, const u32 index);
     Entry CreateHomebrewEntry(const std::string &base_path, const std::string &nro_path, const std::string &nro_argv, const u32 index);
+
+    // Returned entries come straight from the menu indexes, thus they lack runtime info (records, cached icons, etc.)
+    std::vector<Entry> FindApplicationEntries(const u64 app_id, const std::string &path = MenuPath);
     void DeleteApplicationEntry(const u64 app_id, const std::string &path);
 
 }
@@ -0,0 +1,173 @@
+
+#pragma once
+#include <ul/menu/menu_Entries.hpp>
+#include <unordered_map>
+
+namespace ul::menu {
+
+    // Every menu folder keeps all of its entries packed in a single index file, thus loading a folder is a single sequential read
+    // Entry paths ("<folder>/<index>.m.json") are kept as logical paths, and the actual JSON files are only used for migration/exporting
+
+    constexpr const char EntryIndexFileName[] = "index.bin";
+    constexpr const char LegacyEntryExtension[] = ".m.json";
+
+    struct EntryIndexHeader {
+        static constexpr u32 Magic = 0x494D4C55; // "ULMI"
+        static constexpr u32 CurrentVersion = 3;
+
+        u32 magic;
+        u32 version;
+        u32 entry_count;
+        u32 data_size;
+        // Version 2+: the slot bitmap words follow the header, before the records
+        u32 slot_bitmap_word_count;
+        u32 next_folder_name_idx;
+        u8 reserved[8];
+
+        inline bool IsValid() const {
+            return (this->magic == Magic) && (this->version > 0) && (this->version <= CurrentVersion);
+        }
+
+        inline size_t GetSize() const {
+            return (this->version >= 2) ? sizeof(EntryIndexHeader) : 0x10;
+        }
+    };
+    static_assert(sizeof(EntryIndexHeader) == 0x20);
+
+    enum class EntryIndexString : u32 {
+        CustomName,
+        CustomAuthor,
+        CustomVersion,
+        CustomIconPath,
+        NroPath,
+        NroArgv,
+        FolderName,
+        FolderFsName,
+
+        Count
+    };
+
+    // Records are followed by their (non-NUL-terminated) strings, in the order above
+    struct EntryIndexRecord {
+        static constexpr size_t V1Size = 0x20;
+
+        EntryType type;
+        u32 index;
+        u64 app_id;
+        u16 string_lengths[static_cast<u32>(EntryIndexString::Count)];
+        // Version 3+
+        u64 size;
+        u64 last_launch_time;
+        u32 child_count;
+        u8 reserved[4];
+
+        static inline constexpr size_t GetSize(const u32 version) {
+            return (version >= 3) ? sizeof(EntryIndexRecord) : V1Size;
+        }
+    };
+    static_assert(sizeof(EntryIndexRecord) == 0x38);
+
+    // Slot (entry index) usage is tracked in a bitmap, so that finding a free slot doesn't require checking every entry
+
+    struct EntryIndex {
+        static constexpr u32 SlotBitmapWordBits = 64;
+        // Way more than any folder holds, indexes with slots beyond it are treated as invalid (a corrupted slot would make the bitmap huge otherwise)
+        static constexpr u32 MaxSlotCount = 0x10000;
+        static constexpr u32 MaxSlotBitmapWordCount = MaxSlotCount / SlotBitmapWordBits;
+
+        std::vector<Entry> entries;
+        std::vector<u64> slot_bitmap;
+        u32 next_folder_name_idx;
+        u32 first_free_slot_hint;
+        // Loaded from an older version, thus lacking entry stats
+        bool outdated;
+
+        bool IsSlotUsed(const u32 slot) const;
+        u32 FindFreeSlot();
+        bool CheckSlotBitmap() const;
+        void RebuildSlotBitmap();
+
+        Entry *Find(const u32 slot);
+        void Upsert(const Entry &entry);
+        void Remove(const u32 slot);
+
+        inline u32 AllocateFolderNameIndex() {
+            return this->next_folder_name_idx++;
+        }
+    };
+
+    inline bool IsPathWithin(const std::string &path, const std::string &base_path) {
+        return (path == base_path) || (path.starts_with(base_path) && (path.at(base_path.length()) == '/'));
+    }
+
+    inline std::string MakeEntryPath(const std::string &base_path, const u32 idx) {
+        return fs::JoinPath(base_path, std::to_string(idx) + LegacyEntryExtension);
+    }
+
+    inline std::string MakeEntryIndexPath(const std::string &folder_path) {
+        return fs::JoinPath(folder_path, EntryIndexFileName);
+    }
+
+    // Application entries are also tracked in a menu-wide reverse index (application ID -> entry location), so that they can be located without reading the whole menu
+    // It is updated every time a folder's index is saved, and rebuilt when it's found to be out of sync (for instance, after being modified by another process)
+
+    constexpr const char ApplicationEntryIndexFileName[] = "app_index.bin";
+
+    struct ApplicationEntryIndexHeader {
+        static constexpr u32 Magic = 0x414D4C55; // "ULMA"
+        static constexpr u32 CurrentVersion = 1;
+
+        u32 magic;
+        u32 version;
+        u32 location_count;
+        u32 data_size;
+
+        inline bool IsValid() const {
+            return (this->magic == Magic) && (this->version == CurrentVersion);
+        }
+    };
+    static_assert(sizeof(ApplicationEntryIndexHeader) == 0x10);
+
+    // Records are followed by their (non-NUL-terminated) folder path
+    struct ApplicationEntryIndexRecord {
+        u64 app_id;
+        u32 index;
+        u32 folder_path_length;
+    };
+    static_assert(sizeof(ApplicationEntryIndexRecord) == 0x10);
+
+    struct ApplicationEntryLocation {
+        std::string folder_path;
+        u32 index;
+
+        inline bool operator==(const ApplicationEntryLocation &other) const {
+            return (this->index == other.index) && (this->folder_path == other.folder_path);
+        }
+    };
+
+    struct ApplicationEntryIndex {
+        std::unordered_multimap<u64, ApplicationEntryLocation> locations;
+
+        std::vector<ApplicationEntryLocation> Find(const u64 app_id, const std::string &base_path) const;
+        bool UpdateFolder(const std::string &folder_path, const EntryIndex &index);
+        void RenameFolder(const std::string &old_folder_path, const std::string &new_folder_path);
+        void RemoveFolder(const std::string &folder_path);
+    };
+
+    inline std::string MakeApplicationEntryIndexPath() {
+        return fs::JoinPath(MenuPath, ApplicationEntryIndexFileName);
+    }
+
+    bool ParseEntryIndexRecord(const std::string &folder_path, const u8 *data, const size_t data_size, const size_t record_size, size_t &offset, Entry &out_entry);
+    void SerializeEntryIndexRecord(const Entry &entry, std::vector<u8> &out_data);
+
+    bool ParseEntryIndex(const std::string &folder_path, const u8 *data, const size_t data_size, EntryIndex &out_index);
+    void SerializeEntryIndex(const EntryIndex &index, std::vector<u8> &out_data);
+
+    bool ReadEntryIndex(const std::string &folder_path, EntryIndex &out_index);
+    bool WriteEntryIndex(const std::string &folder_path, const EntryIndex &index);
+
+    bool ReadApplicationEntryIndex(ApplicationEntryIndex &out_app_index);
+    bool WriteApplicationEntryIndex(const ApplicationEntryIndex &app_index);
+
+}
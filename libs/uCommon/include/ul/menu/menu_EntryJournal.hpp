@@ -0,0 +1,92 @@
+
+#pragma once
+#include <ul/menu/menu_EntryIndex.hpp>
+
+namespace ul::menu {
+
+    // Menu entry mutations are grouped in batches, each one appended to the journal (with a single write) before being applied to the entry indexes
+    // All operations are idempotent, thus the journal is replayed at boot in case applying was interrupted, and it's only compacted (cleared) lazily
+
+    constexpr const char EntryJournalFileName[] = "journal.bin";
+    constexpr size_t EntryJournalCompactSize = 64 * 1024;
+
+    enum class EntryJournalOperationType : u32 {
+        PutEntry,
+        EraseEntry,
+        SetFolderNameIndex,
+        RenameFolder,
+        DeleteFolder
+    };
+
+    struct EntryJournalOperation {
+        EntryJournalOperationType type;
+        std::string path;
+        std::string new_path;
+        u32 value;
+        Entry entry;
+    };
+
+    struct EntryJournalBatchHeader {
+        static constexpr u32 Magic = 0x4A4D4C55; // "ULMJ"
+
+        u32 magic;
+        u32 op_count;
+        u32 data_size;
+        u32 data_crc32;
+    };
+    static_assert(sizeof(EntryJournalBatchHeader) == 0x10);
+
+    // Operations are followed by their (non-NUL-terminated) paths and the serialized entry record, if any
+    struct EntryJournalOperationHeader {
+        EntryJournalOperationType type;
+        u32 value;
+        u16 path_length;
+        u16 new_path_length;
+        u32 entry_record_size;
+    };
+    static_assert(sizeof(EntryJournalOperationHeader) == 0x10);
+
+    inline std::string MakeEntryJournalPath() {
+        return fs::JoinPath(MenuPath, EntryJournalFileName);
+    }
+
+    void SerializeEntryJournalBatch(const std::vector<EntryJournalOperation> &ops, std::vector<u8> &out_data);
+    bool ParseEntryJournalBatch(const u8 *data, const size_t data_size, size_t &offset, std::vector<EntryJournalOperation> &out_ops);
+
+    bool AppendEntryJournalBatch(const std::vector<EntryJournalOperation> &ops);
+    // Incomplete/corrupted trailing batches (interrupted appends) are ignored, since they were never applied
+    bool ReadEntryJournal(std::vector<std::vector<EntryJournalOperation>> &out_batches);
+    void ClearEntryJournal();
+
+    // Groups entry mutations, which are only written (as a single journal batch, and then applied to every affected index once) on commit
+    // Pending changes are tracked in memory, thus slots, folder names, etc. are consistent across operations of the same transaction
+
+    class EntryTransaction {
+        private:
+            std::unordered_map<std::string, EntryIndex> indexes;
+            std::vector<EntryJournalOperation> ops;
+            std::vector<std::pair<std::string, std::string>> pending_folder_renames;
+
+            EntryIndex &GetIndex(const std::string &folder_path);
+            void PutEntry(const Entry &entry);
+            void EraseEntry(const std::string &folder_path, const u32 slot);
+            void MoveFolder(Entry &folder_entry, const std::string &new_folder_path);
+
+        public:
+            u32 FindFreeSlot(const std::string &folder_path);
+            std::string AllocateFolderPath(const std::string &base_path, const std::string &folder_name);
+
+            void Save(const Entry &entry);
+            void Move(Entry &entry, const std::string &new_folder_path);
+            bool MoveToIndex(Entry &entry, const u32 new_index);
+            void Swap(Entry &entry, Entry &other_entry);
+            std::vector<Entry> Remove(Entry &entry);
+
+            inline bool IsEmpty() const {
+                return this->ops.empty();
+            }
+
+            void Commit();
+    };
+
+}
@@ -0,0 +1,97 @@
+
+#pragma once
+#include <ul/menu/menu_EntryIndex.hpp>
+#include <functional>
+
+namespace ul::menu {
+
+    // Names/authors of the entries in every menu folder are indexed by (lowercase) trigrams, so that entries can be searched without loading any folder
+    // Only the documents (entry location + strings) are persisted, trigrams are built in memory the first time the index is searched
+
+    constexpr const char EntrySearchIndexFileName[] = "search_index.bin";
+
+    struct EntrySearchIndexHeader {
+        static constexpr u32 Magic = 0x464D4C55; // "ULMF"
+        static constexpr u32 CurrentVersion = 1;
+
+        u32 magic;
+        u32 version;
+        u32 document_count;
+        u32 data_size;
+
+        inline bool IsValid() const {
+            return (this->magic == Magic) && (this->version == CurrentVersion);
+        }
+    };
+    static_assert(sizeof(EntrySearchIndexHeader) == 0x10);
+
+    // Records are followed by their (non-NUL-terminated) strings, in the order below
+    struct EntrySearchIndexRecord {
+        EntryType type;
+        u32 index;
+        u16 folder_path_length;
+        u16 source_length;
+        u16 name_length;
+        u16 author_length;
+    };
+    static_assert(sizeof(EntrySearchIndexRecord) == 0x10);
+
+    struct EntrySearchDocument {
+        EntryType type;
+        u32 index;
+        std::string folder_path;
+        // What the strings were resolved from (application ID/NRO path/folder, any custom strings and a stamp of the cached strings), they are only resolved again if it changes
+        std::string source;
+        std::string name;
+        std::string author;
+
+        inline bool IsValid() const {
+            return this->type != EntryType::Invalid;
+        }
+    };
+
+    struct EntrySearchResult {
+        std::string folder_path;
+        u32 index;
+        EntryType type;
+        std::string name;
+    };
+
+    using EntrySearchStringResolver = std::function<bool(const Entry&, std::string&, std::string&)>;
+    // Cheap stamp of what the resolver would currently return, thus documents get resolved again when the cached strings change (updated application/homebrew, another system language)
+    using EntrySearchSourceStamper = std::function<u32(const Entry&)>;
+
+    struct EntrySearchIndex {
+        std::vector<EntrySearchDocument> documents;
+        std::vector<u32> free_document_ids;
+        std::unordered_map<std::string, std::vector<u32>> folder_document_ids;
+        // Built on demand (see Search)
+        std::unordered_map<u32, std::vector<u32>> trigram_document_ids;
+        std::vector<std::string> lower_names;
+        std::vector<std::string> lower_authors;
+        bool trigrams_built;
+
+        static std::string MakeSource(const Entry &entry, const u32 stamp);
+
+        bool UpdateFolder(const std::string &folder_path, const EntryIndex &index, EntrySearchStringResolver resolver, EntrySearchSourceStamper stamper);
+        void RenameFolder(const std::string &old_folder_path, const std::string &new_folder_path);
+        void RemoveFolder(const std::string &folder_path);
+
+        u32 AddDocument(EntrySearchDocument &&doc);
+        void RemoveDocument(const u32 doc_id);
+
+        void BuildTrigrams();
+        std::vector<EntrySearchResult> Search(const std::string &query, const u32 max_count);
+    };
+
+    inline std::string MakeEntrySearchIndexPath() {
+        return fs::JoinPath(MenuPath, EntrySearchIndexFileName);
+    }
+
+    bool ReadEntrySearchIndex(EntrySearchIndex &out_search_index);
+    bool WriteEntrySearchIndex(const EntrySearchIndex &search_index);
+
+    // Searches the index kept along with the menu tree (see menu_Entries.cpp), best matches go first
+    std::vector<EntrySearchResult> SearchEntries(const std::string &query, const u32 max_count);
+
+}
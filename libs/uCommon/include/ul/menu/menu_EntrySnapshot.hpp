@@ -0,0 +1,55 @@
+
+#pragma once
+#include <ul/menu/menu_EntryIndex.hpp>
+
+namespace ul::menu {
+
+    // uSystem keeps the whole menu (every folder's index) in memory, and shares a read-only serialized copy of it with uMenu through shared memory
+    // The copy is guarded by a sequence counter (odd while being written), so that uMenu never reads a half-written snapshot without taking any lock
+
+    constexpr size_t EntrySnapshotSharedMemorySize = 0x80000;
+
+    struct EntrySnapshotHeader {
+        static constexpr u32 Magic = 0x534D4C55; // "ULMS"
+        static constexpr u32 CurrentVersion = 1;
+
+        u32 magic;
+        u32 version;
+        u32 generation;
+        u32 folder_count;
+        u32 data_size;
+        u8 reserved[12];
+
+        inline bool IsValid() const {
+            return (this->magic == Magic) && (this->version == CurrentVersion);
+        }
+    };
+    static_assert(sizeof(EntrySnapshotHeader) == 0x20);
+
+    // Folder records are followed by their (non-NUL-terminated) path and their serialized index
+    struct EntrySnapshotFolderRecord {
+        u32 folder_path_length;
+        u32 index_data_size;
+    };
+    static_assert(sizeof(EntrySnapshotFolderRecord) == 0x8);
+
+    struct EntryTree {
+        std::unordered_map<std::string, EntryIndex> folders;
+
+        void RenameFolder(const std::string &old_folder_path, const std::string &new_folder_path);
+        void RemoveFolder(const std::string &folder_path);
+        void RemoveOrphanFolders();
+    };
+
+    void SerializeEntrySnapshot(const EntryTree &tree, std::vector<u8> &out_data);
+    bool ParseEntrySnapshot(const u8 *data, const size_t data_size, EntryTree &out_tree);
+
+    // Both return false if the snapshot doesn't fit in the shared memory/wasn't published yet
+    bool WriteEntrySnapshot(void *shmem_addr, const size_t shmem_size, const EntryTree &tree);
+    bool ReadEntrySnapshot(const void *shmem_addr, const size_t shmem_size, u32 &out_generation, std::vector<u8> &out_data);
+
+    inline u32 GetEntrySnapshotGeneration(const void *shmem_addr) {
+        return __atomic_load_n(&reinterpret_cast<const EntrySnapshotHeader*>(shmem_addr)->generation, __ATOMIC_ACQUIRE);
+    }
+
+}
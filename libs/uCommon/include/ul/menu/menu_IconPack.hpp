@@ -0,0 +1,141 @@
+
+#pragma once
+#include <ul/ul_Include.hpp>
+#include <ul/fs/fs_Stdio.hpp>
+#include <unordered_map>
+
+namespace ul::menu {
+
+    // Cached icons are kept in a single append-only pack file (instead of one file per icon), looked up by key (application ID or NRO path hash) through an index
+    // Every record is checked (magic + CRC32) when scanned, thus an interrupted append is just cut off, and the index file only speeds up loading
+
+    constexpr const char DefaultIconPackName[] = "icons";
+    constexpr size_t IconPackCompactMinimumSize = 512 * 1024;
+
+    struct IconPackHeader {
+        static constexpr u32 Magic = 0x50494C55; // "ULIP"
+        static constexpr u32 CurrentVersion = 1;
+
+        u32 magic;
+        u32 version;
+        // Changed on every compaction, so that indexes of previous packs are never used
+        u64 generation;
+
+        inline bool IsValid() const {
+            return (this->magic == Magic) && (this->version == CurrentVersion);
+        }
+    };
+    static_assert(sizeof(IconPackHeader) == 0x10);
+
+    // Records are followed by the icon data, removals are records with no data
+    struct IconPackRecordHeader {
+        static constexpr u32 Magic = 0x52494C55; // "ULIR"
+        static constexpr u32 FlagRemoved = BIT(0);
+
+        u32 magic;
+        u32 size;
+        u64 key;
+        u32 data_crc32;
+        u32 flags;
+    };
+    static_assert(sizeof(IconPackRecordHeader) == 0x18);
+
+    struct IconPackIndexHeader {
+        static constexpr u32 Magic = 0x58494C55; // "ULIX"
+        static constexpr u32 CurrentVersion = 1;
+
+        u32 magic;
+        u32 version;
+        u64 generation;
+        // Pack size when the index was saved, any records after it are scanned
+        u64 pack_size;
+        u64 dead_size;
+        u32 entry_count;
+        u32 reserved;
+
+        inline bool IsValid() const {
+            return (this->magic == Magic) && (this->version == CurrentVersion);
+        }
+    };
+    static_assert(sizeof(IconPackIndexHeader) == 0x28);
+
+    struct IconPackIndexEntry {
+        u64 key;
+        u64 data_offset;
+        u32 size;
+        u32 data_crc32;
+    };
+    static_assert(sizeof(IconPackIndexEntry) == 0x18);
+
+    class IconPack {
+        private:
+            std::string base_path;
+            std::string name;
+            FILE *file;
+            bool writable;
+            u64 generation;
+            u64 pack_size;
+            // Bytes taken by replaced/removed records (and removal records themselves)
+            u64 dead_size;
+            std::unordered_map<u64, IconPackIndexEntry> index;
+            // Whether the index file is behind the pack
+            bool index_dirty;
+            RecursiveMutex lock;
+
+            inline std::string GetPackPath() const {
+                return fs::JoinPath(this->base_path, this->name + ".pack");
+            }
+
+            inline std::string GetIndexPath() const {
+                return fs::JoinPath(this->base_path, this->name + ".idx");
+            }
+
+            inline std::string GetTemporaryPackPath() const {
+                return this->GetPackPath() + ".tmp";
+            }
+
+            bool LoadIndex();
+            bool ScanRecords(const u64 offset);
+            void ApplyRecord(const IconPackRecordHeader &record_header, const u64 record_offset);
+            bool AppendRecord(const IconPackRecordHeader &record_header, const void *data);
+            bool CreatePack(const u64 generation);
+
+        public:
+            IconPack(const std::string &base_path, const std::string &name = DefaultIconPackName);
+
+            ~IconPack() {
+                this->Close();
+            }
+
+            // Only one process (uSystem/uManager) writes to a pack, while others (uMenu) just read from it
+            bool Open(const bool writable);
+            void Close();
+            // Picks up records appended (by other processes) since the pack was opened
+            bool Refresh();
+
+            inline bool IsOpen() {
+                ScopedLock lk(this->lock);
+                return this->file != nullptr;
+            }
+
+            bool Find(const u64 key, IconPackIndexEntry &out_entry);
+            std::vector<u64> ListKeys();
+            bool Read(const u64 key, std::vector<u8> &out_data);
+            bool Put(const u64 key, const void *data, const size_t size);
+            bool Remove(const u64 key);
+
+            inline u64 GetDeadSize() {
+                ScopedLock lk(this->lock);
+                return this->dead_size;
+            }
+
+            inline bool NeedsCompaction() {
+                ScopedLock lk(this->lock);
+                return (this->dead_size >= IconPackCompactMinimumSize) && (this->dead_size >= (this->pack_size / 2));
+            }
+
+            bool Compact();
+            bool SaveIndex();
+    };
+
+}
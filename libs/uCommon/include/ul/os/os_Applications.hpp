@@ -8,6 +8,8 @@ namespace ul::os {
     constexpr u32 MaxApplicationCount = 64000;
 
     std::vector<NsApplicationRecord> ListApplicationRecords();
+    bool FindApplicationRecord(const u64 app_id, NsApplicationRecord &out_record);
     Result GetApplicationContentMetaStatus(const u64 app_id, NsApplicationContentMetaStatus &out_status);
+    Result GetApplicationOccupiedSize(const u64 app_id, u64 &out_size);
 
 }
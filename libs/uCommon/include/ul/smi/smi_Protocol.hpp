@@ -55,7 +55,8 @@ namespace ul::smi {
         OpenMiiEdit,
         OpenAddUser,
         OpenNetConnect,
-        ReloadThemeCache
+        ReloadThemeCache,
+        ReloadMenuEntries
     };
 
     struct SystemStatus {
@@ -39,12 +39,12 @@ namespace ul {
         "sdmc:/ulaunch/cache/active/ui/Main/TopIcon/Battery",
         "sdmc:/ulaunch/cache/active/ui/Main/TopIcon/Connection",
         "sdmc:/ulaunch/cache/active/ui/Main/TopMenuBackground",
-        "sdmc:/ulaunch/cache/active/ui/Startup"
+        "sdmc:/ulaunch/cache/active/ui/Startup",
         "sdmc:/ulaunch/cache/active/ui/Themes",
         "sdmc:/ulaunch/cache/active/ui/Settings",
         "sdmc:/ulaunch/cache/active/sound",
         "sdmc:/ulaunch/cache/active/sound/Main",
-        "sdmc:/ulaunch/cache/active/sound/Startup"
+        "sdmc:/ulaunch/cache/active/sound/Startup",
         "sdmc:/ulaunch/cache/active/sound/Themes",
         "sdmc:/ulaunch/cache/active/sound/Settings",
     };
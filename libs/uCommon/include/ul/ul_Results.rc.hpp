@@ -16,6 +16,8 @@ namespace ulaunch {
     R_DEFINE_ERROR_RANGE(SystemSf, 201, 299);
     R_DEFINE_ERROR_RESULT(InvalidProcess, 201);
     R_DEFINE_ERROR_RESULT(NoMessagesAvailable, 202);
+    R_DEFINE_ERROR_RESULT(InvalidConfigEntry, 203);
+    R_DEFINE_ERROR_RESULT(InvalidConfigBufferSize, 204);
 
     R_DEFINE_ERROR_RANGE(Loader, 301, 399);
     R_DEFINE_ERROR_RESULT(InvalidProcessType, 301);
@@ -34,6 +36,7 @@ namespace ulaunch {
 
     R_DEFINE_ERROR_RANGE(Menu, 601, 699);
     R_DEFINE_ERROR_RESULT(RomfsNotFound, 601);
+    R_DEFINE_ERROR_RESULT(InvalidMenuEntrySnapshot, 602);
 
     R_DEFINE_ERROR_RANGE(Config, 701, 799);
     R_DEFINE_ERROR_RESULT(InvalidThemeZipFile, 701);
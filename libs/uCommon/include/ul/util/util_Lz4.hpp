@@ -0,0 +1,19 @@
+
+#pragma once
+#include <switch.h>
+
+namespace ul::util {
+
+    // Plain LZ4 block format (no frames/checksums), meant for data which is decompressed way more often than compressed
+    // Decompression checks every length/offset against the buffers, thus corrupted data just fails
+
+    constexpr size_t GetLz4CompressBound(const size_t size) {
+        return size + (size / 255) + 16;
+    }
+
+    // Returns the compressed size, or 0 if it doesn't fit
+    size_t CompressLz4(const u8 *src, const size_t src_size, u8 *dst, const size_t dst_capacity);
+    // The whole block must decompress to exactly dst_size bytes
+    bool DecompressLz4(const u8 *src, const size_t src_size, u8 *dst, const size_t dst_size);
+
+}
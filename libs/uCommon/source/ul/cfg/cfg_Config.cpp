@@ -4,6 +4,8 @@
 #include <ul/ul_Result.hpp>
 #include <ul/util/util_Scope.hpp>
 #include <ul/util/util_Zip.hpp>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace ul::cfg {
 
@@ -11,52 +13,429 @@ namespace ul::cfg {
 
         constexpr auto ThemeManifestPath = "theme/Manifest.json";
 
-    }
+        struct ActiveThemeFile {
+            u32 crc32;
+            u64 size;
+        };
 
-    Result TryLoadTheme(const std::string &theme_name, Theme &out_theme) {
-        const auto theme_path = fs::JoinPath(ThemesPath, theme_name);
-        auto theme_zip = zip_open(theme_path.c_str(), 0, 'r');
-        if(!theme_zip) {
-            return ResultInvalidThemeZipFile;
+        using ActiveThemeFileTable = std::unordered_map<std::string, ActiveThemeFile>;
+
+        bool ReadActiveThemeCacheManifest(ActiveThemeCacheManifestHeader &out_header, ActiveThemeFileTable &out_files) {
+            std::vector<u8> manifest_data;
+            if(!fs::ReadFileContents(ActiveThemeCacheManifestPath, manifest_data) || (manifest_data.size() < sizeof(ActiveThemeCacheManifestHeader))) {
+                return false;
+            }
+
+            memcpy(&out_header, manifest_data.data(), sizeof(out_header));
+            if(!out_header.IsValid()) {
+                return false;
+            }
+            out_header.theme_name[sizeof(out_header.theme_name) - 1] = '\0';
+
+            // The manifest has no checksum, thus the count is checked against the size before allocating anything
+            if(out_header.entry_count > ((manifest_data.size() - sizeof(ActiveThemeCacheManifestHeader)) / sizeof(ActiveThemeCacheManifestEntry))) {
+                return false;
+            }
+
+            out_files.clear();
+            out_files.reserve(out_header.entry_count);
+            size_t cur_offset = sizeof(ActiveThemeCacheManifestHeader);
+            for(u32 i = 0; i < out_header.entry_count; i++) {
+                ActiveThemeCacheManifestEntry entry;
+                if((cur_offset + sizeof(entry)) > manifest_data.size()) {
+                    return false;
+                }
+                memcpy(&entry, manifest_data.data() + cur_offset, sizeof(entry));
+                cur_offset += sizeof(entry);
+                if((cur_offset + entry.path_len) > manifest_data.size()) {
+                    return false;
+                }
+
+                std::string path(reinterpret_cast<const char*>(manifest_data.data() + cur_offset), entry.path_len);
+                cur_offset += entry.path_len;
+                out_files[std::move(path)] = {
+                    .crc32 = entry.crc32,
+                    .size = entry.size
+                };
+            }
+            return true;
         }
-        UL_ON_SCOPE_EXIT(
-            zip_close(theme_zip);
-        );
 
-        if(zip_entry_open(theme_zip, ThemeManifestPath) != 0) {
-            return ResultThemeManifestNotFound;
+        void WriteActiveThemeCacheManifest(const ActiveThemeCacheManifestHeader &header, const ActiveThemeFileTable &files) {
+            std::vector<u8> manifest_data(sizeof(header));
+            memcpy(manifest_data.data(), &header, sizeof(header));
+            for(const auto &[path, file] : files) {
+                const ActiveThemeCacheManifestEntry entry = {
+                    .crc32 = file.crc32,
+                    .path_len = static_cast<u32>(path.length()),
+                    .size = file.size
+                };
+                const auto entry_offset = manifest_data.size();
+                manifest_data.resize(entry_offset + sizeof(entry) + path.length());
+                memcpy(manifest_data.data() + entry_offset, &entry, sizeof(entry));
+                memcpy(manifest_data.data() + entry_offset + sizeof(entry), path.c_str(), path.length());
+            }
+
+            if(!fs::WriteFile(ActiveThemeCacheManifestPath, manifest_data.data(), manifest_data.size(), true)) {
+                UL_LOG_WARN("Unable to save active theme cache manifest");
+            }
         }
 
-        void *manifest_json_ptr;
-        size_t manifest_json_ptr_size;
-        if(zip_entry_read(theme_zip, &manifest_json_ptr, &manifest_json_ptr_size) <= 0) {
-            return ResultInvalidThemeZipFileRead;
+        inline bool IsActiveThemeEntryPathValid(const std::string &path) {
+            // No absolute paths or parent directories (nothing may be written outside the cache), nor our own manifest
+            if(path.empty() || (path.front() == '/') || (path.find("..") != std::string::npos)) {
+                return false;
+            }
+            return fs::JoinPath(ActiveThemeCachePath, path) != ActiveThemeCacheManifestPath;
         }
-        std::string manifest_json_str(reinterpret_cast<char*>(manifest_json_ptr), manifest_json_ptr_size);
-        free(manifest_json_ptr);
-        zip_entry_close(theme_zip);
 
-        const auto manifest_json = util::JSON::parse(manifest_json_str);
+        void EnsureActiveThemeEntryDirectories(const std::string &path, std::unordered_set<std::string> &created_dirs) {
+            auto sep_pos = path.find('/');
+            while(sep_pos != std::string::npos) {
+                auto dir = path.substr(0, sep_pos);
+                if(created_dirs.insert(dir).second) {
+                    fs::CreateDirectory(fs::JoinPath(ActiveThemeCachePath, dir));
+                }
+                sep_pos = path.find('/', sep_pos + 1);
+            }
+        }
 
-        #define _THEME_MANIFEST_CHECK_GET_VALUE(name, type, rc) { \
-            if(!manifest_json.count(#name)) { \
-                return rc; \
-            } \
-            out_theme.manifest.name = manifest_json[#name].get<type>(); \
+        inline std::string GetTemporaryConfigPath() {
+            return std::string(ConfigPath) + ".tmp";
+        }
+
+        inline std::string GetBackupConfigPath() {
+            return std::string(ConfigPath) + ".bak";
+        }
+
+        bool ParseConfigEntries(const u8 *data, const size_t data_size, const u32 entry_count, Config &out_cfg) {
+            out_cfg = {};
+            size_t cur_offset = 0;
+            for(u32 i = 0; i < entry_count; i++) {
+                ConfigEntryHeader ent_header;
+                if((cur_offset + sizeof(ConfigEntryHeader)) > data_size) {
+                    return false;
+                }
+                memcpy(&ent_header, data + cur_offset, sizeof(ent_header));
+                cur_offset += sizeof(ConfigEntryHeader);
+                if((cur_offset + ent_header.size) > data_size) {
+                    return false;
+                }
+                const auto ent_data = data + cur_offset;
+                cur_offset += ent_header.size;
+
+                // Entries unknown to this version, or not matching the schema, are dropped (thus keep their default values)
+                if(!IsKnownConfigEntryId(ent_header.id)) {
+                    UL_LOG_WARN("Dropping unknown config entry %d", static_cast<u32>(ent_header.id));
+                    continue;
+                }
+                const auto &schema = GetConfigEntrySchema(ent_header.id);
+                if(ent_header.type != schema.type) {
+                    UL_LOG_WARN("Dropping config entry %d with unexpected type %d", static_cast<u32>(ent_header.id), static_cast<u32>(ent_header.type));
+                    continue;
+                }
+
+                auto &value = out_cfg.values[static_cast<size_t>(ent_header.id)];
+                switch(ent_header.type) {
+                    case ConfigEntryType::Bool: {
+                        if(ent_header.size != sizeof(bool)) {
+                            return false;
+                        }
+                        memcpy(&value.bool_value, ent_data, sizeof(bool));
+                        break;
+                    }
+                    case ConfigEntryType::U64: {
+                        if(ent_header.size != sizeof(u64)) {
+                            return false;
+                        }
+                        u64 u64_value;
+                        memcpy(&u64_value, ent_data, sizeof(u64));
+                        if(!IsConfigEntryValueValid(schema, u64_value)) {
+                            UL_LOG_WARN("Dropping config entry %d with out of bounds value 0x%lX", static_cast<u32>(ent_header.id), u64_value);
+                            continue;
+                        }
+                        value.u64_value = u64_value;
+                        break;
+                    }
+                    case ConfigEntryType::String: {
+                        std::string str_value(reinterpret_cast<const char*>(ent_data), ent_header.size);
+                        if(!IsConfigEntryValueValid(schema, str_value)) {
+                            UL_LOG_WARN("Dropping config entry %d with too long value", static_cast<u32>(ent_header.id));
+                            continue;
+                        }
+                        value.str_value = std::move(str_value);
+                        break;
+                    }
+                    default: {
+                        return false;
+                    }
+                }
+                out_cfg.set_entry_mask |= BIT(static_cast<u32>(ent_header.id));
+            }
+            return true;
+        }
+
+        bool TryLoadConfigFile(const std::string &path, Config &out_cfg) {
+            std::vector<u8> cfg_data;
+            if(!fs::ReadFileContents(path, cfg_data) || (cfg_data.size() < ConfigHeader::LegacyHeaderSize)) {
+                return false;
+            }
+
+            if(DeserializeConfig(cfg_data.data(), cfg_data.size(), out_cfg)) {
+                return true;
+            }
+
+            // Older configs are only checked by their structure (they get converted on the next save)
+            // Their second word is the entry count (never as low as the current version, since they always had every default entry), thus damaged current configs aren't parsed as older ones
+            u32 legacy_header[2];
+            memcpy(legacy_header, cfg_data.data(), sizeof(legacy_header));
+            if((legacy_header[0] != ConfigHeader::Magic) || (legacy_header[1] == ConfigHeader::CurrentVersion)) {
+                return false;
+            }
+            return ParseConfigEntries(cfg_data.data() + ConfigHeader::LegacyHeaderSize, cfg_data.size() - ConfigHeader::LegacyHeaderSize, legacy_header[1], out_cfg);
+        }
+
+        Result LoadThemeManifest(struct zip_t *theme_zip, const std::string &theme_name, Theme &out_theme) {
+            if(zip_entry_open(theme_zip, ThemeManifestPath) != 0) {
+                return ResultThemeManifestNotFound;
+            }
+
+            void *manifest_json_ptr;
+            size_t manifest_json_ptr_size;
+            if(zip_entry_read(theme_zip, &manifest_json_ptr, &manifest_json_ptr_size) <= 0) {
+                return ResultInvalidThemeZipFileRead;
+            }
+            std::string manifest_json_str(reinterpret_cast<char*>(manifest_json_ptr), manifest_json_ptr_size);
+            free(manifest_json_ptr);
+            zip_entry_close(theme_zip);
+
+            const auto manifest_json = util::JSON::parse(manifest_json_str);
+
+            #define _THEME_MANIFEST_CHECK_GET_VALUE(name, type, rc) { \
+                if(!manifest_json.count(#name)) { \
+                    return rc; \
+                } \
+                out_theme.manifest.name = manifest_json[#name].get<type>(); \
+            }
+
+            _THEME_MANIFEST_CHECK_GET_VALUE(format_version, u32, ResultThemeManifestVersionNotFound)
+            _THEME_MANIFEST_CHECK_GET_VALUE(name, std::string, ResultThemeManifestNameNotFound)
+            _THEME_MANIFEST_CHECK_GET_VALUE(author, std::string, ResultThemeManifestAuthorNotFound)
+            _THEME_MANIFEST_CHECK_GET_VALUE(description, std::string, ResultThemeManifestDescriptionNotFound)
+            _THEME_MANIFEST_CHECK_GET_VALUE(release, std::string, ResultThemeManifestReleaseNotFound)
+
+            #undef _THEME_MANIFEST_CHECK_GET_VALUE
+
+            out_theme.name = theme_name;
+            return ResultSuccess;
+        }
+
+        Result CacheThemeIcon(struct zip_t *theme_zip, std::string &out_icon_path) {
+            std::string icon_fmt;
+            for(const auto &fmt: ImageFormatList) {
+                const auto icon_path = fs::JoinPath("theme", "Icon." + std::string(fmt));
+                if(zip_entry_open(theme_zip, icon_path.c_str()) == 0) {
+                    icon_fmt = fmt;
+                    break;
+                }
+            }
+            if(icon_fmt.empty()) {
+                return ResultThemeIconNotFound;
+            }
+
+            void *icon_ptr;
+            size_t icon_ptr_size;
+            if(zip_entry_read(theme_zip, &icon_ptr, &icon_ptr_size) <= 0) {
+                return ResultInvalidThemeZipFileRead;
+            }
+            UL_ON_SCOPE_EXIT(
+                free(icon_ptr);
+                zip_entry_close(theme_zip);
+            );
+
+            u8 hash[SHA256_HASH_SIZE] = {};
+            sha256CalculateHash(hash, icon_ptr, icon_ptr_size);
+            const auto icon_cache_path = fs::JoinPath(ThemePreviewCachePath, util::FormatSha256Hash(hash, true) + "." + icon_fmt);
+
+            fs::CreateDirectory(ThemePreviewCachePath);
+            if(!fs::WriteFile(icon_cache_path, icon_ptr, icon_ptr_size, true)) {
+                return ResultThemeIconCacheFail;
+            }
+
+            out_icon_path = icon_cache_path;
+            return ResultSuccess;
+        }
+
+        struct ThemeCatalogItem {
+            u64 theme_size;
+            u64 theme_mtime;
+            Result load_rc;
+            Theme theme;
+        };
+
+        using ThemeCatalog = std::unordered_map<std::string, ThemeCatalogItem>;
+
+        inline void AppendThemeCatalogString(std::vector<u8> &data, const std::string &str) {
+            const auto str_len = static_cast<u32>(str.length());
+            const auto str_offset = data.size();
+            data.resize(str_offset + sizeof(str_len) + str_len);
+            memcpy(data.data() + str_offset, &str_len, sizeof(str_len));
+            memcpy(data.data() + str_offset + sizeof(str_len), str.c_str(), str_len);
+        }
+
+        inline bool ReadThemeCatalogString(const std::vector<u8> &data, size_t &cur_offset, std::string &out_str) {
+            u32 str_len;
+            if((cur_offset + sizeof(str_len)) > data.size()) {
+                return false;
+            }
+            memcpy(&str_len, data.data() + cur_offset, sizeof(str_len));
+            cur_offset += sizeof(str_len);
+            if((cur_offset + str_len) > data.size()) {
+                return false;
+            }
+            out_str.assign(reinterpret_cast<const char*>(data.data() + cur_offset), str_len);
+            cur_offset += str_len;
+            return true;
+        }
+
+        bool ReadThemeCatalog(ThemeCatalog &out_catalog) {
+            std::vector<u8> catalog_data;
+            if(!fs::ReadFileContents(ThemeCatalogPath, catalog_data) || (catalog_data.size() < sizeof(ThemeCatalogHeader))) {
+                return false;
+            }
+
+            ThemeCatalogHeader header;
+            memcpy(&header, catalog_data.data(), sizeof(header));
+            if(!header.IsValid() || (header.data_size != (catalog_data.size() - sizeof(header)))) {
+                return false;
+            }
+            if(crc32Calculate(catalog_data.data() + sizeof(header), header.data_size) != header.data_crc32) {
+                return false;
+            }
+
+            // Every entry takes at least its header and string lengths
+            constexpr auto MinThemeCatalogEntrySize = sizeof(ThemeCatalogEntry) + 6 * sizeof(u32);
+            if(header.entry_count > (header.data_size / MinThemeCatalogEntrySize)) {
+                return false;
+            }
+
+            out_catalog.reserve(header.entry_count);
+            size_t cur_offset = sizeof(header);
+            for(u32 i = 0; i < header.entry_count; i++) {
+                ThemeCatalogEntry entry;
+                if((cur_offset + sizeof(entry)) > catalog_data.size()) {
+                    return false;
+                }
+                memcpy(&entry, catalog_data.data() + cur_offset, sizeof(entry));
+                cur_offset += sizeof(entry);
+
+                ThemeCatalogItem item = {
+                    .theme_size = entry.theme_size,
+                    .theme_mtime = entry.theme_mtime,
+                    .load_rc = entry.load_rc
+                };
+                item.theme.manifest.format_version = entry.format_version;
+                if(!ReadThemeCatalogString(catalog_data, cur_offset, item.theme.name)
+                    || !ReadThemeCatalogString(catalog_data, cur_offset, item.theme.manifest.name)
+                    || !ReadThemeCatalogString(catalog_data, cur_offset, item.theme.manifest.release)
+                    || !ReadThemeCatalogString(catalog_data, cur_offset, item.theme.manifest.description)
+                    || !ReadThemeCatalogString(catalog_data, cur_offset, item.theme.manifest.author)
+                    || !ReadThemeCatalogString(catalog_data, cur_offset, item.theme.icon_path)) {
+                    return false;
+                }
+
+                auto theme_name = item.theme.name;
+                out_catalog[std::move(theme_name)] = std::move(item);
+            }
+            return true;
         }
 
-        _THEME_MANIFEST_CHECK_GET_VALUE(format_version, u32, ResultThemeManifestVersionNotFound)
-        _THEME_MANIFEST_CHECK_GET_VALUE(name, std::string, ResultThemeManifestNameNotFound)
-        _THEME_MANIFEST_CHECK_GET_VALUE(author, std::string, ResultThemeManifestAuthorNotFound)
-        _THEME_MANIFEST_CHECK_GET_VALUE(description, std::string, ResultThemeManifestDescriptionNotFound)
-        _THEME_MANIFEST_CHECK_GET_VALUE(release, std::string, ResultThemeManifestReleaseNotFound)
+        void WriteThemeCatalog(const ThemeCatalog &catalog) {
+            std::vector<u8> catalog_data(sizeof(ThemeCatalogHeader));
+            for(const auto &[theme_name, item] : catalog) {
+                const ThemeCatalogEntry entry = {
+                    .theme_size = item.theme_size,
+                    .theme_mtime = item.theme_mtime,
+                    .load_rc = item.load_rc,
+                    .format_version = item.theme.manifest.format_version
+                };
+                const auto entry_offset = catalog_data.size();
+                catalog_data.resize(entry_offset + sizeof(entry));
+                memcpy(catalog_data.data() + entry_offset, &entry, sizeof(entry));
+
+                AppendThemeCatalogString(catalog_data, theme_name);
+                AppendThemeCatalogString(catalog_data, item.theme.manifest.name);
+                AppendThemeCatalogString(catalog_data, item.theme.manifest.release);
+                AppendThemeCatalogString(catalog_data, item.theme.manifest.description);
+                AppendThemeCatalogString(catalog_data, item.theme.manifest.author);
+                AppendThemeCatalogString(catalog_data, item.theme.icon_path);
+            }
+
+            const ThemeCatalogHeader header = {
+                .magic = ThemeCatalogHeader::Magic,
+                .version = ThemeCatalogHeader::CurrentVersion,
+                .entry_count = static_cast<u32>(catalog.size()),
+                .data_size = static_cast<u32>(catalog_data.size() - sizeof(ThemeCatalogHeader)),
+                .data_crc32 = crc32Calculate(catalog_data.data() + sizeof(ThemeCatalogHeader), catalog_data.size() - sizeof(ThemeCatalogHeader)),
+                .reserved = 0
+            };
+            memcpy(catalog_data.data(), &header, sizeof(header));
+
+            fs::CreateDirectory(ThemePreviewCachePath);
+            if(!fs::WriteFile(ThemeCatalogPath, catalog_data.data(), catalog_data.size(), true)) {
+                UL_LOG_WARN("Unable to save theme catalog");
+            }
+        }
+
+        ThemeCatalogItem LoadThemeCatalogItem(const std::string &theme_name, const std::string &theme_path, const u64 theme_size, const u64 theme_mtime) {
+            ThemeCatalogItem item = {
+                .theme_size = theme_size,
+                .theme_mtime = theme_mtime
+            };
+
+            auto theme_zip = zip_open(theme_path.c_str(), 0, 'r');
+            if(!theme_zip) {
+                item.load_rc = ResultInvalidThemeZipFile;
+                return item;
+            }
+            UL_ON_SCOPE_EXIT(
+                zip_close(theme_zip);
+            );
+
+            // Only themes actually listed need their icon cached
+            item.load_rc = LoadThemeManifest(theme_zip, theme_name, item.theme);
+            if(R_SUCCEEDED(item.load_rc) && !IsThemeOutdated(item.theme)) {
+                const auto rc = CacheThemeIcon(theme_zip, item.theme.icon_path);
+                if(R_FAILED(rc)) {
+                    UL_LOG_WARN("Theme '%s' unable to cache icon: %s", theme_name.c_str(), util::FormatResultDisplay(rc).c_str());
+                }
+            }
+            return item;
+        }
+
+        void RemoveUnusedThemeIcons(const ThemeCatalog &catalog) {
+            std::unordered_set<std::string> used_icon_paths;
+            for(const auto &[theme_name, item] : catalog) {
+                if(!item.theme.icon_path.empty()) {
+                    used_icon_paths.insert(item.theme.icon_path);
+                }
+            }
+
+            std::vector<std::string> unused_icon_paths;
+            UL_FS_FOR(ThemePreviewCachePath, icon_name, icon_path, is_dir, is_file, {
+                if(is_file && (icon_path != ThemeCatalogPath) && (used_icon_paths.count(icon_path) == 0)) {
+                    unused_icon_paths.push_back(icon_path);
+                }
+            });
+            for(const auto &icon_path: unused_icon_paths) {
+                fs::DeleteFile(icon_path);
+            }
+        }
 
-        out_theme.name = theme_name;
-        return ResultSuccess;
     }
 
-    Result TryCacheLoadThemeIcon(const Theme &theme, std::string &out_icon_path) {
-        const auto theme_path = fs::JoinPath(ThemesPath, theme.name);
+    Result TryLoadTheme(const std::string &theme_name, Theme &out_theme) {
+        const auto theme_path = fs::JoinPath(ThemesPath, theme_name);
         auto theme_zip = zip_open(theme_path.c_str(), 0, 'r');
         if(!theme_zip) {
             return ResultInvalidThemeZipFile;
@@ -65,70 +444,80 @@ namespace ul::cfg {
             zip_close(theme_zip);
         );
 
-        std::string icon_fmt;
-        for(const auto &fmt: ImageFormatList) {
-            const auto icon_path = fs::JoinPath("theme", "Icon." + std::string(fmt));
-            if(zip_entry_open(theme_zip, icon_path.c_str()) == 0) {
-                icon_fmt = fmt;
-                break;
-            }
-        }
-        if(icon_fmt.empty()) {
-            return ResultThemeIconNotFound;
-        }
-
-        void *icon_ptr;
-        size_t icon_ptr_size;
-        if(zip_entry_read(theme_zip, &icon_ptr, &icon_ptr_size) <= 0) {
-            return ResultInvalidThemeZipFileRead;
-        }
-
-        u8 hash[SHA256_HASH_SIZE] = {};
-        sha256CalculateHash(hash, icon_ptr, icon_ptr_size);
-        const auto icon_cache_path = fs::JoinPath(ThemePreviewCachePath, util::FormatSha256Hash(hash, true) + "." + icon_fmt);
+        return LoadThemeManifest(theme_zip, theme_name, out_theme);
+    }
 
-        fs::CreateDirectory(ThemePreviewCachePath);
-        if(!fs::WriteFile(icon_cache_path, icon_ptr, icon_ptr_size, true)) {
-            return ResultThemeIconCacheFail;
+    Result TryCacheLoadThemeIcon(const Theme &theme, std::string &out_icon_path) {
+        const auto theme_path = fs::JoinPath(ThemesPath, theme.name);
+        auto theme_zip = zip_open(theme_path.c_str(), 0, 'r');
+        if(!theme_zip) {
+            return ResultInvalidThemeZipFile;
         }
+        UL_ON_SCOPE_EXIT(
+            zip_close(theme_zip);
+        );
 
-        free(icon_ptr);
-        zip_entry_close(theme_zip);
-        out_icon_path = icon_cache_path;
-        return ResultSuccess;
+        return CacheThemeIcon(theme_zip, out_icon_path);
     }
 
     std::vector<Theme> FindThemes() {
+        // A missing or invalid catalog is just built again
+        ThemeCatalog old_catalog;
+        if(!ReadThemeCatalog(old_catalog)) {
+            old_catalog.clear();
+        }
+
+        ThemeCatalog catalog;
+        catalog.reserve(old_catalog.size());
+        auto catalog_changed = false;
         std::vector<Theme> themes;
-        Theme cur_theme;
         UL_FS_FOR(ThemesPath, name, path, is_dir, is_file, {
             if(is_file) {
-                const auto rc = TryLoadTheme(name, cur_theme);
-                if(R_SUCCEEDED(rc)) {
-                    if(!IsThemeOutdated(cur_theme)) {
-                        themes.push_back(cur_theme);
+                size_t theme_size;
+                u64 theme_mtime;
+                if(!fs::GetFileSizeAndModificationTime(path, theme_size, theme_mtime)) {
+                    continue;
+                }
+
+                // Unchanged theme zips are not opened at all (as long as their cached icon is still there)
+                ThemeCatalogItem item;
+                const auto old_item = old_catalog.find(name);
+                if((old_item != old_catalog.end()) && (old_item->second.theme_size == theme_size) && (old_item->second.theme_mtime == theme_mtime) && (old_item->second.theme.icon_path.empty() || fs::ExistsFile(old_item->second.theme.icon_path))) {
+                    item = old_item->second;
+                }
+                else {
+                    item = LoadThemeCatalogItem(name, path, theme_size, theme_mtime);
+                    catalog_changed = true;
+                }
+
+                if(R_SUCCEEDED(item.load_rc)) {
+                    if(!IsThemeOutdated(item.theme)) {
+                        themes.push_back(item.theme);
                     }
                     else {
-                        UL_LOG_WARN("Outdated theme file '%s': theme version %d != current version %d", name.c_str(), cur_theme.manifest.format_version, CurrentThemeFormatVersion);
+                        UL_LOG_WARN("Outdated theme file '%s': theme version %d != current version %d", name.c_str(), item.theme.manifest.format_version, CurrentThemeFormatVersion);
                     }
                 }
                 else {
-                    UL_LOG_WARN("Invalid theme file '%s': %s", name.c_str(), util::FormatResultDisplay(rc).c_str());
+                    UL_LOG_WARN("Invalid theme file '%s': %s", name.c_str(), util::FormatResultDisplay(item.load_rc).c_str());
                 }
+                catalog[name] = std::move(item);
             }
         });
+
+        // Removed themes also change the catalog
+        if(catalog_changed || (catalog.size() != old_catalog.size())) {
+            WriteThemeCatalog(catalog);
+            RemoveUnusedThemeIcons(catalog);
+        }
         return themes;
     }
 
     void CacheActiveTheme(const Config &cfg) {
-        RemoveActiveThemeCache();
-
-        std::string active_theme_name;
-        if(!cfg.GetEntry(ConfigEntryId::ActiveThemeName, active_theme_name)) {
-            UL_LOG_WARN("Unable to get active theme name from config...");
-        }
+        const auto &active_theme_name = cfg.GetEntry<ConfigEntryId::ActiveThemeName>();
         if(active_theme_name.empty()) {
             // Assume there is no custom theme
+            RemoveActiveThemeCache();
             return;
         }
 
@@ -136,45 +525,133 @@ namespace ul::cfg {
         auto zip_file = zip_open(active_theme_path.c_str(), 0, 'r');
         if(zip_file == nullptr) {
             UL_LOG_WARN("Unable to open theme path for cache... is the theme deleted?");
+            RemoveActiveThemeCache();
             return;
         }
+        UL_ON_SCOPE_EXIT(
+            zip_close(zip_file);
+        );
 
+        ActiveThemeCacheManifestHeader old_header;
+        ActiveThemeFileTable old_files;
+        auto manifest_present = ReadActiveThemeCacheManifest(old_header, old_files);
+        if(!manifest_present) {
+            // Unknown cache contents, start over
+            RemoveActiveThemeCache();
+            old_header = {};
+            old_files.clear();
+        }
+        const auto remove_manifest = [&]() {
+            if(manifest_present) {
+                fs::DeleteFile(ActiveThemeCacheManifestPath);
+                manifest_present = false;
+            }
+        };
+
+        ActiveThemeFileTable new_files;
+        std::unordered_set<std::string> created_dirs;
+        std::vector<u8> read_buf;
+        u32 extracted_count = 0;
+        u32 kept_count = 0;
+        u32 removed_count = 0;
         const auto file_count = zip_entries_total(zip_file);
-        if(file_count > 0) {
-            for(u32 i = 0; i < file_count; i++) {
-                const auto zip_rc = zip_entry_openbyindex(zip_file, i);
-                if(zip_rc != 0) {
-                    UL_LOG_WARN("Unable to open theme zip file index %d (from %d total): err %d", i, file_count, zip_rc);
+        for(s32 i = 0; i < file_count; i++) {
+            const auto zip_rc = zip_entry_openbyindex(zip_file, i);
+            if(zip_rc != 0) {
+                UL_LOG_WARN("Unable to open theme zip file index %d (from %d total): err %d", i, file_count, zip_rc);
+                continue;
+            }
+            UL_ON_SCOPE_EXIT(
+                zip_entry_close(zip_file);
+            );
+
+            // Directories are created along with the files inside them
+            if(zip_entry_isdir(zip_file)) {
+                continue;
+            }
+            const std::string entry_name = zip_entry_name(zip_file);
+            if(!IsActiveThemeEntryPathValid(entry_name)) {
+                UL_LOG_WARN("Skipping invalid theme zip file path '%s'", entry_name.c_str());
+                continue;
+            }
+
+            const ActiveThemeFile file = {
+                .crc32 = zip_entry_crc32(zip_file),
+                .size = zip_entry_size(zip_file)
+            };
+            const auto old_file_it = old_files.find(entry_name);
+            if(old_file_it != old_files.end()) {
+                const auto is_same = (old_file_it->second.crc32 == file.crc32) && (old_file_it->second.size == file.size);
+                old_files.erase(old_file_it);
+                if(is_same) {
+                    new_files[entry_name] = file;
+                    kept_count++;
                     continue;
                 }
+            }
 
-                const auto entry_path = fs::JoinPath(ActiveThemeCachePath, zip_entry_name(zip_file));
-                const auto is_dir = zip_entry_isdir(zip_file);
-                if(!is_dir) {
-                    void *read_buf;
-                    size_t read_buf_size;
-                    const auto read_size = zip_entry_read(zip_file, &read_buf, &read_buf_size);
-                    if(read_size <= 0) {
-                        UL_LOG_WARN("Unable to read theme zip file index %d (from %d total): err %d", i, file_count, read_size);
-                        continue;
-                    }
-                    if(!fs::WriteFile(entry_path, read_buf, read_buf_size, true)) {
-                        UL_LOG_WARN("Unable to save theme zip file index %d (from %d total) to '%s'...", i, file_count, entry_path.c_str());
-                    }
-                    free(read_buf);
+            remove_manifest();
+            read_buf.resize(file.size);
+            if(file.size > 0) {
+                const auto read_size = zip_entry_noallocread(zip_file, read_buf.data(), read_buf.size());
+                if((read_size < 0) || (static_cast<u64>(read_size) != file.size)) {
+                    UL_LOG_WARN("Unable to read theme zip file index %d (from %d total): err %d", i, file_count, read_size);
+                    continue;
                 }
-                zip_entry_close(zip_file);
             }
+
+            EnsureActiveThemeEntryDirectories(entry_name, created_dirs);
+            const auto entry_path = fs::JoinPath(ActiveThemeCachePath, entry_name);
+            if(!fs::WriteFile(entry_path, read_buf.data(), read_buf.size(), true)) {
+                UL_LOG_WARN("Unable to save theme zip file index %d (from %d total) to '%s'...", i, file_count, entry_path.c_str());
+                continue;
+            }
+            new_files[entry_name] = file;
+            extracted_count++;
+        }
+
+        // Anything left isn't part of this theme
+        for(const auto &[entry_name, file] : old_files) {
+            remove_manifest();
+            fs::DeleteFile(fs::JoinPath(ActiveThemeCachePath, entry_name));
+            removed_count++;
+        }
+
+        size_t theme_size = 0;
+        u64 theme_mtime = 0;
+        fs::GetFileSizeAndModificationTime(active_theme_path, theme_size, theme_mtime);
+        ActiveThemeCacheManifestHeader header = {
+            .magic = ActiveThemeCacheManifestHeader::Magic,
+            .version = ActiveThemeCacheManifestHeader::CurrentVersion,
+            .entry_count = static_cast<u32>(new_files.size()),
+            .theme_size = theme_size,
+            .theme_mtime = theme_mtime
+        };
+        util::CopyToStringBuffer(header.theme_name, active_theme_name);
+        if(!manifest_present || (old_header.theme_size != header.theme_size) || (old_header.theme_mtime != header.theme_mtime) || (active_theme_name != old_header.theme_name)) {
+            WriteActiveThemeCacheManifest(header, new_files);
         }
-        zip_close(zip_file);
+
+        UL_LOG_INFO("Cached active theme '%s': %d files extracted, %d kept, %d removed", active_theme_name.c_str(), extracted_count, kept_count, removed_count);
     }
 
     void EnsureCacheActiveTheme(const Config &cfg) {
-        const auto manifest_path = fs::JoinPath(ActiveThemeCachePath, ThemeManifestPath);
-        // This should be enough to check whether the extracted active theme was removed
-        if(!fs::ExistsFile(manifest_path)) {
-            CacheActiveTheme(cfg);
+        const auto &active_theme_name = cfg.GetEntry<ConfigEntryId::ActiveThemeName>();
+
+        // Checking the manifest is enough, no need to open the theme zip
+        ActiveThemeCacheManifestHeader header;
+        if(fs::ReadFile(ActiveThemeCacheManifestPath, &header, sizeof(header)) && header.IsValid()) {
+            header.theme_name[sizeof(header.theme_name) - 1] = '\0';
+            size_t theme_size;
+            u64 theme_mtime;
+            const auto is_same_theme = (active_theme_name == header.theme_name) && fs::GetFileSizeAndModificationTime(fs::JoinPath(ThemesPath, active_theme_name), theme_size, theme_mtime) && (header.theme_size == theme_size) && (header.theme_mtime == theme_mtime);
+            // This should be enough to check whether the extracted active theme was removed
+            if(is_same_theme && fs::ExistsFile(fs::JoinPath(ActiveThemeCachePath, ThemeManifestPath))) {
+                return;
+            }
         }
+
+        CacheActiveTheme(cfg);
     }
 
     void RemoveActiveThemeCache() {
@@ -229,86 +706,148 @@ namespace ul::cfg {
     }
 
     Config LoadConfig() {
+        // A leftover temporary config is a complete save which wasn't moved in place yet
+        const std::string cfg_paths[] = { ConfigPath, GetTemporaryConfigPath(), GetBackupConfigPath() };
         Config cfg = {};
-        const auto cfg_file_size = fs::GetFileSize(ConfigPath);
-        auto cfg_file_buf = new u8[cfg_file_size]();
-        if(fs::ReadFile(ConfigPath, cfg_file_buf, cfg_file_size)) {
-            size_t cur_offset = 0;
-            const auto cfg_header = *reinterpret_cast<ConfigHeader*>(cfg_file_buf);
-            if(cfg_header.magic == ConfigHeader::Magic) {
-                cur_offset += sizeof(ConfigHeader);
-                if(cur_offset <= cfg_file_size) {
-                    cfg.entries.reserve(cfg_header.entry_count);
-                    for(u32 i = 0; i < cfg_header.entry_count; i++) {
-                        ConfigEntry ent = {};
-                        ent.header = *reinterpret_cast<ConfigEntryHeader*>(cfg_file_buf + cur_offset);
-                        cur_offset += sizeof(ConfigEntryHeader);
-                        if(cur_offset > cfg_file_size) {
-                            break;
-                        }
-                        switch(ent.header.type) {
-                            case ConfigEntryType::Bool: {
-                                if(ent.header.size != sizeof(bool)) {
-                                    return CreateNewAndLoadConfig();
-                                }
-                                ent.bool_value = *reinterpret_cast<bool*>(cfg_file_buf + cur_offset);
-                                break;
-                            }
-                            case ConfigEntryType::U64: {
-                                if(ent.header.size != sizeof(u64)) {
-                                    return CreateNewAndLoadConfig();
-                                }
-                                ent.u64_value = *reinterpret_cast<u64*>(cfg_file_buf + cur_offset);
-                                break;
-                            }
-                            case ConfigEntryType::String: {
-                                if(ent.header.size == 0) {
-                                    ent.str_value = "";
-                                }
-                                else {
-                                    ent.str_value = std::string(reinterpret_cast<char*>(cfg_file_buf + cur_offset), ent.header.size);
-                                }
-                                break;
-                            }
-                        }
-                        cur_offset += ent.header.size;
-                        if(cur_offset > cfg_file_size) {
-                            break;
-                        }
-                        cfg.entries.push_back(std::move(ent));
-                    }
-                    if(cur_offset <= cfg_file_size) {
-                        return cfg;
-                    }
+        for(const auto &cfg_path: cfg_paths) {
+            if(TryLoadConfigFile(cfg_path, cfg)) {
+                if(cfg_path != ConfigPath) {
+                    UL_LOG_WARN("Config restored from '%s'", cfg_path.c_str());
+                    SaveConfig(cfg);
                 }
+                return cfg;
             }
         }
+
         return CreateNewAndLoadConfig();
     }
 
-    void SaveConfig(const Config &cfg) {
-        const ConfigHeader cfg_header = {
-            .magic = ConfigHeader::Magic,
-            .entry_count = static_cast<u32>(cfg.entries.size())
-        };
-        fs::WriteFile(ConfigPath, &cfg_header, sizeof(cfg_header), true);
-        for(const auto &entry : cfg.entries) {
-            fs::WriteFile(ConfigPath, &entry.header, sizeof(entry.header), false);
-            switch(entry.header.type) {
+    bool ApplyConfigEntryDelta(Config &cfg, const ConfigEntryDelta &delta) {
+        if(!IsKnownConfigEntryId(delta.id)) {
+            return false;
+        }
+
+        const auto &schema = GetConfigEntrySchema(delta.id);
+        auto &value = cfg.values[static_cast<size_t>(delta.id)];
+        switch(schema.type) {
+            case ConfigEntryType::Bool: {
+                value.bool_value = delta.u64_value != 0;
+                break;
+            }
+            case ConfigEntryType::U64: {
+                if(!IsConfigEntryValueValid(schema, delta.u64_value)) {
+                    return false;
+                }
+                value.u64_value = delta.u64_value;
+                break;
+            }
+            case ConfigEntryType::String: {
+                const std::string str_value(delta.str_value, strnlen(delta.str_value, sizeof(delta.str_value)));
+                if(!IsConfigEntryValueValid(schema, str_value)) {
+                    return false;
+                }
+                value.str_value = str_value;
+                break;
+            }
+        }
+        cfg.set_entry_mask |= BIT(static_cast<u32>(delta.id));
+        return true;
+    }
+
+    void SerializeConfig(const Config &cfg, std::vector<u8> &out_data) {
+        out_data.assign(sizeof(ConfigHeader), 0);
+        u32 entry_count = 0;
+        for(const auto &schema : ConfigSchema) {
+            if(!cfg.IsEntrySet(schema.id)) {
+                continue;
+            }
+
+            const auto &value = cfg.values[static_cast<size_t>(schema.id)];
+            ConfigEntryHeader ent_header = {
+                .id = schema.id,
+                .type = schema.type
+            };
+            switch(schema.type) {
                 case ConfigEntryType::Bool: {
-                    fs::WriteFile(ConfigPath, &entry.bool_value, sizeof(entry.bool_value), false);
+                    ent_header.size = sizeof(value.bool_value);
                     break;
                 }
                 case ConfigEntryType::U64: {
-                    fs::WriteFile(ConfigPath, &entry.u64_value, sizeof(entry.u64_value), false);
+                    ent_header.size = sizeof(value.u64_value);
                     break;
                 }
                 case ConfigEntryType::String: {
-                    fs::WriteFile(ConfigPath, entry.str_value.c_str(), entry.str_value.length(), false);
+                    ent_header.size = static_cast<u8>(std::min(value.str_value.length(), ConfigEntryMaxStringLength));
                     break;
                 }
             }
+
+            const auto entry_offset = out_data.size();
+            out_data.resize(entry_offset + sizeof(ent_header) + ent_header.size);
+            auto entry_data = out_data.data() + entry_offset;
+            memcpy(entry_data, &ent_header, sizeof(ent_header));
+            entry_data += sizeof(ent_header);
+            switch(schema.type) {
+                case ConfigEntryType::Bool: {
+                    memcpy(entry_data, &value.bool_value, sizeof(value.bool_value));
+                    break;
+                }
+                case ConfigEntryType::U64: {
+                    memcpy(entry_data, &value.u64_value, sizeof(value.u64_value));
+                    break;
+                }
+                case ConfigEntryType::String: {
+                    memcpy(entry_data, value.str_value.c_str(), ent_header.size);
+                    break;
+                }
+            }
+            entry_count++;
         }
+
+        const ConfigHeader cfg_header = {
+            .magic = ConfigHeader::Magic,
+            .version = ConfigHeader::CurrentVersion,
+            .entry_count = entry_count,
+            .data_size = static_cast<u32>(out_data.size() - sizeof(ConfigHeader)),
+            .data_crc32 = crc32Calculate(out_data.data() + sizeof(ConfigHeader), out_data.size() - sizeof(ConfigHeader)),
+            .reserved = 0
+        };
+        memcpy(out_data.data(), &cfg_header, sizeof(cfg_header));
+    }
+
+    bool DeserializeConfig(const u8 *data, const size_t data_size, Config &out_cfg) {
+        if(data_size < sizeof(ConfigHeader)) {
+            return false;
+        }
+
+        ConfigHeader cfg_header;
+        memcpy(&cfg_header, data, sizeof(cfg_header));
+        if(!cfg_header.IsValid() || (cfg_header.data_size > (data_size - sizeof(ConfigHeader)))) {
+            return false;
+        }
+        if(crc32Calculate(data + sizeof(ConfigHeader), cfg_header.data_size) != cfg_header.data_crc32) {
+            return false;
+        }
+        return ParseConfigEntries(data + sizeof(ConfigHeader), cfg_header.data_size, cfg_header.entry_count, out_cfg);
     }
 
+    void SaveConfig(const Config &cfg) {
+        std::vector<u8> cfg_data;
+        SerializeConfig(cfg, cfg_data);
+
+        // Renaming over an existing file isn't supported by every filesystem, thus the previous config is moved away first (and kept as the backup)
+        const auto tmp_cfg_path = GetTemporaryConfigPath();
+        const auto bak_cfg_path = GetBackupConfigPath();
+        if(!fs::WriteFile(tmp_cfg_path, cfg_data.data(), cfg_data.size(), true)) {
+            UL_LOG_WARN("Unable to write config to '%s'", tmp_cfg_path.c_str());
+            return;
+        }
+        if(fs::ExistsFile(ConfigPath)) {
+            fs::DeleteFile(bak_cfg_path);
+            fs::RenameFile(std::string(ConfigPath), bak_cfg_path);
+        }
+        if(!fs::RenameFile(tmp_cfg_path, std::string(ConfigPath))) {
+            UL_LOG_WARN("Unable to move config in place");
+        }
+    }
 }
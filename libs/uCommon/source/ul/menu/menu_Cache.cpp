@@ -1,124 +1,1628 @@
 #include <ul/menu/menu_Cache.hpp>
+#include <ul/menu/menu_IconPack.hpp>
+#include <ul/menu/menu_ControlStrings.hpp>
+#include <ul/util/util_Lz4.hpp>
+#include <ul/ul_Result.hpp>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <deque>
+#include <atomic>
+#include <algorithm>
 
 namespace ul::menu {
 
     namespace {
 
-        // Identify homebrews by hashing their path and file size (the latter to re-cache basically any NROs that get modified)
+        u32 g_CacheWorkerCount = DefaultCacheWorkerCount;
+        // Caching/verifying (by different uSystem threads) never overlap for the same cache
+        RecursiveMutex g_ApplicationCacheLock;
+        RecursiveMutex g_HomebrewCacheLock;
 
-        struct HomebrewCacheHashContext {
-            char nro_path[FS_MAX_PATH];
-            size_t file_size;
+        IconPack g_ApplicationIconPack(ApplicationCachePath);
+        IconPack g_HomebrewIconPack(HomebrewCachePath);
+        IconPack g_ApplicationScaledIconPack(ApplicationCachePath, ScaledIconPackName);
+        IconPack g_HomebrewScaledIconPack(HomebrewCachePath, ScaledIconPackName);
+        Mutex g_ScaledIconPackOpenLock;
+
+        ControlStringsIndex g_ApplicationControlStrings(fs::JoinPath(ApplicationCachePath, ControlStringsIndexFileName));
+        ControlStringsIndex g_HomebrewControlStrings(fs::JoinPath(HomebrewCachePath, ControlStringsIndexFileName));
+
+        u64 g_CacheBudgetSize = DefaultCacheBudgetSize;
+        std::atomic<u64> g_IconHitCount = 0;
+        std::atomic<u64> g_IconMissCount = 0;
+        std::atomic<u64> g_ScaledIconHitCount = 0;
+        std::atomic<u64> g_ScaledIconMissCount = 0;
+        std::atomic<u64> g_StringsHitCount = 0;
+        std::atomic<u64> g_StringsMissCount = 0;
+
+        inline bool CountCacheLookup(const bool hit, std::atomic<u64> &hit_count, std::atomic<u64> &miss_count) {
+            (hit ? hit_count : miss_count)++;
+            return hit;
+        }
+
+        bool EnsureScaledIconPackOpen(IconPack &src_pack, IconPack &scaled_pack) {
+            ScopedLock lk(g_ScaledIconPackOpenLock);
+            if(!scaled_pack.IsOpen()) {
+                if(!scaled_pack.Open(true)) {
+                    return false;
+                }
+
+                // Icons removed from the cache meanwhile (like uninstalled applications) are dropped here, since this is the only side writing to scaled packs
+                IconPackIndexEntry src_entry;
+                for(const auto key: scaled_pack.ListKeys()) {
+                    if(!src_pack.Find(key, src_entry)) {
+                        scaled_pack.Remove(key);
+                    }
+                }
+                if(scaled_pack.NeedsCompaction()) {
+                    scaled_pack.Compact();
+                }
+            }
+            return true;
+        }
+
+        bool ReadScaledIcon(IconPack &src_pack, IconPack &scaled_pack, const u64 key, const u32 size, std::vector<u8> &out_rgba_data) {
+            IconPackIndexEntry src_entry;
+            if(!src_pack.Find(key, src_entry) || !EnsureScaledIconPackOpen(src_pack, scaled_pack)) {
+                return false;
+            }
+
+            std::vector<u8> scaled_data;
+            if(!scaled_pack.Read(key, scaled_data) || (scaled_data.size() < sizeof(ScaledCacheIconHeader))) {
+                return false;
+            }
+
+            ScaledCacheIconHeader header;
+            memcpy(&header, scaled_data.data(), sizeof(header));
+            if((header.source_crc32 != src_entry.data_crc32) || (header.size != size) || (header.rgba_size != (size * size * 4))) {
+                return false;
+            }
+
+            out_rgba_data.resize(header.rgba_size);
+            return util::DecompressLz4(scaled_data.data() + sizeof(header), scaled_data.size() - sizeof(header), out_rgba_data.data(), out_rgba_data.size());
+        }
+
+        bool WriteScaledIcon(IconPack &src_pack, IconPack &scaled_pack, const u64 key, const u32 size, const std::vector<u8> &rgba_data) {
+            IconPackIndexEntry src_entry;
+            if((rgba_data.size() != (size * size * 4)) || !src_pack.Find(key, src_entry) || !EnsureScaledIconPackOpen(src_pack, scaled_pack)) {
+                return false;
+            }
+
+            std::vector<u8> scaled_data(sizeof(ScaledCacheIconHeader) + util::GetLz4CompressBound(rgba_data.size()));
+            const auto compressed_size = util::CompressLz4(rgba_data.data(), rgba_data.size(), scaled_data.data() + sizeof(ScaledCacheIconHeader), scaled_data.size() - sizeof(ScaledCacheIconHeader));
+            if(compressed_size == 0) {
+                return false;
+            }
+            scaled_data.resize(sizeof(ScaledCacheIconHeader) + compressed_size);
+
+            const ScaledCacheIconHeader header = {
+                .source_crc32 = src_entry.data_crc32,
+                .size = size,
+                .rgba_size = static_cast<u32>(rgba_data.size()),
+                .reserved = 0
+            };
+            memcpy(scaled_data.data(), &header, sizeof(header));
+            return scaled_pack.Put(key, scaled_data.data(), scaled_data.size());
+        }
+
+        // Items are produced by the calling thread (walking directories, listing records...) and consumed by the workers through a bounded queue
+        // Workers are spread over the cores the process may use other than the caller's one, with no workers (or no such cores) items are just processed by the caller
+
+        template<typename T>
+        class CacheWorkerPipeline {
+            public:
+                using WorkerFunction = std::function<void(const u32, T&)>;
+
+                static constexpr size_t QueueCapacity = 32;
+                static constexpr size_t WorkerStackSize = 0x8000;
+                static constexpr int WorkerPriority = 0x2C;
+
+            private:
+                struct Worker {
+                    CacheWorkerPipeline *pipeline;
+                    u32 idx;
+                    Thread thread;
+                };
+
+                WorkerFunction worker_fn;
+                std::vector<Worker> workers;
+                std::deque<T> queue;
+                ::Mutex lock;
+                CondVar queue_not_empty_cv;
+                CondVar queue_not_full_cv;
+                bool finished;
+
+                static void WorkerMain(void *worker_ptr) {
+                    auto worker = reinterpret_cast<Worker*>(worker_ptr);
+                    auto pipeline = worker->pipeline;
+                    while(true) {
+                        mutexLock(&pipeline->lock);
+                        while(pipeline->queue.empty() && !pipeline->finished) {
+                            condvarWait(&pipeline->queue_not_empty_cv, &pipeline->lock);
+                        }
+                        if(pipeline->queue.empty()) {
+                            mutexUnlock(&pipeline->lock);
+                            break;
+                        }
+
+                        auto item = std::move(pipeline->queue.front());
+                        pipeline->queue.pop_front();
+                        condvarWakeOne(&pipeline->queue_not_full_cv);
+                        mutexUnlock(&pipeline->lock);
+
+                        pipeline->worker_fn(worker->idx, item);
+                    }
+                }
+
+            public:
+                CacheWorkerPipeline(const u32 worker_count, WorkerFunction worker_fn) : worker_fn(worker_fn), workers(), queue(), finished(false) {
+                    mutexInit(&this->lock);
+                    condvarInit(&this->queue_not_empty_cv);
+                    condvarInit(&this->queue_not_full_cv);
+
+                    u64 core_mask = 0;
+                    if(R_FAILED(svcGetInfo(&core_mask, InfoType_CoreMask, CUR_PROCESS_HANDLE, 0))) {
+                        core_mask = 0;
+                    }
+                    const auto cur_core = svcGetCurrentProcessorNumber();
+                    std::vector<int> worker_cores;
+                    for(u32 i = 0; i < 64; i++) {
+                        if((core_mask & BIT(i)) && (i != cur_core)) {
+                            worker_cores.push_back(i);
+                        }
+                    }
+                    if(worker_cores.empty()) {
+                        // Workers sharing the caller's core would just add context switches
+                        if(worker_count > 0) {
+                            UL_LOG_INFO("No other cores available for cache workers, caching inline...");
+                        }
+                        return;
+                    }
+
+                    // Worker structures must not be moved once their threads are created
+                    this->workers.reserve(worker_count);
+                    for(u32 i = 0; i < worker_count; i++) {
+                        auto &worker = this->workers.emplace_back();
+                        worker.pipeline = this;
+                        worker.idx = i;
+                        if(R_FAILED(threadCreate(&worker.thread, &WorkerMain, &worker, nullptr, WorkerStackSize, WorkerPriority, worker_cores.at(i % worker_cores.size())))) {
+                            UL_LOG_WARN("Unable to create cache worker %d, continuing with %d workers...", i, i);
+                            this->workers.pop_back();
+                            break;
+                        }
+                        UL_RC_ASSERT(threadStart(&worker.thread));
+                    }
+                }
+
+                ~CacheWorkerPipeline() {
+                    this->Finish();
+                }
+
+                inline u32 GetWorkerCount() {
+                    return std::max<u32>(this->workers.size(), 1);
+                }
+
+                void Push(T &&item) {
+                    if(this->workers.empty()) {
+                        this->worker_fn(0, item);
+                        return;
+                    }
+
+                    mutexLock(&this->lock);
+                    while(this->queue.size() >= QueueCapacity) {
+                        condvarWait(&this->queue_not_full_cv, &this->lock);
+                    }
+                    this->queue.push_back(std::move(item));
+                    condvarWakeOne(&this->queue_not_empty_cv);
+                    mutexUnlock(&this->lock);
+                }
+
+                void Finish() {
+                    mutexLock(&this->lock);
+                    this->finished = true;
+                    condvarWakeAll(&this->queue_not_empty_cv);
+                    mutexUnlock(&this->lock);
+
+                    for(auto &worker: this->workers) {
+                        threadWaitForExit(&worker.thread);
+                        threadClose(&worker.thread);
+                    }
+                    this->workers.clear();
+                }
+        };
+
+        // Identify homebrews by hashing their path, while any changes to the NROs themselves are tracked by the manifest below
+
+        constexpr const char HomebrewCacheManifestFileName[] = "manifest.bin";
+
+        struct HomebrewCacheManifestHeader {
+            static constexpr u32 Magic = 0x43484C55; // "ULHC"
+            // Version 2: icons moved to the icon pack
+            static constexpr u32 CurrentVersion = 2;
+
+            u32 magic;
+            u32 version;
+            u32 record_count;
+            u32 data_size;
+
+            inline bool IsValid() const {
+                return (this->magic == Magic) && (this->version == CurrentVersion);
+            }
+        };
+        static_assert(sizeof(HomebrewCacheManifestHeader) == 0x10);
+
+        // Records are followed by their (non-NUL-terminated) NRO path
+        struct HomebrewCacheManifestRecord {
+            static constexpr u32 FlagEvicted = BIT(0);
+
+            u64 file_size;
+            s64 mod_time;
+            u32 nro_path_length;
+            u32 flags;
+        };
+        static_assert(sizeof(HomebrewCacheManifestRecord) == 0x18);
+
+        struct HomebrewCacheStatus {
+            u64 file_size;
+            s64 mod_time;
+
+            inline bool operator==(const HomebrewCacheStatus &other) const = default;
+        };
+
+        struct HomebrewCacheManifestEntry {
+            HomebrewCacheStatus status;
+            // Evicted NROs are still tracked, so that they aren't cached again on every boot
+            bool evicted;
+        };
+
+        using HomebrewCacheManifest = std::unordered_map<std::string, HomebrewCacheManifestEntry>;
+
+        inline std::string MakeHomebrewCacheManifestPath() {
+            return fs::JoinPath(HomebrewCachePath, HomebrewCacheManifestFileName);
+        }
+
+        bool ReadHomebrewCacheManifest(HomebrewCacheManifest &out_manifest) {
+            out_manifest.clear();
+
+            std::vector<u8> manifest_data;
+            if(!fs::ReadFileContents(MakeHomebrewCacheManifestPath(), manifest_data)) {
+                return false;
+            }
+
+            HomebrewCacheManifestHeader header;
+            if(manifest_data.size() < sizeof(header)) {
+                return false;
+            }
+            memcpy(&header, manifest_data.data(), sizeof(header));
+            if(!header.IsValid() || (header.data_size != (manifest_data.size() - sizeof(header)))) {
+                return false;
+            }
+
+            out_manifest.reserve(header.record_count);
+            size_t offset = sizeof(header);
+            for(u32 i = 0; i < header.record_count; i++) {
+                HomebrewCacheManifestRecord record;
+                if((offset + sizeof(record)) > manifest_data.size()) {
+                    out_manifest.clear();
+                    return false;
+                }
+                memcpy(&record, manifest_data.data() + offset, sizeof(record));
+                offset += sizeof(record);
+
+                if((offset + record.nro_path_length) > manifest_data.size()) {
+                    out_manifest.clear();
+                    return false;
+                }
+                std::string nro_path(reinterpret_cast<const char*>(manifest_data.data() + offset), record.nro_path_length);
+                offset += record.nro_path_length;
+
+                out_manifest[std::move(nro_path)] = {
+                    .status = {
+                        .file_size = record.file_size,
+                        .mod_time = record.mod_time
+                    },
+                    .evicted = (record.flags & HomebrewCacheManifestRecord::FlagEvicted) != 0
+                };
+            }
+
+            return true;
+        }
+
+        bool WriteHomebrewCacheManifest(const HomebrewCacheManifest &manifest) {
+            std::vector<u8> manifest_data(sizeof(HomebrewCacheManifestHeader));
+            for(const auto &[nro_path, entry]: manifest) {
+                const HomebrewCacheManifestRecord record = {
+                    .file_size = entry.status.file_size,
+                    .mod_time = entry.status.mod_time,
+                    .nro_path_length = static_cast<u32>(nro_path.length()),
+                    .flags = entry.evicted ? HomebrewCacheManifestRecord::FlagEvicted : 0
+                };
+                const auto record_ptr = reinterpret_cast<const u8*>(&record);
+                manifest_data.insert(manifest_data.end(), record_ptr, record_ptr + sizeof(record));
+                manifest_data.insert(manifest_data.end(), nro_path.begin(), nro_path.end());
+            }
+
+            const HomebrewCacheManifestHeader header = {
+                .magic = HomebrewCacheManifestHeader::Magic,
+                .version = HomebrewCacheManifestHeader::CurrentVersion,
+                .record_count = static_cast<u32>(manifest.size()),
+                .data_size = static_cast<u32>(manifest_data.size() - sizeof(HomebrewCacheManifestHeader))
+            };
+            memcpy(manifest_data.data(), &header, sizeof(header));
+            return fs::WriteFile(MakeHomebrewCacheManifestPath(), manifest_data.data(), manifest_data.size(), true);
+        }
+
+        // NRO path -> cache locations, since hashing the path (and checking for the cached NACP) on every lookup adds up over whole folders
+        // Entries are tied to the NRO status they were cached for: the caching side (which stats every NRO anyway) updates them, while readers just trust them
+
+        enum class HomebrewCacheNacpStatus : u8 {
+            Unknown,
+            Cached,
+            NotCached
         };
 
-        std::string GetHomebrewCachePath(const std::string &nro_path, const std::string &ext) {
-            HomebrewCacheHashContext cache_hash_ctx = {};
+        struct HomebrewCacheMemoEntry {
+            HomebrewCacheStatus status;
+            HomebrewCacheLocation location;
+            HomebrewCacheNacpStatus nacp_status;
+        };
 
-            util::CopyToStringBuffer(cache_hash_ctx.nro_path, nro_path);
-            cache_hash_ctx.file_size = fs::GetFileSize(nro_path);
+        std::unordered_map<std::string, HomebrewCacheMemoEntry> g_HomebrewCacheMemo;
+        Mutex g_HomebrewCacheMemoLock;
+
+        HomebrewCacheMemoEntry &FindHomebrewCacheMemoEntry(const std::string &nro_path) {
+            auto find_entry = g_HomebrewCacheMemo.find(nro_path);
+            if(find_entry != g_HomebrewCacheMemo.end()) {
+                return find_entry->second;
+            }
 
             u8 hash[SHA256_HASH_SIZE] = {};
-            sha256CalculateHash(hash, &cache_hash_ctx, sizeof(cache_hash_ctx));
+            sha256CalculateHash(hash, nro_path.c_str(), nro_path.length());
 
-            return fs::JoinPath(HomebrewCachePath, util::FormatSha256Hash(hash, true) + "." + ext);
+            HomebrewCacheMemoEntry entry = {
+                .status = {},
+                .location = {
+                    .nacp_path = fs::JoinPath(HomebrewCachePath, util::FormatSha256Hash(hash, true) + ".nacp")
+                },
+                .nacp_status = HomebrewCacheNacpStatus::Unknown
+            };
+            memcpy(&entry.location.icon_key, hash, sizeof(entry.location.icon_key));
+            return g_HomebrewCacheMemo.emplace(nro_path, std::move(entry)).first->second;
         }
 
-        void CacheHomebrewEntry(const std::string &nro_path) {
-            const auto cache_nro_icon_path = GetHomebrewCacheIconPath(nro_path);
-            const auto cache_nro_nacp_path = GetHomebrewCacheNacpPath(nro_path);
-            if(fs::ExistsFile(cache_nro_icon_path) && fs::ExistsFile(cache_nro_nacp_path)) {
-                // We know it's already cached
-                return;
+        void UpdateHomebrewCacheMemoStatus(const std::string &nro_path, const HomebrewCacheStatus &status) {
+            ScopedLock lk(g_HomebrewCacheMemoLock);
+            auto &entry = FindHomebrewCacheMemoEntry(nro_path);
+            if(!(entry.status == status)) {
+                entry.status = status;
+                entry.nacp_status = HomebrewCacheNacpStatus::Unknown;
+            }
+        }
+
+        void SetHomebrewCacheMemoNacpStatus(const std::string &nro_path, const HomebrewCacheNacpStatus nacp_status) {
+            ScopedLock lk(g_HomebrewCacheMemoLock);
+            FindHomebrewCacheMemoEntry(nro_path).nacp_status = nacp_status;
+        }
+
+        inline u64 GetHomebrewCacheIconKey(const std::string &nro_path) {
+            ScopedLock lk(g_HomebrewCacheMemoLock);
+            return FindHomebrewCacheMemoEntry(nro_path).location.icon_key;
+        }
+
+        // The asset header is right after the executable, and the icon/NACP (almost always) right after it, back to back
+        // Thus, after reading the start/header and seeking to the asset header, both assets are read at once (and with no extra seek)
+
+        // Anything bigger than this is considered corrupted
+        constexpr u64 NroAssetMaxReadSize = 0x100000;
+
+        // Reused across NROs (every cache worker has its own)
+        struct NroExtractScratch {
+            std::vector<u8> asset_data;
+            NacpStruct nacp;
+        };
+
+        inline bool IsNroAssetSectionValid(const NroAssetSection &section) {
+            return (section.offset >= sizeof(NroAssetHeader)) && (section.size > 0);
+        }
+
+        // The read data starts at out_asset_data_offset (relative to the asset header)
+        bool ReadNroAssets(FILE *f, std::vector<u8> &asset_data, NroAssetHeader &out_asset_header, u64 &out_asset_data_offset) {
+            struct {
+                NroStart start;
+                NroHeader header;
+            } nro_start;
+            if(fread(&nro_start, sizeof(nro_start), 1, f) != 1) {
+                return false;
+            }
+            if(fseek(f, nro_start.header.size, SEEK_SET) != 0) {
+                return false;
+            }
+            if(fread(&out_asset_header, sizeof(out_asset_header), 1, f) != 1) {
+                return false;
+            }
+            if(out_asset_header.magic != NROASSETHEADER_MAGIC) {
+                return false;
+            }
+
+            u64 assets_start = UINT64_MAX;
+            u64 assets_end = 0;
+            for(const auto &section: { out_asset_header.icon, out_asset_header.nacp }) {
+                if(IsNroAssetSectionValid(section)) {
+                    assets_start = std::min(assets_start, section.offset);
+                    assets_end = std::max(assets_end, section.offset + section.size);
+                }
             }
+            if(assets_end == 0) {
+                return true;
+            }
+            if((assets_end - assets_start) > NroAssetMaxReadSize) {
+                return false;
+            }
+
+            if((assets_start != sizeof(NroAssetHeader)) && (fseek(f, nro_start.header.size + assets_start, SEEK_SET) != 0)) {
+                return false;
+            }
+            if(asset_data.size() < (assets_end - assets_start)) {
+                asset_data.resize(assets_end - assets_start);
+            }
+            out_asset_data_offset = assets_start;
+            return fread(asset_data.data(), assets_end - assets_start, 1, f) == 1;
+        }
+
+        void ExtractHomebrewCache(const std::string &nro_path, NroExtractScratch &scratch) {
+            const auto location = GetHomebrewCacheLocation(nro_path);
+            // Anything cached from a previous version of the NRO is gone, even if the new one lacks it
+            auto icon_cached = false;
+            auto nacp_cached = false;
+            ControlStrings strs;
+            auto strs_resolved = false;
+            fs::DeleteFile(location.nacp_path);
 
             auto f = fopen(nro_path.c_str(), "rb");
             if(f) {
-                if(fseek(f, sizeof(NroStart), SEEK_SET) == 0) {
-                    NroHeader header = {};
-                    if(fread(&header, sizeof(header), 1, f) == 1) {
-                        if(fseek(f, header.size, SEEK_SET) == 0) {
-                            NroAssetHeader asset_header = {};
-                            if(fread(&asset_header, sizeof(asset_header), 1, f) == 1) {
-                                if(asset_header.magic == NROASSETHEADER_MAGIC) {
-                                    if(!fs::ExistsFile(cache_nro_icon_path) && (asset_header.icon.offset > 0) && (asset_header.icon.size > 0)) {
-                                        auto icon_buf = new u8[asset_header.icon.size]();
-                                        if(fseek(f, header.size + asset_header.icon.offset, SEEK_SET) == 0) {
-                                            if(fread(icon_buf, asset_header.icon.size, 1, f) == 1) {
-                                                fs::WriteFile(cache_nro_icon_path, icon_buf, asset_header.icon.size, true);
-                                            }
-                                        }
-                                        delete[] icon_buf;
-                                    }
-                                    if(!fs::ExistsFile(cache_nro_nacp_path) && (asset_header.nacp.offset > 0) && (asset_header.nacp.size > 0)) {
-                                        auto nacp_buf = new u8[asset_header.nacp.size]();
-                                        if(fseek(f, header.size + asset_header.nacp.offset, SEEK_SET) == 0) {
-                                            if(fread(nacp_buf, asset_header.nacp.size, 1, f) == 1) {
-                                                fs::WriteFile(cache_nro_nacp_path, nacp_buf, asset_header.nacp.size, true);
-                                            }
-                                        }
-                                        delete[] nacp_buf;
-                                    }
-                                }
-                            }
-                        }
+                NroAssetHeader asset_header;
+                u64 asset_data_offset;
+                const auto assets_read = ReadNroAssets(f, scratch.asset_data, asset_header, asset_data_offset);
+                fclose(f);
+
+                if(assets_read) {
+                    if(IsNroAssetSectionValid(asset_header.icon)) {
+                        icon_cached = g_HomebrewIconPack.Put(location.icon_key, scratch.asset_data.data() + (asset_header.icon.offset - asset_data_offset), asset_header.icon.size);
+                    }
+                    // Truncated NACPs would never be readable anyway
+                    if(IsNroAssetSectionValid(asset_header.nacp) && (asset_header.nacp.size >= sizeof(NacpStruct))) {
+                        memcpy(&scratch.nacp, scratch.asset_data.data() + (asset_header.nacp.offset - asset_data_offset), sizeof(NacpStruct));
+                        nacp_cached = fs::WriteFile(location.nacp_path, &scratch.nacp, sizeof(NacpStruct), true);
+                        strs_resolved = ResolveControlStrings(&scratch.nacp, strs);
                     }
                 }
-                fclose(f);
             }
+
+            if(!icon_cached) {
+                g_HomebrewIconPack.Remove(location.icon_key);
+            }
+            if(strs_resolved) {
+                g_HomebrewControlStrings.Set(location.icon_key, strs);
+            }
+            else {
+                g_HomebrewControlStrings.Remove(location.icon_key);
+            }
+            SetHomebrewCacheMemoNacpStatus(nro_path, nacp_cached ? HomebrewCacheNacpStatus::Cached : HomebrewCacheNacpStatus::NotCached);
+        }
+
+        bool CacheHomebrewEntry(const std::string &nro_path, const HomebrewCacheManifest &old_manifest, HomebrewCacheManifest &new_manifest, CacheWorkerPipeline<std::string> &pipeline) {
+            struct stat st;
+            if(stat(nro_path.c_str(), &st) != 0) {
+                return false;
+            }
+
+            const HomebrewCacheStatus status = {
+                .file_size = static_cast<u64>(st.st_size),
+                .mod_time = static_cast<s64>(st.st_mtime)
+            };
+            UpdateHomebrewCacheMemoStatus(nro_path, status);
+
+            // Only NROs which are new or changed (size/modification time) since they were last cached are actually read
+            const auto find_entry = old_manifest.find(nro_path);
+            if((find_entry != old_manifest.end()) && (find_entry->second.status == status)) {
+                new_manifest[nro_path] = find_entry->second;
+                return false;
+            }
+
+            new_manifest[nro_path] = {
+                .status = status,
+                .evicted = false
+            };
+
+            pipeline.Push(std::string(nro_path));
+            return true;
         }
 
-        void CacheHomebrewEntries(const std::string &hb_base_path) {
+        void CacheHomebrewEntries(const std::string &hb_base_path, const HomebrewCacheManifest &old_manifest, HomebrewCacheManifest &new_manifest, CacheWorkerPipeline<std::string> &pipeline, u32 &out_cached_count) {
             UL_FS_FOR(hb_base_path, name, path, is_dir, is_file, {
                 if(dt->d_type & DT_DIR) {
-                    CacheHomebrewEntries(path);
+                    CacheHomebrewEntries(path, old_manifest, new_manifest, pipeline, out_cached_count);
                 }
                 else if(util::StringEndsWith(name, ".nro")) {
-                    CacheHomebrewEntry(path);
+                    if(CacheHomebrewEntry(path, old_manifest, new_manifest, pipeline)) {
+                        out_cached_count++;
+                    }
+                }
+            });
+        }
+
+        // Applications are identified by their ID, while their cached control data is tied to their version and last record event (installs, updates, archiving...) through another manifest
+
+        constexpr const char ApplicationCacheManifestFileName[] = "manifest.bin";
+        constexpr size_t ApplicationContentMetaStatusCount = 0x10;
+
+        struct ApplicationCacheManifestHeader {
+            static constexpr u32 Magic = 0x43414C55; // "ULAC"
+            static constexpr u32 CurrentVersion = 1;
+
+            u32 magic;
+            u32 version;
+            u32 record_count;
+            u32 reserved;
+
+            inline bool IsValid() const {
+                return (this->magic == Magic) && (this->version == CurrentVersion);
+            }
+        };
+        static_assert(sizeof(ApplicationCacheManifestHeader) == 0x10);
+
+        struct ApplicationCacheManifestRecord {
+            u64 app_id;
+            u32 version;
+            u8 last_event;
+            u8 reserved[3];
+        };
+        static_assert(sizeof(ApplicationCacheManifestRecord) == 0x10);
+
+        struct ApplicationCacheStatus {
+            u32 version;
+            u8 last_event;
+
+            inline bool operator==(const ApplicationCacheStatus &other) const = default;
+        };
+
+        using ApplicationCacheManifest = std::unordered_map<u64, ApplicationCacheStatus>;
+
+        inline std::string MakeApplicationCacheManifestPath() {
+            return fs::JoinPath(ApplicationCachePath, ApplicationCacheManifestFileName);
+        }
+
+        bool ReadApplicationCacheManifest(ApplicationCacheManifest &out_manifest) {
+            out_manifest.clear();
+
+            std::vector<u8> manifest_data;
+            if(!fs::ReadFileContents(MakeApplicationCacheManifestPath(), manifest_data)) {
+                return false;
+            }
+
+            ApplicationCacheManifestHeader header;
+            if(manifest_data.size() < sizeof(header)) {
+                return false;
+            }
+            memcpy(&header, manifest_data.data(), sizeof(header));
+            if(!header.IsValid() || (manifest_data.size() != (sizeof(header) + header.record_count * sizeof(ApplicationCacheManifestRecord)))) {
+                return false;
+            }
+
+            out_manifest.reserve(header.record_count);
+            for(u32 i = 0; i < header.record_count; i++) {
+                ApplicationCacheManifestRecord record;
+                memcpy(&record, manifest_data.data() + sizeof(header) + i * sizeof(record), sizeof(record));
+                out_manifest[record.app_id] = {
+                    .version = record.version,
+                    .last_event = record.last_event
+                };
+            }
+
+            return true;
+        }
+
+        bool WriteApplicationCacheManifest(const ApplicationCacheManifest &manifest) {
+            std::vector<u8> manifest_data(sizeof(ApplicationCacheManifestHeader) + manifest.size() * sizeof(ApplicationCacheManifestRecord));
+            size_t offset = sizeof(ApplicationCacheManifestHeader);
+            for(const auto &[app_id, status]: manifest) {
+                const ApplicationCacheManifestRecord record = {
+                    .app_id = app_id,
+                    .version = status.version,
+                    .last_event = status.last_event,
+                    .reserved = {}
+                };
+                memcpy(manifest_data.data() + offset, &record, sizeof(record));
+                offset += sizeof(record);
+            }
+
+            const ApplicationCacheManifestHeader header = {
+                .magic = ApplicationCacheManifestHeader::Magic,
+                .version = ApplicationCacheManifestHeader::CurrentVersion,
+                .record_count = static_cast<u32>(manifest.size()),
+                .reserved = 0
+            };
+            memcpy(manifest_data.data(), &header, sizeof(header));
+            return fs::WriteFile(MakeApplicationCacheManifestPath(), manifest_data.data(), manifest_data.size(), true);
+        }
+
+        ApplicationCacheStatus GetApplicationCacheStatus(const NsApplicationRecord &record) {
+            // The installed version is the highest one among the base application and its update (add-ons don't change control data)
+            NsApplicationContentMetaStatus meta_statuses[ApplicationContentMetaStatusCount] = {};
+            s32 meta_status_count = 0;
+            if(R_FAILED(nsListApplicationContentMetaStatus(record.application_id, 0, meta_statuses, ApplicationContentMetaStatusCount, &meta_status_count))) {
+                meta_status_count = 0;
+            }
+
+            ApplicationCacheStatus status = {
+                .version = 0,
+                .last_event = record.type
+            };
+            for(s32 i = 0; i < meta_status_count; i++) {
+                if(meta_statuses[i].meta_type != NcmContentMetaType_AddOnContent) {
+                    status.version = std::max(status.version, meta_statuses[i].version);
+                }
+            }
+            return status;
+        }
+
+        // Homebrew last access times (by uMenu) are only updated once in a while, so that the file isn't rewritten on every folder load
+
+        constexpr const char HomebrewCacheAccessFileName[] = "access.bin";
+        constexpr s64 CacheAccessTimeGranularity = 60 * 60;
+
+        struct CacheAccessHeader {
+            static constexpr u32 Magic = 0x41434C55; // "ULCA"
+            static constexpr u32 CurrentVersion = 1;
+
+            u32 magic;
+            u32 version;
+            u32 record_count;
+            u32 reserved;
+
+            inline bool IsValid() const {
+                return (this->magic == Magic) && (this->version == CurrentVersion);
+            }
+        };
+        static_assert(sizeof(CacheAccessHeader) == 0x10);
+
+        struct CacheAccessRecord {
+            u64 key;
+            s64 access_time;
+        };
+        static_assert(sizeof(CacheAccessRecord) == 0x10);
+
+        using CacheAccessTable = std::unordered_map<u64, s64>;
+
+        CacheAccessTable g_HomebrewAccessTimes;
+        bool g_HomebrewAccessTimesLoaded = false;
+        bool g_HomebrewAccessTimesDirty = false;
+        Mutex g_HomebrewAccessTimesLock;
+
+        inline std::string MakeHomebrewCacheAccessPath() {
+            return fs::JoinPath(HomebrewCachePath, HomebrewCacheAccessFileName);
+        }
+
+        void ReadCacheAccessTable(const std::string &path, CacheAccessTable &out_table) {
+            out_table.clear();
+
+            std::vector<u8> access_data;
+            if(!fs::ReadFileContents(path, access_data) || (access_data.size() < sizeof(CacheAccessHeader))) {
+                return;
+            }
+
+            CacheAccessHeader header;
+            memcpy(&header, access_data.data(), sizeof(header));
+            if(!header.IsValid() || (access_data.size() != (sizeof(header) + header.record_count * sizeof(CacheAccessRecord)))) {
+                return;
+            }
+
+            out_table.reserve(header.record_count);
+            for(u32 i = 0; i < header.record_count; i++) {
+                CacheAccessRecord record;
+                memcpy(&record, access_data.data() + sizeof(header) + i * sizeof(record), sizeof(record));
+                out_table[record.key] = record.access_time;
+            }
+        }
+
+        bool WriteCacheAccessTable(const std::string &path, const CacheAccessTable &table) {
+            std::vector<u8> access_data(sizeof(CacheAccessHeader) + table.size() * sizeof(CacheAccessRecord));
+            size_t offset = sizeof(CacheAccessHeader);
+            for(const auto &[key, access_time]: table) {
+                const CacheAccessRecord record = {
+                    .key = key,
+                    .access_time = access_time
+                };
+                memcpy(access_data.data() + offset, &record, sizeof(record));
+                offset += sizeof(record);
+            }
+
+            const CacheAccessHeader header = {
+                .magic = CacheAccessHeader::Magic,
+                .version = CacheAccessHeader::CurrentVersion,
+                .record_count = static_cast<u32>(table.size()),
+                .reserved = 0
+            };
+            memcpy(access_data.data(), &header, sizeof(header));
+            return fs::WriteFile(path, access_data.data(), access_data.size(), true);
+        }
+
+        void NotifyHomebrewCacheAccess(const u64 icon_key) {
+            ScopedLock lk(g_HomebrewAccessTimesLock);
+            if(!g_HomebrewAccessTimesLoaded) {
+                ReadCacheAccessTable(MakeHomebrewCacheAccessPath(), g_HomebrewAccessTimes);
+                g_HomebrewAccessTimesLoaded = true;
+            }
+
+            const auto now = time(nullptr);
+            auto &access_time = g_HomebrewAccessTimes[icon_key];
+            if((now - access_time) >= CacheAccessTimeGranularity) {
+                access_time = now;
+                g_HomebrewAccessTimesDirty = true;
+            }
+        }
+
+        // Budget check results are saved by uSystem for others (uMenu) to show them
+
+        struct CacheBudgetStats {
+            static constexpr u32 Magic = 0x42434C55; // "ULCB"
+            static constexpr u32 CurrentVersion = 1;
+
+            u32 magic;
+            u32 version;
+            // Since the caches were reset
+            u64 eviction_count;
+            u64 evicted_size;
+            // As of the last check
+            u64 total_size;
+            u64 budget_size;
+
+            inline bool IsValid() const {
+                return (this->magic == Magic) && (this->version == CurrentVersion);
+            }
+        };
+        static_assert(sizeof(CacheBudgetStats) == 0x28);
+
+        u64 GetDirectorySize(const std::string &path) {
+            u64 size = 0;
+            UL_FS_FOR(path, name, entry_path, is_dir, is_file, {
+                if(is_dir) {
+                    size += GetDirectorySize(entry_path);
+                }
+                else {
+                    size += fs::GetFileSize(entry_path);
+                }
+            });
+            return size;
+        }
+
+        inline u64 GetIconPackEntrySize(IconPack &pack, const u64 key) {
+            IconPackIndexEntry entry;
+            return pack.Find(key, entry) ? (sizeof(IconPackRecordHeader) + entry.size) : 0;
+        }
+
+        inline size_t GetApplicationIconSize(const NsApplicationControlData *control_data) {
+            // The icon buffer is zero-padded after the actual JPEG (which always ends with a non-zero EOI marker)
+            size_t icon_size = sizeof(control_data->icon);
+            while((icon_size > 0) && (control_data->icon[icon_size - 1] == 0)) {
+                icon_size--;
+            }
+            return icon_size;
+        }
+
+        void StoreApplicationControlData(const u64 app_id, NsApplicationControlData *control_data) {
+            const auto icon_size = GetApplicationIconSize(control_data);
+            if(icon_size > 0) {
+                g_ApplicationIconPack.Put(app_id, control_data->icon, icon_size);
+            }
+            else {
+                g_ApplicationIconPack.Remove(app_id);
+            }
+            // Also cached, so that names/authors can be looked up without NS
+            fs::WriteFile(GetApplicationCacheNacpPath(app_id), &control_data->nacp, sizeof(control_data->nacp), true);
+
+            ControlStrings strs;
+            if(ResolveControlStrings(&control_data->nacp, strs)) {
+                g_ApplicationControlStrings.Set(app_id, strs);
+            }
+            else {
+                g_ApplicationControlStrings.Remove(app_id);
+            }
+        }
+
+        bool CacheApplicationEntry(const u64 app_id, NsApplicationControlData *tmp_control_data) {
+            fs::DeleteFile(GetApplicationCacheNacpPath(app_id));
+            if(R_FAILED(nsGetApplicationControlData(NsApplicationControlSource_Storage, app_id, tmp_control_data, sizeof(NsApplicationControlData), nullptr))) {
+                // Like gamecards not inserted: nothing of a previous version is kept, and it's retried later
+                g_ApplicationIconPack.Remove(app_id);
+                g_ApplicationControlStrings.Remove(app_id);
+                return false;
+            }
+
+            StoreApplicationControlData(app_id, tmp_control_data);
+            return true;
+        }
+
+        void CacheApplicationEntries(const std::vector<u64> &app_ids, std::vector<u64> &out_failed_app_ids) {
+            // Every worker has its own control data buffer
+            std::vector<NsApplicationControlData*> tmp_control_datas;
+            Mutex failed_app_ids_lock;
+            CacheWorkerPipeline<u64> pipeline(std::min<u32>(g_CacheWorkerCount, app_ids.size()), [&](const u32 worker_idx, u64 &app_id) {
+                if(!CacheApplicationEntry(app_id, tmp_control_datas.at(worker_idx))) {
+                    ScopedLock lk(failed_app_ids_lock);
+                    out_failed_app_ids.push_back(app_id);
                 }
             });
+            for(u32 i = 0; i < pipeline.GetWorkerCount(); i++) {
+                tmp_control_datas.push_back(new NsApplicationControlData());
+            }
+
+            for(const auto app_id: app_ids) {
+                pipeline.Push(u64(app_id));
+            }
+            pipeline.Finish();
+
+            for(auto &tmp_control_data: tmp_control_datas) {
+                delete tmp_control_data;
+            }
+        }
+
+        // Just the marker structure (up to the scan data), enough to tell truncated/garbage data apart from an actual JPEG
+
+        bool IsJpegStructureValid(const u8 *data, const size_t size) {
+            if((size < 4) || (data[0] != 0xFF) || (data[1] != 0xD8) || (data[size - 2] != 0xFF) || (data[size - 1] != 0xD9)) {
+                return false;
+            }
+
+            auto has_frame = false;
+            size_t offset = 2;
+            while((offset + 4) <= size) {
+                if(data[offset] != 0xFF) {
+                    return false;
+                }
+                const auto marker = data[offset + 1];
+                // Fill bytes
+                if(marker == 0xFF) {
+                    offset++;
+                    continue;
+                }
+                // Standalone markers (TEM, RSTn)
+                if((marker == 0x01) || ((marker >= 0xD0) && (marker <= 0xD7))) {
+                    offset += 2;
+                    continue;
+                }
+                if((marker == 0xD8) || (marker == 0xD9)) {
+                    return false;
+                }
+
+                const size_t segment_size = (data[offset + 2] << 8) | data[offset + 3];
+                if((segment_size < 2) || ((offset + 2 + segment_size) > size)) {
+                    return false;
+                }
+                // SOFn (other than DHT, JPG and DAC)
+                if((marker >= 0xC0) && (marker <= 0xCF) && (marker != 0xC4) && (marker != 0xC8) && (marker != 0xCC)) {
+                    if(segment_size < 8) {
+                        return false;
+                    }
+                    const auto height = (data[offset + 5] << 8) | data[offset + 6];
+                    const auto width = (data[offset + 7] << 8) | data[offset + 8];
+                    if((width == 0) || (height == 0)) {
+                        return false;
+                    }
+                    has_frame = true;
+                }
+                // SOS: entropy-coded data follows
+                if(marker == 0xDA) {
+                    return has_frame;
+                }
+                offset += 2 + segment_size;
+            }
+            return false;
+        }
+
+        struct CacheVerifyItem {
+            bool is_homebrew;
+            u64 app_id;
+            std::string nro_path;
+        };
+
+        struct CacheVerifyScratch {
+            std::vector<u8> icon_data;
+            NacpStruct nacp;
+            NroExtractScratch nro;
+            NsApplicationControlData control_data;
+        };
+
+        struct CachedEntryCheck {
+            // Cached data doesn't match itself (CRC32, sizes, strings not matching the NACP)
+            bool corrupted;
+            // Consistent, but not decodable (unless the source itself is like that, the cached data is wrong)
+            bool undecodable;
+            bool has_icon;
+            IconPackIndexEntry icon_entry;
+            bool has_nacp;
+        };
+
+        std::vector<CacheVerifyItem> g_CacheVerifyItems;
+        size_t g_CacheVerifyItemIndex = 0;
+        CacheVerifyScratch *g_CacheVerifyScratch = nullptr;
+        u32 g_CacheVerifyRepairedCount = 0;
+        u32 g_CacheVerifyDroppedCount = 0;
+
+        void CheckCachedEntry(IconPack &pack, ControlStringsIndex &strs_index, const u64 key, const std::string &nacp_path, CacheVerifyScratch &scratch, CachedEntryCheck &out_check) {
+            out_check = {};
+
+            out_check.has_icon = pack.Find(key, out_check.icon_entry);
+            if(out_check.has_icon) {
+                // The index (thus the CRC32) is rebuilt from verified records, but the data might have changed afterwards
+                if(!pack.Read(key, scratch.icon_data) || (crc32Calculate(scratch.icon_data.data(), scratch.icon_data.size()) != out_check.icon_entry.data_crc32)) {
+                    out_check.corrupted = true;
+                }
+                else if(!IsJpegStructureValid(scratch.icon_data.data(), scratch.icon_data.size())) {
+                    out_check.undecodable = true;
+                }
+            }
+
+            ControlStrings strs;
+            auto strs_resolved = false;
+            if(fs::ExistsFile(nacp_path)) {
+                out_check.has_nacp = (fs::GetFileSize(nacp_path) == sizeof(NacpStruct)) && fs::ReadFile(nacp_path, &scratch.nacp, sizeof(scratch.nacp));
+                if(out_check.has_nacp) {
+                    strs_resolved = ResolveControlStrings(&scratch.nacp, strs);
+                }
+                else {
+                    out_check.corrupted = true;
+                }
+            }
+
+            if(strs_index.IsLoaded()) {
+                ControlStrings cached_strs;
+                const auto has_strs = strs_index.Find(key, cached_strs);
+                if(has_strs != strs_resolved) {
+                    out_check.corrupted = true;
+                }
+                else if(has_strs && ((cached_strs.name != strs.name) || (cached_strs.author != strs.author) || (cached_strs.version != strs.version))) {
+                    out_check.corrupted = true;
+                }
+            }
+        }
+
+        inline bool IsCachedEntryUpToDate(const CachedEntryCheck &check, const void *icon_data, const size_t icon_size, const NacpStruct *nacp, const CacheVerifyScratch &scratch) {
+            const auto icon_ok = (icon_size > 0) ? (check.has_icon && (check.icon_entry.size == icon_size) && (check.icon_entry.data_crc32 == crc32Calculate(icon_data, icon_size))) : !check.has_icon;
+            const auto nacp_ok = (nacp != nullptr) ? (check.has_nacp && (memcmp(&scratch.nacp, nacp, sizeof(NacpStruct)) == 0)) : !check.has_nacp;
+            return icon_ok && nacp_ok;
         }
 
-        void CacheApplicationEntry(const u64 app_id, NsApplicationControlData *tmp_control_data) {
-            const auto cache_icon_path = GetApplicationCacheIconPath(app_id);
-            fs::DeleteFile(cache_icon_path);
-            if(R_SUCCEEDED(nsGetApplicationControlData(NsApplicationControlSource_Storage, app_id, tmp_control_data, sizeof(NsApplicationControlData), nullptr))) {
-                fs::WriteFile(cache_icon_path, tmp_control_data->icon, sizeof(tmp_control_data->icon), true);
+        CacheVerifyResult VerifyApplicationCacheEntry(const u64 app_id, CacheVerifyScratch &scratch) {
+            ScopedLock lk(g_ApplicationCacheLock);
+            ApplicationCacheManifest manifest;
+            if(!ReadApplicationCacheManifest(manifest) || !manifest.contains(app_id)) {
+                // Removed (or not cached yet) meanwhile
+                return CacheVerifyResult::Valid;
+            }
+            if(!g_ApplicationIconPack.Open(true)) {
+                return CacheVerifyResult::Valid;
+            }
+            g_ApplicationControlStrings.Load(GetControlStringsLanguage());
+
+            CachedEntryCheck check;
+            CheckCachedEntry(g_ApplicationIconPack, g_ApplicationControlStrings, app_id, GetApplicationCacheNacpPath(app_id), scratch, check);
+
+            auto result = CacheVerifyResult::Valid;
+            if(R_SUCCEEDED(nsGetApplicationControlData(NsApplicationControlSource_Storage, app_id, &scratch.control_data, sizeof(scratch.control_data), nullptr))) {
+                const auto icon_size = GetApplicationIconSize(&scratch.control_data);
+                if(check.corrupted || !IsCachedEntryUpToDate(check, scratch.control_data.icon, icon_size, &scratch.control_data.nacp, scratch)) {
+                    // Otherwise an identical icon wouldn't be written again
+                    g_ApplicationIconPack.Remove(app_id);
+                    StoreApplicationControlData(app_id, &scratch.control_data);
+                    result = CacheVerifyResult::Repaired;
+                }
             }
+            else if(check.corrupted || check.undecodable) {
+                g_ApplicationIconPack.Remove(app_id);
+                fs::DeleteFile(GetApplicationCacheNacpPath(app_id));
+                g_ApplicationControlStrings.Remove(app_id);
+                manifest.erase(app_id);
+                WriteApplicationCacheManifest(manifest);
+                result = CacheVerifyResult::Dropped;
+            }
+
+            if(result != CacheVerifyResult::Valid) {
+                g_ApplicationIconPack.SaveIndex();
+                g_ApplicationControlStrings.Save();
+            }
+            g_ApplicationIconPack.Close();
+            return result;
         }
 
-        void CacheApplicationEntries(const std::vector<NsApplicationRecord> &records) {
-            auto tmp_control_data = new NsApplicationControlData();
-            for(const auto &record: records) {
-                CacheApplicationEntry(record.application_id, tmp_control_data);
+        CacheVerifyResult VerifyHomebrewCacheEntry(const std::string &nro_path, CacheVerifyScratch &scratch) {
+            ScopedLock lk(g_HomebrewCacheLock);
+            HomebrewCacheManifest manifest;
+            if(!ReadHomebrewCacheManifest(manifest)) {
+                return CacheVerifyResult::Valid;
+            }
+            const auto find_entry = manifest.find(nro_path);
+            if((find_entry == manifest.end()) || find_entry->second.evicted) {
+                return CacheVerifyResult::Valid;
+            }
+            if(!g_HomebrewIconPack.Open(true)) {
+                return CacheVerifyResult::Valid;
+            }
+            g_HomebrewControlStrings.Load(GetControlStringsLanguage());
+
+            const auto location = GetHomebrewCacheLocation(nro_path);
+            CachedEntryCheck check;
+            CheckCachedEntry(g_HomebrewIconPack, g_HomebrewControlStrings, location.icon_key, location.nacp_path, scratch, check);
+
+            auto result = CacheVerifyResult::Valid;
+            NroAssetHeader asset_header;
+            u64 asset_data_offset;
+            auto f = fopen(nro_path.c_str(), "rb");
+            const auto assets_read = (f != nullptr) && ReadNroAssets(f, scratch.nro.asset_data, asset_header, asset_data_offset);
+            if(f != nullptr) {
+                fclose(f);
+            }
+            if(assets_read) {
+                const void *icon_data = nullptr;
+                size_t icon_size = 0;
+                if(IsNroAssetSectionValid(asset_header.icon)) {
+                    icon_data = scratch.nro.asset_data.data() + (asset_header.icon.offset - asset_data_offset);
+                    icon_size = asset_header.icon.size;
+                }
+                const NacpStruct *nacp = nullptr;
+                if(IsNroAssetSectionValid(asset_header.nacp) && (asset_header.nacp.size >= sizeof(NacpStruct))) {
+                    memcpy(&scratch.nro.nacp, scratch.nro.asset_data.data() + (asset_header.nacp.offset - asset_data_offset), sizeof(NacpStruct));
+                    nacp = &scratch.nro.nacp;
+                }
+
+                if(check.corrupted || !IsCachedEntryUpToDate(check, icon_data, icon_size, nacp, scratch)) {
+                    g_HomebrewIconPack.Remove(location.icon_key);
+                    ExtractHomebrewCache(nro_path, scratch.nro);
+                    result = CacheVerifyResult::Repaired;
+                }
+            }
+            else if(check.corrupted || check.undecodable) {
+                g_HomebrewIconPack.Remove(location.icon_key);
+                fs::DeleteFile(location.nacp_path);
+                g_HomebrewControlStrings.Remove(location.icon_key);
+                SetHomebrewCacheMemoNacpStatus(nro_path, HomebrewCacheNacpStatus::NotCached);
+                manifest.erase(find_entry);
+                WriteHomebrewCacheManifest(manifest);
+                result = CacheVerifyResult::Dropped;
+            }
+
+            if(result != CacheVerifyResult::Valid) {
+                g_HomebrewIconPack.SaveIndex();
+                g_HomebrewControlStrings.Save();
+            }
+            g_HomebrewIconPack.Close();
+            return result;
+        }
+
+        void StartCacheVerifyPass() {
+            g_CacheVerifyItems.clear();
+            g_CacheVerifyItemIndex = 0;
+            g_CacheVerifyRepairedCount = 0;
+            g_CacheVerifyDroppedCount = 0;
+
+            ApplicationCacheManifest app_manifest;
+            {
+                ScopedLock lk(g_ApplicationCacheLock);
+                ReadApplicationCacheManifest(app_manifest);
+            }
+            for(const auto &[app_id, status]: app_manifest) {
+                g_CacheVerifyItems.push_back({
+                    .is_homebrew = false,
+                    .app_id = app_id
+                });
+            }
+
+            HomebrewCacheManifest hb_manifest;
+            {
+                ScopedLock lk(g_HomebrewCacheLock);
+                ReadHomebrewCacheManifest(hb_manifest);
+            }
+            for(const auto &[nro_path, entry]: hb_manifest) {
+                if(!entry.evicted) {
+                    g_CacheVerifyItems.push_back({
+                        .is_homebrew = true,
+                        .nro_path = nro_path
+                    });
+                }
+            }
+
+            if(g_CacheVerifyScratch == nullptr) {
+                g_CacheVerifyScratch = new CacheVerifyScratch();
             }
-            delete tmp_control_data;
         }
 
     }
 
     void CacheHomebrew(const std::string &hb_base_path) {
+        ScopedLock lk(g_HomebrewCacheLock);
+        // The cache is only started over if the manifest is missing/invalid, since any existing cache files can't be trusted then
+        HomebrewCacheManifest old_manifest;
+        if(!ReadHomebrewCacheManifest(old_manifest)) {
+            fs::CleanDirectory(HomebrewCachePath);
+        }
+
+        // Strings of unchanged NROs are kept too, unless the index is unusable (like after a system language change)
+        const auto strs_lang = GetControlStringsLanguage();
+        const auto strs_valid = g_HomebrewControlStrings.Load(strs_lang);
+        if(!strs_valid) {
+            g_HomebrewControlStrings.Reset(strs_lang);
+        }
+
+        if(!g_HomebrewIconPack.Open(true)) {
+            UL_LOG_WARN("Unable to open homebrew icon pack");
+        }
+
+        HomebrewCacheManifest new_manifest;
+        new_manifest.reserve(old_manifest.size());
+        u32 cached_count = 0;
+        {
+            // Every worker has its own scratch buffers
+            std::vector<NroExtractScratch*> scratches;
+            CacheWorkerPipeline<std::string> pipeline(g_CacheWorkerCount, [&](const u32 worker_idx, std::string &nro_path) {
+                ExtractHomebrewCache(nro_path, *scratches.at(worker_idx));
+            });
+            for(u32 i = 0; i < pipeline.GetWorkerCount(); i++) {
+                scratches.push_back(new NroExtractScratch());
+            }
+            if(CacheHomebrewEntry(HbmenuPath, old_manifest, new_manifest, pipeline)) {
+                cached_count++;
+            }
+            CacheHomebrewEntries(hb_base_path, old_manifest, new_manifest, pipeline, cached_count);
+            pipeline.Finish();
+
+            for(auto &scratch: scratches) {
+                delete scratch;
+            }
+        }
+
+        // Prune NROs which are gone (uMenu isn't running yet, thus the scaled icon pack can be written here too)
+        u32 removed_count = 0;
+        for(const auto &[nro_path, entry]: old_manifest) {
+            if(!new_manifest.contains(nro_path)) {
+                const auto location = GetHomebrewCacheLocation(nro_path);
+                g_HomebrewIconPack.Remove(location.icon_key);
+                if(EnsureScaledIconPackOpen(g_HomebrewIconPack, g_HomebrewScaledIconPack)) {
+                    g_HomebrewScaledIconPack.Remove(location.icon_key);
+                }
+                fs::DeleteFile(location.nacp_path);
+                g_HomebrewControlStrings.Remove(location.icon_key);
+                {
+                    ScopedLock lk(g_HomebrewCacheMemoLock);
+                    g_HomebrewCacheMemo.erase(nro_path);
+                }
+                removed_count++;
+            }
+        }
+
+        if(!strs_valid) {
+            for(const auto &[nro_path, entry]: new_manifest) {
+                const auto icon_key = GetHomebrewCacheIconKey(nro_path);
+                ControlStrings strs;
+                if(!g_HomebrewControlStrings.Find(icon_key, strs)) {
+                    auto nacp = new NacpStruct();
+                    if(ReadHomebrewCacheNacp(nro_path, *nacp) && ResolveControlStrings(nacp, strs)) {
+                        g_HomebrewControlStrings.Set(icon_key, strs);
+                    }
+                    delete nacp;
+                }
+            }
+        }
+        g_HomebrewControlStrings.Save();
+
+        if((cached_count > 0) || (removed_count > 0)) {
+            if(g_HomebrewIconPack.NeedsCompaction() && !g_HomebrewIconPack.Compact()) {
+                UL_LOG_WARN("Unable to compact homebrew icon pack");
+            }
+            g_HomebrewIconPack.SaveIndex();
+            if(g_HomebrewScaledIconPack.IsOpen()) {
+                g_HomebrewScaledIconPack.SaveIndex();
+            }
+
+            if(!WriteHomebrewCacheManifest(new_manifest)) {
+                UL_LOG_WARN("Unable to save homebrew cache manifest");
+            }
+        }
+        g_HomebrewIconPack.Close();
+        g_HomebrewScaledIconPack.Close();
+        UL_LOG_INFO("Homebrew cache: %zu NROs, %d (re)cached, %d removed", new_manifest.size(), cached_count, removed_count);
+    }
+
+    void SetCacheWorkerCount(const u32 count) {
+        g_CacheWorkerCount = std::min(count, MaxCacheWorkerCount);
+    }
+
+    void ResetHomebrewCache() {
+        ScopedLock cache_lk(g_HomebrewCacheLock);
+        g_HomebrewIconPack.Close();
+        g_HomebrewScaledIconPack.Close();
         fs::CleanDirectory(HomebrewCachePath);
-        CacheHomebrewEntry(HbmenuPath);
-        CacheHomebrewEntries(hb_base_path);
+        g_HomebrewControlStrings.Reset(GetControlStringsLanguage());
+
+        ScopedLock lk(g_HomebrewCacheMemoLock);
+        g_HomebrewCacheMemo.clear();
     }
 
-    void CacheApplications(const std::vector<NsApplicationRecord> &records) {
+    void ResetApplicationCache() {
+        ScopedLock lk(g_ApplicationCacheLock);
+        g_ApplicationIconPack.Close();
+        g_ApplicationScaledIconPack.Close();
         fs::CleanDirectory(ApplicationCachePath);
-        CacheApplicationEntries(records);
+        g_ApplicationControlStrings.Reset(GetControlStringsLanguage());
+    }
+
+    std::vector<u64> CacheApplications(const std::vector<NsApplicationRecord> &records) {
+        ScopedLock lk(g_ApplicationCacheLock);
+        // Same as with homebrew, the cache is only started over if the manifest is missing/invalid
+        ApplicationCacheManifest old_manifest;
+        if(!ReadApplicationCacheManifest(old_manifest)) {
+            ResetApplicationCache();
+        }
+
+        const auto strs_lang = GetControlStringsLanguage();
+        const auto strs_valid = g_ApplicationControlStrings.Load(strs_lang);
+        if(!strs_valid) {
+            g_ApplicationControlStrings.Reset(strs_lang);
+        }
+
+        // Only open while writing, since uMenu keeps reading from it meanwhile (this also runs on record changes)
+        if(!g_ApplicationIconPack.Open(true)) {
+            UL_LOG_WARN("Unable to open application icon pack");
+        }
+
+        ApplicationCacheManifest new_manifest;
+        new_manifest.reserve(records.size());
+        std::vector<u64> cached_app_ids;
+        for(const auto &record: records) {
+            const auto status = GetApplicationCacheStatus(record);
+            new_manifest[record.application_id] = status;
+
+            const auto find_status = old_manifest.find(record.application_id);
+            if((find_status != old_manifest.end()) && (find_status->second == status)) {
+                if(strs_valid) {
+                    continue;
+                }
+
+                // Unchanged, but its strings are needed again (like after a system language change)
+                auto nacp = new NacpStruct();
+                ControlStrings strs;
+                const auto strs_ok = fs::ReadFile(GetApplicationCacheNacpPath(record.application_id), nacp, sizeof(NacpStruct)) && ResolveControlStrings(nacp, strs);
+                delete nacp;
+                if(strs_ok) {
+                    g_ApplicationControlStrings.Set(record.application_id, strs);
+                    continue;
+                }
+            }
+
+            cached_app_ids.push_back(record.application_id);
+        }
+        // Failed ones are left out of the manifest, thus they're retried on the next call
+        std::vector<u64> failed_app_ids;
+        CacheApplicationEntries(cached_app_ids, failed_app_ids);
+        for(const auto app_id: failed_app_ids) {
+            new_manifest.erase(app_id);
+        }
+
+        u32 removed_count = 0;
+        for(const auto &[app_id, status]: old_manifest) {
+            if(!new_manifest.contains(app_id)) {
+                g_ApplicationIconPack.Remove(app_id);
+                fs::DeleteFile(GetApplicationCacheNacpPath(app_id));
+                g_ApplicationControlStrings.Remove(app_id);
+                removed_count++;
+            }
+        }
+
+        if(!cached_app_ids.empty() || (removed_count > 0)) {
+            g_ApplicationIconPack.SaveIndex();
+            if(!WriteApplicationCacheManifest(new_manifest)) {
+                UL_LOG_WARN("Unable to save application cache manifest");
+            }
+        }
+        g_ApplicationControlStrings.Save();
+        g_ApplicationIconPack.Close();
+        UL_LOG_INFO("Application cache: %zu applications, %zu (re)cached, %d removed", new_manifest.size(), cached_app_ids.size(), removed_count);
+        return cached_app_ids;
+    }
+
+    HomebrewCacheLocation GetHomebrewCacheLocation(const std::string &nro_path) {
+        ScopedLock lk(g_HomebrewCacheMemoLock);
+        return FindHomebrewCacheMemoEntry(nro_path).location;
+    }
+
+    bool ReadHomebrewCacheNacp(const std::string &nro_path, NacpStruct &out_nacp) {
+        std::string nacp_path;
+        {
+            ScopedLock lk(g_HomebrewCacheMemoLock);
+            const auto &entry = FindHomebrewCacheMemoEntry(nro_path);
+            if(entry.nacp_status == HomebrewCacheNacpStatus::NotCached) {
+                return false;
+            }
+            nacp_path = entry.location.nacp_path;
+        }
+
+        // Not checking whether it exists beforehand, a failed open already tells
+        const auto ok = fs::ReadFile(nacp_path, &out_nacp, sizeof(out_nacp));
+        SetHomebrewCacheMemoNacpStatus(nro_path, ok ? HomebrewCacheNacpStatus::Cached : HomebrewCacheNacpStatus::NotCached);
+        return ok;
+    }
+
+    bool ReadHomebrewNroNacp(const std::string &nro_path, NacpStruct &out_nacp) {
+        auto f = fopen(nro_path.c_str(), "rb");
+        if(f == nullptr) {
+            return false;
+        }
+
+        auto ok = false;
+        NroHeader header = {};
+        NroAssetHeader asset_header = {};
+        if((fseek(f, sizeof(NroStart), SEEK_SET) == 0) && (fread(&header, sizeof(header), 1, f) == 1)) {
+            if((fseek(f, header.size, SEEK_SET) == 0) && (fread(&asset_header, sizeof(asset_header), 1, f) == 1)) {
+                if((asset_header.magic == NROASSETHEADER_MAGIC) && (asset_header.nacp.offset > 0) && (asset_header.nacp.size >= sizeof(NacpStruct))) {
+                    ok = (fseek(f, header.size + asset_header.nacp.offset, SEEK_SET) == 0) && (fread(&out_nacp, sizeof(out_nacp), 1, f) == 1);
+                }
+            }
+        }
+        fclose(f);
+        return ok;
+    }
+
+    bool ReadApplicationCacheIcon(const u64 app_id, std::vector<u8> &out_icon_data) {
+        return CountCacheLookup(g_ApplicationIconPack.Read(app_id, out_icon_data), g_IconHitCount, g_IconMissCount);
+    }
+
+    bool ReadHomebrewCacheIcon(const std::string &nro_path, std::vector<u8> &out_icon_data) {
+        const auto icon_key = GetHomebrewCacheIconKey(nro_path);
+        NotifyHomebrewCacheAccess(icon_key);
+        return CountCacheLookup(g_HomebrewIconPack.Read(icon_key, out_icon_data), g_IconHitCount, g_IconMissCount);
+    }
+
+    bool FindApplicationCacheControlStrings(const u64 app_id, ControlStrings &out_strs) {
+        return CountCacheLookup(g_ApplicationControlStrings.Find(app_id, out_strs), g_StringsHitCount, g_StringsMissCount);
+    }
+
+    bool FindHomebrewCacheControlStrings(const std::string &nro_path, ControlStrings &out_strs) {
+        return CountCacheLookup(g_HomebrewControlStrings.Find(GetHomebrewCacheIconKey(nro_path), out_strs), g_StringsHitCount, g_StringsMissCount);
+    }
+
+    void RefreshCaches() {
+        g_ApplicationIconPack.Refresh();
+        g_HomebrewIconPack.Refresh();
+
+        const auto strs_lang = GetControlStringsLanguage();
+        g_ApplicationControlStrings.Load(strs_lang);
+        g_HomebrewControlStrings.Load(strs_lang);
+    }
+
+    bool ReadApplicationCacheScaledIcon(const u64 app_id, const u32 size, std::vector<u8> &out_rgba_data) {
+        return CountCacheLookup(ReadScaledIcon(g_ApplicationIconPack, g_ApplicationScaledIconPack, app_id, size, out_rgba_data), g_ScaledIconHitCount, g_ScaledIconMissCount);
+    }
+
+    bool WriteApplicationCacheScaledIcon(const u64 app_id, const u32 size, const std::vector<u8> &rgba_data) {
+        return WriteScaledIcon(g_ApplicationIconPack, g_ApplicationScaledIconPack, app_id, size, rgba_data);
+    }
+
+    bool ReadHomebrewCacheScaledIcon(const std::string &nro_path, const u32 size, std::vector<u8> &out_rgba_data) {
+        const auto icon_key = GetHomebrewCacheIconKey(nro_path);
+        NotifyHomebrewCacheAccess(icon_key);
+        return CountCacheLookup(ReadScaledIcon(g_HomebrewIconPack, g_HomebrewScaledIconPack, icon_key, size, out_rgba_data), g_ScaledIconHitCount, g_ScaledIconMissCount);
+    }
+
+    bool WriteHomebrewCacheScaledIcon(const std::string &nro_path, const u32 size, const std::vector<u8> &rgba_data) {
+        return WriteScaledIcon(g_HomebrewIconPack, g_HomebrewScaledIconPack, GetHomebrewCacheIconKey(nro_path), size, rgba_data);
     }
 
-    void CacheSingleApplication(const u64 app_id) {
-        auto tmp_control_data = new NsApplicationControlData();
-        CacheApplicationEntry(app_id, tmp_control_data);
-        delete tmp_control_data;
+    void FlushCaches() {
+        if(g_ApplicationScaledIconPack.IsOpen()) {
+            g_ApplicationScaledIconPack.SaveIndex();
+        }
+        if(g_HomebrewScaledIconPack.IsOpen()) {
+            g_HomebrewScaledIconPack.SaveIndex();
+        }
+
+        ScopedLock lk(g_HomebrewAccessTimesLock);
+        if(g_HomebrewAccessTimesDirty) {
+            if(WriteCacheAccessTable(MakeHomebrewCacheAccessPath(), g_HomebrewAccessTimes)) {
+                g_HomebrewAccessTimesDirty = false;
+            }
+        }
+    }
+
+    void SetCacheBudgetSize(const u64 size) {
+        g_CacheBudgetSize = size;
+    }
+
+    void EnforceCacheBudget(const std::vector<std::string> &referenced_nro_paths) {
+        ScopedLock lk(g_HomebrewCacheLock);
+        HomebrewCacheManifest manifest;
+        if(!ReadHomebrewCacheManifest(manifest)) {
+            return;
+        }
+
+        CacheBudgetStats stats = {};
+        if(!fs::ReadFile(MakeCacheBudgetStatsPath(), &stats, sizeof(stats)) || !stats.IsValid()) {
+            stats = {
+                .magic = CacheBudgetStats::Magic,
+                .version = CacheBudgetStats::CurrentVersion
+            };
+        }
+
+        if(!g_HomebrewIconPack.Open(true)) {
+            UL_LOG_WARN("Unable to open homebrew icon pack");
+            return;
+        }
+        EnsureScaledIconPackOpen(g_HomebrewIconPack, g_HomebrewScaledIconPack);
+        g_HomebrewControlStrings.Load(GetControlStringsLanguage());
+
+        // Evicted NROs which got referenced meanwhile are cached again
+        std::unordered_set<std::string> referenced_nro_path_set(referenced_nro_paths.begin(), referenced_nro_paths.end());
+        auto manifest_changed = false;
+        u32 restored_count = 0;
+        auto scratch = new NroExtractScratch();
+        for(auto &[nro_path, entry]: manifest) {
+            if(entry.evicted && referenced_nro_path_set.contains(nro_path)) {
+                ExtractHomebrewCache(nro_path, *scratch);
+                entry.evicted = false;
+                manifest_changed = true;
+                restored_count++;
+            }
+        }
+        delete scratch;
+
+        CacheAccessTable access_times;
+        ReadCacheAccessTable(MakeHomebrewCacheAccessPath(), access_times);
+
+        // Only homebrew assets can be evicted, thus everything else (application/theme/account caches...) is just subtracted from the budget
+        auto total_size = GetDirectorySize(RootCachePath);
+        const auto hb_size = GetDirectorySize(HomebrewCachePath);
+        const auto fixed_size = total_size - std::min(total_size, hb_size);
+        u32 evicted_count = 0;
+        u64 evicted_size = 0;
+        if((g_CacheBudgetSize > 0) && (total_size > g_CacheBudgetSize) && (fixed_size >= g_CacheBudgetSize)) {
+            UL_LOG_WARN("Cache budget exceeded by caches which can't be evicted (%lu bytes), not evicting homebrew...", fixed_size);
+        }
+        else if((g_CacheBudgetSize > 0) && (total_size > g_CacheBudgetSize)) {
+            const auto hb_budget_size = g_CacheBudgetSize - fixed_size;
+            // Evict least recently used ones first (never accessed ones count as the oldest)
+            struct EvictionCandidate {
+                const std::string *nro_path;
+                u64 icon_key;
+                s64 access_time;
+            };
+            std::vector<EvictionCandidate> candidates;
+            for(const auto &[nro_path, entry]: manifest) {
+                if(!entry.evicted && !referenced_nro_path_set.contains(nro_path)) {
+                    const auto icon_key = GetHomebrewCacheIconKey(nro_path);
+                    const auto find_access = access_times.find(icon_key);
+                    candidates.push_back({
+                        .nro_path = &nro_path,
+                        .icon_key = icon_key,
+                        .access_time = (find_access != access_times.end()) ? find_access->second : 0
+                    });
+                }
+            }
+            std::sort(candidates.begin(), candidates.end(), [](const EvictionCandidate &a, const EvictionCandidate &b) {
+                return a.access_time < b.access_time;
+            });
+
+            // Already dead pack space doesn't count, since packs are compacted afterwards anyway
+            const auto dead_size = g_HomebrewIconPack.GetDeadSize() + (g_HomebrewScaledIconPack.IsOpen() ? g_HomebrewScaledIconPack.GetDeadSize() : 0);
+            auto live_size = hb_size - std::min(hb_size, dead_size);
+            for(const auto &candidate: candidates) {
+                if(live_size <= hb_budget_size) {
+                    break;
+                }
+
+                const auto location = GetHomebrewCacheLocation(*candidate.nro_path);
+                auto asset_size = GetIconPackEntrySize(g_HomebrewIconPack, candidate.icon_key) + fs::GetFileSize(location.nacp_path);
+                g_HomebrewIconPack.Remove(candidate.icon_key);
+                if(g_HomebrewScaledIconPack.IsOpen()) {
+                    asset_size += GetIconPackEntrySize(g_HomebrewScaledIconPack, candidate.icon_key);
+                    g_HomebrewScaledIconPack.Remove(candidate.icon_key);
+                }
+                fs::DeleteFile(location.nacp_path);
+                g_HomebrewControlStrings.Remove(candidate.icon_key);
+                SetHomebrewCacheMemoNacpStatus(*candidate.nro_path, HomebrewCacheNacpStatus::NotCached);
+                access_times.erase(candidate.icon_key);
+
+                manifest[*candidate.nro_path].evicted = true;
+                manifest_changed = true;
+                live_size -= std::min(live_size, asset_size);
+                evicted_count++;
+                evicted_size += asset_size;
+            }
+
+            if((dead_size > 0) || (evicted_count > 0)) {
+                if(!g_HomebrewIconPack.Compact()) {
+                    UL_LOG_WARN("Unable to compact homebrew icon pack");
+                }
+                if(g_HomebrewScaledIconPack.IsOpen() && !g_HomebrewScaledIconPack.Compact()) {
+                    UL_LOG_WARN("Unable to compact homebrew scaled icon pack");
+                }
+            }
+        }
+
+        if(manifest_changed) {
+            g_HomebrewIconPack.SaveIndex();
+            if(g_HomebrewScaledIconPack.IsOpen()) {
+                g_HomebrewScaledIconPack.SaveIndex();
+            }
+            g_HomebrewControlStrings.Save();
+            if(!WriteHomebrewCacheManifest(manifest)) {
+                UL_LOG_WARN("Unable to save homebrew cache manifest");
+            }
+            if(evicted_count > 0) {
+                WriteCacheAccessTable(MakeHomebrewCacheAccessPath(), access_times);
+            }
+        }
+        g_HomebrewIconPack.Close();
+        g_HomebrewScaledIconPack.Close();
+
+        if(evicted_count > 0) {
+            total_size = GetDirectorySize(RootCachePath);
+        }
+        stats.eviction_count += evicted_count;
+        stats.evicted_size += evicted_size;
+        stats.total_size = total_size;
+        stats.budget_size = g_CacheBudgetSize;
+        fs::WriteFile(MakeCacheBudgetStatsPath(), &stats, sizeof(stats), true);
+        UL_LOG_INFO("Cache budget: %lu/%lu bytes, %d homebrew evicted (%lu bytes), %d restored", total_size, g_CacheBudgetSize, evicted_count, evicted_size, restored_count);
     }
 
-    std::string GetHomebrewCacheIconPath(const std::string &nro_path) {
-        return GetHomebrewCachePath(nro_path, "jpg");
+    CacheStats GetCacheStats() {
+        CacheStats stats = {
+            .icon_hit_count = g_IconHitCount,
+            .icon_miss_count = g_IconMissCount,
+            .scaled_icon_hit_count = g_ScaledIconHitCount,
+            .scaled_icon_miss_count = g_ScaledIconMissCount,
+            .strings_hit_count = g_StringsHitCount,
+            .strings_miss_count = g_StringsMissCount
+        };
+
+        CacheBudgetStats budget_stats;
+        if(fs::ReadFile(MakeCacheBudgetStatsPath(), &budget_stats, sizeof(budget_stats)) && budget_stats.IsValid()) {
+            stats.eviction_count = budget_stats.eviction_count;
+            stats.evicted_size = budget_stats.evicted_size;
+            stats.total_size = budget_stats.total_size;
+            stats.budget_size = budget_stats.budget_size;
+        }
+        return stats;
     }
 
-    std::string GetHomebrewCacheNacpPath(const std::string &nro_path) {
-        return GetHomebrewCachePath(nro_path, "nacp");
+    void LogCacheStats() {
+        const auto stats = GetCacheStats();
+        UL_LOG_INFO("Cache stats: icons %lu/%lu, scaled icons %lu/%lu, strings %lu/%lu (hits/misses), %lu evictions (%lu bytes), %lu/%lu bytes used", stats.icon_hit_count, stats.icon_miss_count, stats.scaled_icon_hit_count, stats.scaled_icon_miss_count, stats.strings_hit_count, stats.strings_miss_count, stats.eviction_count, stats.evicted_size, stats.total_size, stats.budget_size);
     }
     
+    CacheVerifyResult VerifyNextCacheEntry() {
+        if(g_CacheVerifyItems.empty()) {
+            StartCacheVerifyPass();
+        }
+        if(g_CacheVerifyItemIndex >= g_CacheVerifyItems.size()) {
+            UL_LOG_INFO("Cache verification pass: %zu entries, %d repaired, %d dropped", g_CacheVerifyItems.size(), g_CacheVerifyRepairedCount, g_CacheVerifyDroppedCount);
+            g_CacheVerifyItems.clear();
+            delete g_CacheVerifyScratch;
+            g_CacheVerifyScratch = nullptr;
+            return CacheVerifyResult::PassFinished;
+        }
+
+        const auto &item = g_CacheVerifyItems.at(g_CacheVerifyItemIndex);
+        g_CacheVerifyItemIndex++;
+        const auto result = item.is_homebrew ? VerifyHomebrewCacheEntry(item.nro_path, *g_CacheVerifyScratch) : VerifyApplicationCacheEntry(item.app_id, *g_CacheVerifyScratch);
+        if(result == CacheVerifyResult::Repaired) {
+            UL_LOG_WARN("Repaired cache entry of %s", item.is_homebrew ? item.nro_path.c_str() : util::FormatProgramId(item.app_id).c_str());
+            g_CacheVerifyRepairedCount++;
+        }
+        else if(result == CacheVerifyResult::Dropped) {
+            UL_LOG_WARN("Dropped cache entry of %s", item.is_homebrew ? item.nro_path.c_str() : util::FormatProgramId(item.app_id).c_str());
+            g_CacheVerifyDroppedCount++;
+        }
+        return result;
+    }
+
 }
@@ -0,0 +1,165 @@
+#include <ul/menu/menu_ControlStrings.hpp>
+#include <ul/fs/fs_Stdio.hpp>
+#include <ul/os/os_System.hpp>
+#include <ul/ul_Result.hpp>
+
+namespace ul::menu {
+
+    bool ResolveControlStrings(NacpStruct *nacp, ControlStrings &out_strs) {
+        NacpLanguageEntry *lang_entry = nullptr;
+        nacpGetLanguageEntry(nacp, &lang_entry);
+        if(lang_entry == nullptr) {
+            for(u32 i = 0; i < 16; i++) {
+                lang_entry = &nacp->lang[i];
+                if((lang_entry->name[0] > 0) && (lang_entry->author[0] > 0)) {
+                    break;
+                }
+                lang_entry = nullptr;
+            }
+        }
+
+        if(lang_entry == nullptr) {
+            return false;
+        }
+
+        out_strs = {
+            .name = std::string(lang_entry->name, strnlen(lang_entry->name, sizeof(lang_entry->name))),
+            .author = std::string(lang_entry->author, strnlen(lang_entry->author, sizeof(lang_entry->author))),
+            .version = std::string(nacp->display_version, strnlen(nacp->display_version, sizeof(nacp->display_version)))
+        };
+        return true;
+    }
+
+    SetLanguage GetControlStringsLanguage() {
+        // Not every process keeps set opened (nacpGetLanguageEntry also opens it on its own)
+        auto lang = SetLanguage_ENUS;
+        if(R_SUCCEEDED(setInitialize())) {
+            lang = os::GetSystemLanguage();
+            setExit();
+        }
+        return lang;
+    }
+
+    bool ControlStringsIndex::Load(const u32 language) {
+        ScopedLock lk(this->lock);
+        this->strings.clear();
+        this->language = language;
+        this->loaded = false;
+        this->load_attempted = true;
+        this->dirty = false;
+
+        std::vector<u8> index_data;
+        if(!fs::ReadFileContents(this->path, index_data) || (index_data.size() < sizeof(ControlStringsIndexHeader))) {
+            return false;
+        }
+
+        ControlStringsIndexHeader header;
+        memcpy(&header, index_data.data(), sizeof(header));
+        const auto string_data_offset = sizeof(header) + header.entry_count * sizeof(ControlStringsIndexEntry);
+        if(!header.IsValid() || (header.language != language) || (index_data.size() != (string_data_offset + header.string_data_size))) {
+            return false;
+        }
+
+        const auto string_data = reinterpret_cast<const char*>(index_data.data() + string_data_offset);
+        this->strings.reserve(header.entry_count);
+        for(u32 i = 0; i < header.entry_count; i++) {
+            ControlStringsIndexEntry entry;
+            memcpy(&entry, index_data.data() + sizeof(header) + i * sizeof(entry), sizeof(entry));
+            if((static_cast<u64>(entry.string_offset) + entry.name_length + entry.author_length + entry.version_length) > header.string_data_size) {
+                this->strings.clear();
+                return false;
+            }
+
+            const auto strs_ptr = string_data + entry.string_offset;
+            this->strings[entry.key] = {
+                .name = std::string(strs_ptr, entry.name_length),
+                .author = std::string(strs_ptr + entry.name_length, entry.author_length),
+                .version = std::string(strs_ptr + entry.name_length + entry.author_length, entry.version_length)
+            };
+        }
+
+        this->loaded = true;
+        return true;
+    }
+
+    void ControlStringsIndex::Reset(const u32 language) {
+        ScopedLock lk(this->lock);
+        this->strings.clear();
+        this->language = language;
+        this->loaded = true;
+        this->load_attempted = true;
+        this->dirty = true;
+    }
+
+    bool ControlStringsIndex::Save() {
+        ScopedLock lk(this->lock);
+        if(!this->loaded || !this->dirty) {
+            return true;
+        }
+
+        std::vector<u8> index_data(sizeof(ControlStringsIndexHeader) + this->strings.size() * sizeof(ControlStringsIndexEntry));
+        std::string string_data;
+        size_t entry_offset = sizeof(ControlStringsIndexHeader);
+        for(const auto &[key, strs]: this->strings) {
+            const ControlStringsIndexEntry entry = {
+                .key = key,
+                .string_offset = static_cast<u32>(string_data.length()),
+                .name_length = static_cast<u16>(strs.name.length()),
+                .author_length = static_cast<u16>(strs.author.length()),
+                .version_length = static_cast<u16>(strs.version.length()),
+                .reserved = {}
+            };
+            memcpy(index_data.data() + entry_offset, &entry, sizeof(entry));
+            entry_offset += sizeof(entry);
+            string_data += strs.name;
+            string_data += strs.author;
+            string_data += strs.version;
+        }
+
+        const ControlStringsIndexHeader header = {
+            .magic = ControlStringsIndexHeader::Magic,
+            .version = ControlStringsIndexHeader::CurrentVersion,
+            .language = this->language,
+            .entry_count = static_cast<u32>(this->strings.size()),
+            .string_data_size = static_cast<u32>(string_data.length()),
+            .reserved = 0
+        };
+        memcpy(index_data.data(), &header, sizeof(header));
+        index_data.insert(index_data.end(), string_data.begin(), string_data.end());
+
+        if(!fs::WriteFile(this->path, index_data.data(), index_data.size(), true)) {
+            UL_LOG_WARN("Unable to save control strings index at '%s'", this->path.c_str());
+            return false;
+        }
+        this->dirty = false;
+        return true;
+    }
+
+    bool ControlStringsIndex::Find(const u64 key, ControlStrings &out_strs) {
+        ScopedLock lk(this->lock);
+        if(!this->load_attempted) {
+            this->Load(GetControlStringsLanguage());
+        }
+
+        const auto find_strs = this->strings.find(key);
+        if(find_strs == this->strings.end()) {
+            return false;
+        }
+        out_strs = find_strs->second;
+        return true;
+    }
+
+    void ControlStringsIndex::Set(const u64 key, const ControlStrings &strs) {
+        ScopedLock lk(this->lock);
+        this->strings[key] = strs;
+        this->dirty = true;
+    }
+
+    void ControlStringsIndex::Remove(const u64 key) {
+        ScopedLock lk(this->lock);
+        if(this->strings.erase(key) > 0) {
+            this->dirty = true;
+        }
+    }
+
+}
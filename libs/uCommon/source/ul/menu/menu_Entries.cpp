@@ -1,87 +1,199 @@
 #include <ul/menu/menu_Entries.hpp>
+#include <ul/menu/menu_EntryJournal.hpp>
+#include <ul/menu/menu_EntrySnapshot.hpp>
+#include <ul/menu/menu_EntrySearch.hpp>
 #include <ul/fs/fs_Stdio.hpp>
 #include <ul/util/util_String.hpp>
 #include <ul/util/util_Json.hpp>
 #include <ul/os/os_Applications.hpp>
 #include <ul/ul_Result.hpp>
 #include <ul/menu/menu_Cache.hpp>
+#include <unordered_map>
 
 namespace ul::menu {
 
     namespace {
 
         std::vector<NsApplicationRecord> g_ApplicationRecords = {};
+        // Application ID -> index in the records above
+        std::unordered_map<u64, size_t> g_ApplicationRecordTable = {};
+        // Runtime info might be loaded from other threads (see Entry::LoadRuntimeInfo)
+        RecursiveMutex g_ApplicationRecordsLock;
+
+        // In-memory menu tree (see menu_EntrySnapshot.hpp), loaded from the SD card (uSystem) or from uSystem's shared snapshot (uMenu)
+        // It only serves entry listing: changes are still read/written through the SD card indexes, and mirrored here afterwards
+        EntryTree g_EntryTree = {};
+        bool g_EntryTreeLoaded = false;
+        const void *g_EntrySnapshotAddress = nullptr;
+        size_t g_EntrySnapshotSize = 0;
+        u32 g_EntrySnapshotGeneration = 0;
+        RecursiveMutex g_EntryTreeLock;
+        OnEntriesChangedCallback g_OnEntriesChanged = nullptr;
+
+        // Search index (see menu_EntrySearch.hpp), maintained (and saved) by the side owning the menu tree, and just loaded by the other side
+        EntrySearchIndex g_EntrySearchIndex = {};
+        bool g_EntrySearchIndexOwned = false;
+        bool g_EntrySearchIndexLoaded = false;
+        bool g_EntrySearchIndexDirty = false;
+
+        void ApplyControlStrings(EntryControlData &out_control, const ControlStrings &strs) {
+            if(!out_control.custom_name) {
+                out_control.name = strs.name;
+            }
+            if(!out_control.custom_author) {
+                out_control.author = strs.author;
+            }
+            if(!out_control.custom_version) {
+                out_control.version = strs.version;
+            }
+        }
 
         void LoadControlDataStrings(EntryControlData &out_control, NacpStruct *nacp) {
-            NacpLanguageEntry *lang_entry = nullptr;
-            nacpGetLanguageEntry(nacp, &lang_entry);
-            if(lang_entry == nullptr) {
-                for(u32 i = 0; i < 16; i++) {
-                    lang_entry = &nacp->lang[i];
-                    if((lang_entry->name[0] > 0) && (lang_entry->author[0] > 0)) {
+            ControlStrings strs;
+            if(ResolveControlStrings(nacp, strs)) {
+                ApplyControlStrings(out_control, strs);
+            }
+        }
+
+        void LoadHomebrewControlData(const std::string &nro_path, EntryControlData &out_control) {
+            // The cached NACP is only read if the strings index isn't usable
+            ControlStrings strs;
+            if(FindHomebrewCacheControlStrings(nro_path, strs)) {
+                ApplyControlStrings(out_control, strs);
+                return;
+            }
+
+            // Evicted homebrew (see menu_Cache.hpp) have nothing cached until the next boot, thus the NRO itself is read then
+            auto nacp = new NacpStruct();
+            if(ReadHomebrewCacheNacp(nro_path, *nacp) || ReadHomebrewNroNacp(nro_path, *nacp)) {
+                LoadControlDataStrings(out_control, nacp);
+            }
+            delete nacp;
+        }
+
+        bool ResolveEntrySearchStrings(const Entry &entry, std::string &out_name, std::string &out_author) {
+            // Only cached control data is used here, which is way faster than asking NS for every application
+            auto control = entry.control;
+            switch(entry.type) {
+                case EntryType::Application: {
+                    ControlStrings strs;
+                    if(FindApplicationCacheControlStrings(entry.app_info.app_id, strs)) {
+                        ApplyControlStrings(control, strs);
                         break;
                     }
-                    lang_entry = nullptr;
-                }
-            }
 
-            if(lang_entry != nullptr) {
-                if(!out_control.custom_name) {
-                    out_control.name = lang_entry->name;
+                    const auto cache_nacp_path = GetApplicationCacheNacpPath(entry.app_info.app_id);
+                    if(fs::ExistsFile(cache_nacp_path)) {
+                        auto nacp = new NacpStruct();
+                        if(fs::ReadFile(cache_nacp_path, nacp, sizeof(NacpStruct))) {
+                            LoadControlDataStrings(control, nacp);
+                        }
+                        delete nacp;
+                    }
+                    break;
                 }
-                if(!out_control.custom_author) {
-                    out_control.author = lang_entry->author;
+                case EntryType::Homebrew: {
+                    LoadHomebrewControlData(entry.hb_info.nro_path, control);
+                    break;
                 }
-                if(!out_control.custom_version) {
-                    out_control.version = nacp->display_version;
+                case EntryType::Folder: {
+                    control.name = entry.folder_info.name;
+                    break;
                 }
+                default:
+                    break;
             }
+
+            if(control.name.empty()) {
+                return false;
+            }
+
+            out_name = control.name;
+            out_author = control.author;
+            return true;
         }
 
-        void LoadHomebrewControlData(const std::string &nro_path, EntryControlData &out_control) {
-            const auto cache_nacp_path = GetHomebrewCacheNacpPath(nro_path);
-            if(fs::ExistsFile(cache_nacp_path)) {
-                NacpStruct nacp = {};
-                UL_ASSERT_TRUE(fs::ReadFile(cache_nacp_path, &nacp, sizeof(nacp)));
-                LoadControlDataStrings(out_control, &nacp);
+        inline u32 GetControlStringsStamp(const ControlStrings &strs) {
+            // Changes along with the cached strings, which are updated whenever an application/homebrew gets cached again (or cached strings are rebuilt for another language)
+            const auto strs_data = strs.name + '\n' + strs.author;
+            return crc32Calculate(strs_data.c_str(), strs_data.length());
+        }
+
+        u32 StampEntrySearchSource(const Entry &entry) {
+            ControlStrings strs;
+            switch(entry.type) {
+                case EntryType::Application: {
+                    if(FindApplicationCacheControlStrings(entry.app_info.app_id, strs)) {
+                        return GetControlStringsStamp(strs);
+                    }
+                    break;
+                }
+                case EntryType::Homebrew: {
+                    if(FindHomebrewCacheControlStrings(entry.hb_info.nro_path, strs)) {
+                        return GetControlStringsStamp(strs);
+                    }
+                    break;
+                }
+                default:
+                    break;
             }
+            return 0;
         }
 
         void LoadApplicationControlData(const u64 app_id, EntryControlData &out_control) {
+            // NS is only asked for applications missing from the cache
+            ControlStrings strs;
+            if(FindApplicationCacheControlStrings(app_id, strs)) {
+                ApplyControlStrings(out_control, strs);
+                return;
+            }
+
             auto tmp_control_data = new NsApplicationControlData();
             if(R_SUCCEEDED(nsGetApplicationControlData(NsApplicationControlSource_Storage, app_id, tmp_control_data, sizeof(NsApplicationControlData), nullptr))) {
-                LoadControlDataStrings(out_control, &tmp_control_data->nacp);        
+                LoadControlDataStrings(out_control, &tmp_control_data->nacp);
             }
+            delete tmp_control_data;
         }
 
         inline void EnsureApplicationRecords(const bool reload = false) {
+            ScopedLock lk(g_ApplicationRecordsLock);
             if(reload || g_ApplicationRecords.empty()) {
                 g_ApplicationRecords = os::ListApplicationRecords();
-            }
-        }
 
-        inline std::string MakeEntryPath(const std::string &base_path, const u32 idx) {
-            return fs::JoinPath(base_path, std::to_string(idx) + ".m.json");
+                g_ApplicationRecordTable.clear();
+                g_ApplicationRecordTable.reserve(g_ApplicationRecords.size());
+                for(size_t i = 0; i < g_ApplicationRecords.size(); i++) {
+                    g_ApplicationRecordTable[g_ApplicationRecords.at(i).application_id] = i;
+                }
+            }
         }
 
-        inline std::string MakeEntryFolderPath(const std::string &base_path, const std::string &name, const u32 name_idx) {
-            return fs::JoinPath(base_path, "folder_" + name + "_" + std::to_string(name_idx));
+        bool FindApplicationRecord(const u64 app_id, NsApplicationRecord &out_record) {
+            ScopedLock lk(g_ApplicationRecordsLock);
+            const auto find_rec = g_ApplicationRecordTable.find(app_id);
+            if(find_rec != g_ApplicationRecordTable.end()) {
+                out_record = g_ApplicationRecords.at(find_rec->second);
+                return true;
+            }
+            else {
+                return false;
+            }
         }
 
-        u32 FindNextEntryIndex(const std::string &base_path) {
-            u32 cur_idx = 0;
-            while(fs::ExistsFile(MakeEntryPath(base_path, cur_idx))) {
-                cur_idx++;
+        void UpdateApplicationRecord(const NsApplicationRecord &record) {
+            ScopedLock lk(g_ApplicationRecordsLock);
+            const auto find_rec = g_ApplicationRecordTable.find(record.application_id);
+            if(find_rec != g_ApplicationRecordTable.end()) {
+                g_ApplicationRecords.at(find_rec->second) = record;
+            }
+            else {
+                g_ApplicationRecordTable[record.application_id] = g_ApplicationRecords.size();
+                g_ApplicationRecords.push_back(record);
             }
-            return cur_idx;
         }
 
-        u32 FindNextFolderNameIndex(const std::string &base_path, const std::string &name) {
-            u32 cur_idx = 0;
-            while(fs::ExistsFile(MakeEntryFolderPath(base_path, name, cur_idx))) {
-                cur_idx++;
-            }
-            return cur_idx;
+        inline std::string MakeEntryFolderPath(const std::string &base_path, const std::string &name, const u32 name_idx) {
+            return fs::JoinPath(base_path, "folder_" + name + "_" + std::to_string(name_idx));
         }
 
         std::string MakeAsciiString(const std::string &str) {
@@ -94,35 +206,583 @@ namespace ul::menu {
             return ascii_str;
         }
 
-        inline std::string MakeNextFolderPath(const std::string &base_path, const std::string &folder_name) {
-            // Ensure the filesystem folder name is ASCII for FS, while the actual folder name is saved in its JSON data
+        std::string MakeNextFolderPath(const std::string &base_path, const std::string &folder_name, EntryIndex &base_index) {
+            // Ensure the filesystem folder name is ASCII for FS, while the actual folder name is saved in the entry index
             auto ascii_name = MakeAsciiString(folder_name);
             if(ascii_name.empty()) {
                 ascii_name = "null";
             }
 
-            return MakeEntryFolderPath(base_path, ascii_name, FindNextFolderNameIndex(base_path, ascii_name));
+            // The name index counter is kept in the parent folder's index, the directory is only checked in case the counter is stale
+            auto folder_path = MakeEntryFolderPath(base_path, ascii_name, base_index.AllocateFolderNameIndex());
+            while(fs::ExistsDirectory(folder_path)) {
+                folder_path = MakeEntryFolderPath(base_path, ascii_name, base_index.AllocateFolderNameIndex());
+            }
+            return folder_path;
         }
 
-        std::string FindRootFolderPath(const std::string &folder_name) {
-            UL_FS_FOR(MenuPath, entry_name, entry_path, is_dir, is_file, {
-                if(is_file && util::StringEndsWith(entry_name, ".m.json")) {
-                    util::JSON folder_json;
-                    if(R_SUCCEEDED(util::LoadJSONFromFile(folder_json, entry_path))) {
-                        const auto type = static_cast<EntryType>(folder_json.value("type", static_cast<u32>(EntryType::Invalid)));
-                        if(type == EntryType::Folder) {
-                            const auto name = folder_json.value("name", "");
-                            const auto fs_name = folder_json.value("fs_name", "");
-                            if(folder_name == name) {
-                                return fs::JoinPath(MenuPath, fs_name);
+        util::JSON ConvertEntryToJson(const Entry &entry) {
+            auto entry_json = util::JSON::object();
+            entry_json["type"] = static_cast<u32>(entry.type);
+
+            if(entry.control.custom_name) {
+                entry_json["custom_name"] = entry.control.name;
+            }
+            if(entry.control.custom_author) {
+                entry_json["custom_author"] = entry.control.author;
+            }
+            if(entry.control.custom_version) {
+                entry_json["custom_version"] = entry.control.version;
+            }
+            if(entry.control.custom_icon_path) {
+                entry_json["custom_icon_path"] = entry.control.icon_path;
+            }
+
+            switch(entry.type) {
+                case EntryType::Application: {
+                    entry_json["application_id"] = entry.app_info.app_id;
+                    break;
+                }
+                case EntryType::Homebrew: {
+                    entry_json["nro_path"] = entry.hb_info.nro_path;
+                    entry_json["nro_argv"] = entry.hb_info.nro_argv;
+                    break;
+                }
+                case EntryType::Folder: {
+                    entry_json["name"] = entry.folder_info.name;
+                    entry_json["fs_name"] = entry.folder_info.fs_name;
+                    break;
+                }
+                default:
+                    break;
+            }
+
+            return entry_json;
+        }
+
+        std::vector<Entry> LoadLegacyEntries(const std::string &path, std::vector<std::string> &out_legacy_entry_paths) {
+            std::vector<Entry> entries;
+            UL_FS_FOR(path, entry_name, entry_path, is_dir, is_file, {
+                if(is_file && util::StringEndsWith(entry_name, LegacyEntryExtension)) {
+                    util::JSON entry_json;
+                    if(R_SUCCEEDED(util::LoadJSONFromFile(entry_json, entry_path))) {
+                        const auto entry_index_str = entry_name.substr(0, entry_name.length() - __builtin_strlen(LegacyEntryExtension));
+                        const auto entry_index = std::strtoul(entry_index_str.c_str(), nullptr, 10);
+                        if(entry_index >= EntryIndex::MaxSlotCount) {
+                            UL_LOG_WARN("Skipping legacy menu entry '%s' with an out of range index", entry_path.c_str());
+                            continue;
+                        }
+                        out_legacy_entry_paths.push_back(entry_path);
+
+                        const auto type = static_cast<EntryType>(entry_json.value("type", static_cast<u32>(EntryType::Invalid)));
+                        const auto custom_name = entry_json.value("custom_name", "");
+                        const auto custom_author = entry_json.value("custom_author", "");
+                        const auto custom_version = entry_json.value("custom_version", "");
+                        const auto custom_icon_path = entry_json.value("custom_icon_path", "");
+
+                        Entry entry = {
+                            .type = type,
+                            .entry_path = entry_path,
+                            .index = static_cast<u32>(entry_index),
+
+                            .control = {
+                                .name = custom_name,
+                                .custom_name = !custom_name.empty(),
+                                .author = custom_author,
+                                .custom_author = !custom_author.empty(),
+                                .version = custom_version,
+                                .custom_version = !custom_version.empty(),
+                                .icon_path = custom_icon_path,
+                                .custom_icon_path = !custom_icon_path.empty()
+                            }
+                        };
+
+                        switch(type) {
+                            case EntryType::Application: {
+                                entry.app_info = {
+                                    .app_id = entry_json.value("application_id", static_cast<u64>(0))
+                                };
+                                break;
+                            }
+                            case EntryType::Homebrew: {
+                                const auto nro_path = entry_json.value("nro_path", "");
+                                const auto nro_argv = entry_json.value("nro_argv", "");
+                                entry.hb_info = {
+                                    .nro_path = nro_path,
+                                    .nro_argv = nro_argv
+                                };
+                                break;
                             }
+                            case EntryType::Folder: {
+                                const auto name = entry_json.value("name", "");
+                                const auto fs_name = entry_json.value("fs_name", "");
+                                entry.folder_info = {
+                                    .name = name,
+                                    .fs_name = fs_name
+                                };
+                                break;
+                            }
+                            default:
+                                break;
                         }
+
+                        entries.push_back(std::move(entry));
                     }
                 }
             });
 
+            return entries;
+        }
+
+        void UpdateApplicationEntryIndex(const std::string &path, const EntryIndex &index) {
+            // A missing/invalid reverse index is left as it is (rather than saving one with just this folder), the next lookup rebuilds it from the whole tree
+            ApplicationEntryIndex app_index;
+            if(!ReadApplicationEntryIndex(app_index)) {
+                return;
+            }
+            if(app_index.UpdateFolder(path, index)) {
+                if(!WriteApplicationEntryIndex(app_index)) {
+                    UL_LOG_WARN("Unable to save application entry index");
+                }
+            }
+        }
+
+        void RenameApplicationEntryFolder(const std::string &old_folder_path, const std::string &new_folder_path) {
+            ApplicationEntryIndex app_index;
+            if(ReadApplicationEntryIndex(app_index)) {
+                app_index.RenameFolder(old_folder_path, new_folder_path);
+                WriteApplicationEntryIndex(app_index);
+            }
+        }
+
+        void RemoveApplicationEntryFolder(const std::string &folder_path) {
+            ApplicationEntryIndex app_index;
+            if(ReadApplicationEntryIndex(app_index)) {
+                app_index.RemoveFolder(folder_path);
+                WriteApplicationEntryIndex(app_index);
+            }
+        }
+
+        void UpdateEntryTreeFolder(const std::string &path, const EntryIndex &index) {
+            ScopedLock lk(g_EntryTreeLock);
+            if(g_EntryTreeLoaded) {
+                g_EntryTree.folders[path] = index;
+            }
+            if(g_EntrySearchIndexOwned) {
+                g_EntrySearchIndexDirty |= g_EntrySearchIndex.UpdateFolder(path, index, ResolveEntrySearchStrings, StampEntrySearchSource);
+            }
+        }
+
+        void RenameEntryTreeFolder(const std::string &old_folder_path, const std::string &new_folder_path) {
+            ScopedLock lk(g_EntryTreeLock);
+            if(g_EntryTreeLoaded) {
+                g_EntryTree.RenameFolder(old_folder_path, new_folder_path);
+            }
+            if(g_EntrySearchIndexOwned) {
+                g_EntrySearchIndex.RenameFolder(old_folder_path, new_folder_path);
+                g_EntrySearchIndexDirty = true;
+            }
+        }
+
+        void RemoveEntryTreeFolder(const std::string &folder_path) {
+            ScopedLock lk(g_EntryTreeLock);
+            if(g_EntryTreeLoaded) {
+                g_EntryTree.RemoveFolder(folder_path);
+            }
+            if(g_EntrySearchIndexOwned) {
+                g_EntrySearchIndex.RemoveFolder(folder_path);
+                g_EntrySearchIndexDirty = true;
+            }
+        }
+
+        void SaveEntrySearchIndex() {
+            ScopedLock lk(g_EntryTreeLock);
+            if(g_EntrySearchIndexOwned && g_EntrySearchIndexDirty) {
+                if(WriteEntrySearchIndex(g_EntrySearchIndex)) {
+                    g_EntrySearchIndexDirty = false;
+                }
+                else {
+                    UL_LOG_WARN("Unable to save menu entry search index");
+                }
+            }
+        }
+
+        void SyncEntrySearchIndex(const std::vector<std::string> &changed_folder_paths) {
+            // Changed folders and the ones new to the tree are updated, while the ones no longer in the tree (moved/deleted) are dropped
+            ScopedLock lk(g_EntryTreeLock);
+            if(!g_EntrySearchIndexOwned) {
+                return;
+            }
+
+            for(const auto &[folder_path, index]: g_EntryTree.folders) {
+                if(!g_EntrySearchIndex.folder_document_ids.contains(folder_path) || (std::find(changed_folder_paths.begin(), changed_folder_paths.end(), folder_path) != changed_folder_paths.end())) {
+                    g_EntrySearchIndexDirty |= g_EntrySearchIndex.UpdateFolder(folder_path, index, ResolveEntrySearchStrings, StampEntrySearchSource);
+                }
+            }
+
+            std::vector<std::string> removed_folder_paths;
+            for(const auto &[folder_path, doc_ids]: g_EntrySearchIndex.folder_document_ids) {
+                if(!g_EntryTree.folders.contains(folder_path)) {
+                    removed_folder_paths.push_back(folder_path);
+                }
+            }
+            for(const auto &folder_path: removed_folder_paths) {
+                g_EntrySearchIndex.RemoveFolder(folder_path);
+                g_EntrySearchIndexDirty = true;
+            }
+
+            SaveEntrySearchIndex();
+        }
+
+        void LoadEntrySearchIndex() {
+            ScopedLock lk(g_EntryTreeLock);
+            if(!g_EntrySearchIndexOwned) {
+                // Not being there is fine, search just won't find anything
+                ReadEntrySearchIndex(g_EntrySearchIndex);
+                g_EntrySearchIndexLoaded = true;
+            }
+        }
+
+        void LoadEntryTreeFolder(const std::string &path) {
+            EntryIndex index = {};
+            if(!ReadEntryIndex(path, index)) {
+                return;
+            }
+
+            for(const auto &entry: index.entries) {
+                if(entry.Is<EntryType::Folder>()) {
+                    const auto folder_path = entry.GetFolderPath();
+                    if(!g_EntryTree.folders.contains(folder_path)) {
+                        LoadEntryTreeFolder(folder_path);
+                    }
+                }
+            }
+            g_EntryTree.folders[path] = std::move(index);
+        }
+
+        bool RefreshEntryTreeSnapshot() {
+            ScopedLock lk(g_EntryTreeLock);
+            if(g_EntrySnapshotAddress == nullptr) {
+                return g_EntryTreeLoaded;
+            }
+            if(g_EntryTreeLoaded && (GetEntrySnapshotGeneration(g_EntrySnapshotAddress) == g_EntrySnapshotGeneration)) {
+                return true;
+            }
+
+            std::vector<u8> snapshot_data;
+            g_EntryTreeLoaded = ReadEntrySnapshot(g_EntrySnapshotAddress, g_EntrySnapshotSize, g_EntrySnapshotGeneration, snapshot_data) && ParseEntrySnapshot(snapshot_data.data(), snapshot_data.size(), g_EntryTree);
+            if(!g_EntryTreeLoaded) {
+                UL_LOG_WARN("Unable to load menu entry snapshot, falling back to the SD card...");
+                g_EntryTree = {};
+            }
+
+            // The owner saves the search index before publishing every snapshot, thus it's reloaded along with it (and never while searching)
+            LoadEntrySearchIndex();
+            // Same goes for icons/strings of new applications, which are cached before their entries get published
+            RefreshCaches();
+            return g_EntryTreeLoaded;
+        }
+
+        EntryIndex LoadIndexedEntries(const std::string &path) {
+            EntryIndex index = {};
+            if(ReadEntryIndex(path, index)) {
+                return index;
+            }
+
+            // No (valid) index: migrate any legacy JSON entries present into a new index
+            // A corrupted index is left untouched unless there is something to migrate, so that it can still be recovered
+            const auto index_exists = fs::ExistsFile(MakeEntryIndexPath(path));
+            std::vector<std::string> legacy_entry_paths;
+            index.entries = LoadLegacyEntries(path, legacy_entry_paths);
+            index.RebuildSlotBitmap();
+            if(!index_exists || !legacy_entry_paths.empty()) {
+                std::sort(index.entries.begin(), index.entries.end());
+                if(WriteEntryIndex(path, index)) {
+                    UpdateApplicationEntryIndex(path, index);
+                    UpdateEntryTreeFolder(path, index);
+                    for(const auto &legacy_entry_path: legacy_entry_paths) {
+                        fs::DeleteFile(legacy_entry_path);
+                    }
+
+                    if(!legacy_entry_paths.empty()) {
+                        UL_LOG_INFO("Migrated %zu legacy menu entries at '%s'", legacy_entry_paths.size(), path.c_str());
+                    }
+                }
+            }
+
+            return index;
+        }
+
+        inline void SaveIndexedEntries(const std::string &path, EntryIndex &index) {
+            std::sort(index.entries.begin(), index.entries.end());
+            if(WriteEntryIndex(path, index)) {
+                UpdateApplicationEntryIndex(path, index);
+                UpdateEntryTreeFolder(path, index);
+            }
+            else {
+                UL_LOG_WARN("Unable to save menu entry index at '%s'", path.c_str());
+            }
+        }
+
+        void SetIndexFolderPath(EntryIndex &index, const std::string &folder_path) {
+            for(auto &entry: index.entries) {
+                entry.entry_path = MakeEntryPath(folder_path, entry.index);
+            }
+        }
+
+        EntryStats ComputeFolderStats(const EntryIndex &index) {
+            EntryStats stats = {
+                .child_count = static_cast<u32>(index.entries.size())
+            };
+            for(const auto &entry: index.entries) {
+                stats.size += entry.stats.size;
+                stats.last_launch_time = std::max(stats.last_launch_time, entry.stats.last_launch_time);
+            }
+            return stats;
+        }
+
+        inline size_t GetPathDepth(const std::string &path) {
+            return std::count(path.begin(), path.end(), '/');
+        }
+
+        void UpdateFolderStats(std::unordered_map<std::string, EntryIndex> &indexes) {
+            // Deepest folders go first, so that changes propagate up to the root folder
+            // Parent indexes not affected by the changes are only kept (and thus saved later) if their folder entry stats actually changed
+            std::vector<std::string> pending_paths;
+            for(const auto &[folder_path, index]: indexes) {
+                pending_paths.push_back(folder_path);
+            }
+
+            while(!pending_paths.empty()) {
+                const auto deepest_path_it = std::max_element(pending_paths.begin(), pending_paths.end(), [](const std::string &path_a, const std::string &path_b) -> bool {
+                    return GetPathDepth(path_a) < GetPathDepth(path_b);
+                });
+                const auto folder_path = *deepest_path_it;
+                pending_paths.erase(deepest_path_it);
+
+                if((folder_path == MenuPath) || !IsPathWithin(folder_path, MenuPath)) {
+                    continue;
+                }
+
+                const auto stats = ComputeFolderStats(indexes.at(folder_path));
+                const auto parent_path = fs::GetBaseDirectory(folder_path);
+                const auto fs_name = fs::GetBaseName(folder_path);
+
+                auto find_parent_index = indexes.find(parent_path);
+                auto parent_index = (find_parent_index != indexes.end()) ? find_parent_index->second : LoadIndexedEntries(parent_path);
+                for(auto &entry: parent_index.entries) {
+                    if(entry.Is<EntryType::Folder>() && (fs_name == entry.folder_info.fs_name)) {
+                        if(entry.stats != stats) {
+                            entry.stats = stats;
+                            indexes[parent_path] = std::move(parent_index);
+                            if(std::find(pending_paths.begin(), pending_paths.end(), parent_path) == pending_paths.end()) {
+                                pending_paths.push_back(parent_path);
+                            }
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+
+        std::vector<std::string> ApplyEntryJournalOperations(const std::vector<EntryJournalOperation> &ops) {
+            // Every affected index is loaded/saved just once, except for the ones affected by folder renames (which are saved before renaming)
+            std::unordered_map<std::string, EntryIndex> indexes;
+            // Folders whose indexes were saved/renamed, for the changed entries callback
+            std::vector<std::string> changed_paths;
+            const auto get_index = [&](const std::string &folder_path) -> EntryIndex& {
+                auto find_index = indexes.find(folder_path);
+                if(find_index == indexes.end()) {
+                    find_index = indexes.emplace(folder_path, LoadIndexedEntries(folder_path)).first;
+                }
+                return find_index->second;
+            };
+            const auto flush_indexes = [&](const std::string &base_path, const bool save) {
+                if(save) {
+                    UpdateFolderStats(indexes);
+                }
+                for(auto it = indexes.begin(); it != indexes.end();) {
+                    if(IsPathWithin(it->first, base_path)) {
+                        if(save) {
+                            SaveIndexedEntries(it->first, it->second);
+                            changed_paths.push_back(it->first);
+                        }
+                        it = indexes.erase(it);
+                    }
+                    else {
+                        it++;
+                    }
+                }
+            };
+
+            for(const auto &op: ops) {
+                switch(op.type) {
+                    case EntryJournalOperationType::PutEntry: {
+                        get_index(op.path).Upsert(op.entry);
+                        break;
+                    }
+                    case EntryJournalOperationType::EraseEntry: {
+                        get_index(op.path).Remove(op.value);
+                        break;
+                    }
+                    case EntryJournalOperationType::SetFolderNameIndex: {
+                        auto &index = get_index(op.path);
+                        index.next_folder_name_idx = std::max(index.next_folder_name_idx, op.value);
+                        break;
+                    }
+                    case EntryJournalOperationType::RenameFolder: {
+                        flush_indexes(op.path, true);
+                        // Might have already been renamed, if the journal is being replayed
+                        if(fs::ExistsDirectory(op.path) && !fs::ExistsDirectory(op.new_path)) {
+                            fs::RenameDirectory(op.path, op.new_path);
+                            RenameApplicationEntryFolder(op.path, op.new_path);
+                            RenameEntryTreeFolder(op.path, op.new_path);
+                        }
+                        changed_paths.push_back(op.new_path);
+                        break;
+                    }
+                    case EntryJournalOperationType::DeleteFolder: {
+                        flush_indexes(op.path, false);
+                        if(fs::ExistsDirectory(op.path)) {
+                            fs::DeleteDirectory(op.path);
+                            RemoveApplicationEntryFolder(op.path);
+                            RemoveEntryTreeFolder(op.path);
+                        }
+                        break;
+                    }
+                }
+            }
+
+            UpdateFolderStats(indexes);
+            for(auto &[folder_path, index]: indexes) {
+                SaveIndexedEntries(folder_path, index);
+                changed_paths.push_back(folder_path);
+            }
+
+            std::sort(changed_paths.begin(), changed_paths.end());
+            changed_paths.erase(std::unique(changed_paths.begin(), changed_paths.end()), changed_paths.end());
+            return changed_paths;
+        }
+
+        EntryStats RefreshEntryStats(const std::string &path) {
+            // Fills stats missing in indexes from older versions, which were not tracked back then
+            auto index = LoadIndexedEntries(path);
+            for(auto &entry: index.entries) {
+                if(entry.Is<EntryType::Application>()) {
+                    if(R_FAILED(os::GetApplicationOccupiedSize(entry.app_info.app_id, entry.stats.size))) {
+                        entry.stats.size = 0;
+                    }
+                }
+                else if(entry.Is<EntryType::Folder>()) {
+                    entry.stats = RefreshEntryStats(entry.GetFolderPath());
+                }
+            }
+
+            SaveIndexedEntries(path, index);
+            return ComputeFolderStats(index);
+        }
+
+        void ReplayEntryJournal() {
+            std::vector<std::vector<EntryJournalOperation>> batches;
+            if(ReadEntryJournal(batches)) {
+                // Operations are idempotent, thus replaying already applied batches is harmless
+                std::vector<EntryJournalOperation> ops;
+                for(auto &batch_ops: batches) {
+                    ops.insert(ops.end(), std::make_move_iterator(batch_ops.begin()), std::make_move_iterator(batch_ops.end()));
+                }
+
+                UL_LOG_INFO("Replaying %zu menu entry journal batches (%zu operations)...", batches.size(), ops.size());
+                ApplyEntryJournalOperations(ops);
+                ClearEntryJournal();
+            }
+        }
+
+        void CollectApplicationEntryLocations(const std::string &path, ApplicationEntryIndex &out_app_index) {
+            const auto index = LoadIndexedEntries(path);
+            out_app_index.UpdateFolder(path, index);
+
+            for(const auto &entry: index.entries) {
+                if(entry.Is<EntryType::Folder>()) {
+                    CollectApplicationEntryLocations(entry.GetFolderPath(), out_app_index);
+                }
+            }
+        }
+
+        void RebuildApplicationEntryIndex(ApplicationEntryIndex &out_app_index) {
+            UL_LOG_INFO("Rebuilding application entry index...");
+
+            out_app_index = {};
+            CollectApplicationEntryLocations(MenuPath, out_app_index);
+            if(!WriteApplicationEntryIndex(out_app_index)) {
+                UL_LOG_WARN("Unable to save application entry index");
+            }
+        }
+
+        bool CheckApplicationEntryLocations(const u64 app_id, const std::vector<ApplicationEntryLocation> &app_locations, std::vector<Entry> &out_entries) {
+            for(const auto &location: app_locations) {
+                auto index = LoadIndexedEntries(location.folder_path);
+                const auto entry = index.Find(location.index);
+                if((entry == nullptr) || !entry->Is<EntryType::Application>() || (entry->app_info.app_id != app_id)) {
+                    return false;
+                }
+
+                out_entries.push_back(*entry);
+            }
+
+            // Every mutation keeps the index up to date, thus no locations just means no entries
+            return true;
+        }
+
+        bool LoadEntryRuntimeInfo(Entry &entry) {
+            switch(entry.type) {
+                case EntryType::Application: {
+                    const auto application_id = entry.app_info.app_id;
+
+                    // Meta status is not loaded here, in order to keep NS commands out of folder loading
+                    entry.app_info.meta_status_loaded = false;
+
+                    if(!FindApplicationRecord(application_id, entry.app_info.record)) {
+                        UL_LOG_WARN("Invalid application entry with no application record");
+                    }
+                    return true;
+                }
+                case EntryType::Homebrew: {
+                    return true;
+                }
+                case EntryType::Folder: {
+                    if(entry.folder_info.name.empty()) {
+                        UL_LOG_WARN("Invalid folder entry with empty name");
+                        return false;
+                    }
+                    if(entry.folder_info.fs_name.empty()) {
+                        UL_LOG_WARN("Invalid folder entry with empty filesystem-name");
+                        return false;
+                    }
+                    return true;
+                }
+                case EntryType::SpecialEntryMiiEdit:
+                case EntryType::SpecialEntryWebBrowser:
+                case EntryType::SpecialEntryUserPage:
+                case EntryType::SpecialEntrySettings:
+                case EntryType::SpecialEntryThemes:
+                case EntryType::SpecialEntryControllers:
+                case EntryType::SpecialEntryAlbum:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        std::string FindRootFolderPath(const std::string &folder_name) {
+            auto root_index = LoadIndexedEntries(MenuPath);
+            for(const auto &entry: root_index.entries) {
+                if(entry.Is<EntryType::Folder>() && (folder_name == entry.folder_info.name)) {
+                    return fs::JoinPath(MenuPath, entry.folder_info.fs_name);
+                }
+            }
+
             // Not existing, create it
-            const auto new_folder_idx = FindNextEntryIndex(MenuPath);
+            const auto new_folder_idx = root_index.FindFreeSlot();
             const auto new_folder_entry = CreateFolderEntry(MenuPath, folder_name, new_folder_idx);
             return fs::JoinPath(MenuPath, new_folder_entry.folder_info.fs_name);
         }
@@ -130,17 +790,22 @@ namespace ul::menu {
         void InitializeRemainingEntries(const std::vector<NsApplicationRecord> &remaining_apps, u32 &entry_idx) {
             const std::vector<std::string> DefaultHomebrewRecordPaths = { HbmenuPath, ManagerPath };
 
+            // All these entries go to the root folder, thus its index is just saved once at the end
+            EntryTransaction txn;
+
             // Add special homebrew entries
             for(const auto &nro_path : DefaultHomebrewRecordPaths) {
                 const Entry hb_entry = {
                     .type = EntryType::Homebrew,
                     .entry_path = MakeEntryPath(MenuPath, entry_idx),
+                    .index = entry_idx,
 
                     .hb_info = {
-                        .nro_target = loader::TargetInput::Create(nro_path, nro_path, true, "")
+                        .nro_path = nro_path,
+                        .nro_argv = nro_path
                     }
                 };
-                hb_entry.Save();
+                txn.Save(hb_entry);
                 entry_idx++;
             }
 
@@ -148,9 +813,10 @@ namespace ul::menu {
             #define _UL_MENU_ADD_SPECIAL_ENTRY(kind) { \
                 const Entry special_entry = { \
                     .type = kind, \
-                    .entry_path = MakeEntryPath(MenuPath, entry_idx) \
+                    .entry_path = MakeEntryPath(MenuPath, entry_idx), \
+                    .index = entry_idx \
                 }; \
-                special_entry.Save(); \
+                txn.Save(special_entry); \
                 entry_idx++; \
             }
             _UL_MENU_ADD_SPECIAL_ENTRY(EntryType::SpecialEntryMiiEdit);
@@ -166,15 +832,19 @@ namespace ul::menu {
                 Entry app_entry = {
                     .type = EntryType::Application,
                     .entry_path = MakeEntryPath(MenuPath, entry_idx),
+                    .index = entry_idx,
 
                     .app_info = {
                         .app_id = app_record.application_id,
                         .record = app_record
                     }
                 };
-                app_entry.Save();
+                os::GetApplicationOccupiedSize(app_record.application_id, app_entry.stats.size);
+                txn.Save(app_entry);
                 entry_idx++;
             }
+
+            txn.Commit();
         }
 
         void ConvertOldMenu(u32 &entry_idx) {
@@ -184,7 +854,8 @@ namespace ul::menu {
                 }
 
                 EnsureApplicationRecords();
-                auto apps_copy = g_ApplicationRecords;
+                // Records already used by converted entries, to be skipped when adding the remaining ones
+                std::vector<bool> apps_converted(g_ApplicationRecords.size(), false);
 
                 UL_FS_FOR(OldMenuPath, old_entry_name, old_entry_path, is_dir, is_file, {
                     util::JSON old_entry_json;
@@ -204,17 +875,17 @@ namespace ul::menu {
                         Entry entry = {
                             .type = type,
                             .entry_path = MakeEntryPath(base_path, entry_idx),
-                            .index = 0,
+                            .index = entry_idx,
 
                             .control = {
                                 .name = custom_name,
                                 .custom_name = !custom_name.empty(),
                                 .author = custom_author,
-                                .custom_author = !custom_name.empty(),
+                                .custom_author = !custom_author.empty(),
                                 .version = custom_version,
-                                .custom_version = !custom_name.empty(),
+                                .custom_version = !custom_version.empty(),
                                 .icon_path = custom_icon_path,
-                                .custom_icon_path = !custom_name.empty(),
+                                .custom_icon_path = !custom_icon_path.empty()
                             }
                         };
                         entry_idx++;
@@ -225,12 +896,11 @@ namespace ul::menu {
                                 const auto application_id = util::Get64FromString(application_id_fmt);
                                 entry.app_info.app_id = application_id;
 
-                                const auto find_rec = std::find_if(apps_copy.begin(), apps_copy.end(), [&](const NsApplicationRecord &rec) -> bool {
-                                    return rec.application_id == application_id;
-                                });
-                                if(find_rec != apps_copy.end()) {
-                                    entry.app_info.record = *find_rec;
-                                    apps_copy.erase(find_rec);
+                                const auto find_rec = g_ApplicationRecordTable.find(application_id);
+                                if((find_rec != g_ApplicationRecordTable.end()) && !apps_converted.at(find_rec->second)) {
+                                    entry.app_info.record = g_ApplicationRecords.at(find_rec->second);
+                                    apps_converted.at(find_rec->second) = true;
+                                    os::GetApplicationOccupiedSize(application_id, entry.stats.size);
 
                                     entry.Save();
                                 }
@@ -245,7 +915,8 @@ namespace ul::menu {
 
                                 if(fs::ExistsFile(nro_path)) {
                                     entry.hb_info = {
-                                        .nro_target = loader::TargetInput::Create(nro_path, nro_argv, true, "")
+                                        .nro_path = nro_path,
+                                        .nro_argv = nro_argv
                                     };
 
                                     entry.Save();
@@ -261,7 +932,13 @@ namespace ul::menu {
                     }
                 });
 
-                InitializeRemainingEntries(apps_copy, entry_idx);
+                std::vector<NsApplicationRecord> remaining_apps;
+                for(size_t i = 0; i < g_ApplicationRecords.size(); i++) {
+                    if(!apps_converted.at(i)) {
+                        remaining_apps.push_back(g_ApplicationRecords.at(i));
+                    }
+                }
+                InitializeRemainingEntries(remaining_apps, entry_idx);
 
                 fs::DeleteDirectory(OldMenuPath);
             }
@@ -273,11 +950,11 @@ namespace ul::menu {
         if(!this->control.IsLoaded()) {
             switch(this->type) {
                 case EntryType::Application: {
-                    LoadApplicationControlData(this->app_info.record.application_id, this->control);
+                    LoadApplicationControlData(this->app_info.app_id, this->control);
                     break;
                 }
                 case EntryType::Homebrew: {
-                    LoadHomebrewControlData(this->hb_info.nro_target.nro_path, this->control);
+                    LoadHomebrewControlData(this->hb_info.nro_path, this->control);
                     break;
                 }
                 default:
@@ -287,130 +964,253 @@ namespace ul::menu {
         }
     }
 
+    bool Entry::LoadRuntimeInfo() {
+        return LoadEntryRuntimeInfo(*this);
+    }
+
+    void Entry::TryLoadApplicationMetaStatus() {
+        if(this->Is<EntryType::Application>() && !this->app_info.meta_status_loaded) {
+            if(R_FAILED(os::GetApplicationContentMetaStatus(this->app_info.app_id, this->app_info.meta_status))) {
+                UL_LOG_WARN("Invalid application entry with no application meta status");
+            }
+
+            // Don't retry on failure either
+            this->app_info.meta_status_loaded = true;
+        }
+    }
+
     void Entry::ReloadApplicationInfo() {
         if(this->Is<EntryType::Application>()) {
-            const auto app_id = this->app_info.record.application_id;
+            const auto app_id = this->app_info.app_id;
+
+            this->app_info.meta_status_loaded = false;
+            this->TryLoadApplicationMetaStatus();
+
+            // Only look for this application's record, instead of reloading all of them
+            NsApplicationRecord record;
+            if(os::FindApplicationRecord(app_id, record)) {
+                this->app_info.record = record;
+                UpdateApplicationRecord(record);
+            }
+            else {
+                UL_LOG_WARN("Unable to reload application record (not found...?)");
+            }
+        }
+    }
 
-            if(R_FAILED(os::GetApplicationContentMetaStatus(app_id, this->app_info.meta_status))) {
-                UL_LOG_WARN("Unable to reload application meta status (not found...?)");
+    EntryIndex &EntryTransaction::GetIndex(const std::string &folder_path) {
+        auto find_index = this->indexes.find(folder_path);
+        if(find_index == this->indexes.end()) {
+            // The folder (or a parent one) might have been renamed by this transaction, thus still being at its old path
+            auto fs_folder_path = folder_path;
+            for(auto it = this->pending_folder_renames.rbegin(); it != this->pending_folder_renames.rend(); it++) {
+                const auto &[old_path, new_path] = *it;
+                if(IsPathWithin(fs_folder_path, new_path)) {
+                    fs_folder_path = old_path + fs_folder_path.substr(new_path.length());
+                }
             }
 
-            // Assume we need to reload here
-            EnsureApplicationRecords(true);
+            auto index = LoadIndexedEntries(fs_folder_path);
+            SetIndexFolderPath(index, folder_path);
+            find_index = this->indexes.emplace(folder_path, std::move(index)).first;
+        }
+        return find_index->second;
+    }
 
-            const auto find_rec = std::find_if(g_ApplicationRecords.begin(), g_ApplicationRecords.end(), [&](const NsApplicationRecord &rec) -> bool {
-                return rec.application_id == app_id;
-            });
-            if(find_rec != g_ApplicationRecords.end()) {
-                this->app_info.record = *find_rec;
+    void EntryTransaction::PutEntry(const Entry &entry) {
+        const auto folder_path = fs::GetBaseDirectory(entry.entry_path);
+        this->GetIndex(folder_path).Upsert(entry);
+        this->ops.push_back({
+            .type = EntryJournalOperationType::PutEntry,
+            .path = folder_path,
+            .entry = entry
+        });
+    }
+
+    void EntryTransaction::EraseEntry(const std::string &folder_path, const u32 slot) {
+        this->GetIndex(folder_path).Remove(slot);
+        this->ops.push_back({
+            .type = EntryJournalOperationType::EraseEntry,
+            .path = folder_path,
+            .value = slot
+        });
+    }
+
+    void EntryTransaction::MoveFolder(Entry &folder_entry, const std::string &new_folder_path) {
+        const auto old_fs_path = folder_entry.GetFolderPath();
+        const auto new_fs_path = this->AllocateFolderPath(new_folder_path, folder_entry.folder_info.name);
+        folder_entry.folder_info.fs_name = fs::GetBaseName(new_fs_path);
+
+        this->ops.push_back({
+            .type = EntryJournalOperationType::RenameFolder,
+            .path = old_fs_path,
+            .new_path = new_fs_path
+        });
+        this->pending_folder_renames.push_back({ old_fs_path, new_fs_path });
+
+        // Already loaded indexes inside the folder are moved along with it
+        std::vector<std::pair<std::string, EntryIndex>> moved_indexes;
+        for(auto it = this->indexes.begin(); it != this->indexes.end();) {
+            if(IsPathWithin(it->first, old_fs_path)) {
+                moved_indexes.push_back({ new_fs_path + it->first.substr(old_fs_path.length()), std::move(it->second) });
+                it = this->indexes.erase(it);
             }
             else {
-                UL_LOG_WARN("Unable to reload application record (not found...?)");
+                it++;
             }
         }
+        for(auto &[folder_path, index]: moved_indexes) {
+            SetIndexFolderPath(index, folder_path);
+            this->indexes.emplace(folder_path, std::move(index));
+        }
     }
 
-    void Entry::MoveTo(const std::string &new_folder_path) {
+    u32 EntryTransaction::FindFreeSlot(const std::string &folder_path) {
+        return this->GetIndex(folder_path).FindFreeSlot();
+    }
+
+    std::string EntryTransaction::AllocateFolderPath(const std::string &base_path, const std::string &folder_name) {
+        auto &base_index = this->GetIndex(base_path);
+        const auto folder_path = MakeNextFolderPath(base_path, folder_name, base_index);
+        this->ops.push_back({
+            .type = EntryJournalOperationType::SetFolderNameIndex,
+            .path = base_path,
+            .value = base_index.next_folder_name_idx
+        });
+        return folder_path;
+    }
+
+    void EntryTransaction::Save(const Entry &entry) {
+        this->PutEntry(entry);
+    }
+
+    void EntryTransaction::Move(Entry &entry, const std::string &new_folder_path) {
+        this->EraseEntry(fs::GetBaseDirectory(entry.entry_path), entry.index);
+
         // Must deal with folder renaming first, since the general moving code below will modify the folder path
-        if(this->Is<EntryType::Folder>()) {
-            const auto old_fs_path = this->GetFolderPath();
-            const auto new_fs_path = MakeNextFolderPath(new_folder_path, this->folder_info.name);
-            util::CopyToStringBuffer(this->folder_info.fs_name, fs::GetBaseName(new_fs_path));
-            fs::RenameDirectory(old_fs_path, new_fs_path);
+        if(entry.Is<EntryType::Folder>()) {
+            this->MoveFolder(entry, new_folder_path);
         }
 
-        const auto new_idx = FindNextEntryIndex(new_folder_path);
-        this->index = new_idx;
-        const auto new_entry_path = MakeEntryPath(new_folder_path, new_idx);
-        fs::RenameFile(this->entry_path, new_entry_path);
-        this->entry_path = new_entry_path;
-
-        this->Save();
+        entry.index = this->FindFreeSlot(new_folder_path);
+        entry.entry_path = MakeEntryPath(new_folder_path, entry.index);
+        this->PutEntry(entry);
     }
 
-    bool Entry::MoveToIndex(const u32 new_index) {
-        const auto cur_folder_path = fs::GetBaseDirectory(this->entry_path);
-        const auto new_entry_path = MakeEntryPath(cur_folder_path, new_index);
-        if(fs::ExistsFile(new_entry_path)) {
+    bool EntryTransaction::MoveToIndex(Entry &entry, const u32 new_index) {
+        const auto cur_folder_path = fs::GetBaseDirectory(entry.entry_path);
+        if(this->GetIndex(cur_folder_path).IsSlotUsed(new_index)) {
             return false;
         }
 
-        fs::RenameFile(this->entry_path, new_entry_path);
-        this->entry_path = new_entry_path;
-        this->index = new_index;
+        this->EraseEntry(cur_folder_path, entry.index);
+        entry.entry_path = MakeEntryPath(cur_folder_path, new_index);
+        entry.index = new_index;
+        this->PutEntry(entry);
         return true;
     }
 
-    void Entry::OrderSwap(Entry &other_entry) {
-        const auto tmp_entry_path = other_entry.entry_path + ".tmp";
-        fs::RenameDirectory(other_entry.entry_path, tmp_entry_path);
-        fs::RenameDirectory(this->entry_path, other_entry.entry_path);
-        fs::RenameDirectory(tmp_entry_path, this->entry_path);
-
-        std::swap(this->entry_path, other_entry.entry_path);
-        std::swap(this->index, other_entry.index);
+    void EntryTransaction::Swap(Entry &entry, Entry &other_entry) {
+        std::swap(entry.entry_path, other_entry.entry_path);
+        std::swap(entry.index, other_entry.index);
 
-        this->Save();
-        other_entry.Save();
+        // Both slots get overwritten with the swapped entries
+        this->PutEntry(entry);
+        this->PutEntry(other_entry);
     }
 
-    void Entry::Save() const {
-        auto entry_json = util::JSON::object();
-        entry_json["type"] = static_cast<u32>(this->type);
+    std::vector<Entry> EntryTransaction::Remove(Entry &entry) {
+        const auto cur_folder_path = fs::GetBaseDirectory(entry.entry_path);
+        this->EraseEntry(cur_folder_path, entry.index);
+
+        std::vector<Entry> folder_entries;
+        if(entry.Is<EntryType::Folder>()) {
+            const auto fs_path = entry.GetFolderPath();
+
+            // Move all the folder's entries to the parent folder
+            const auto folder_index_entries = this->GetIndex(fs_path).entries;
+            for(auto folder_entry: folder_index_entries) {
+                if(folder_entry.Is<EntryType::Folder>()) {
+                    this->MoveFolder(folder_entry, cur_folder_path);
+                }
 
-        if(this->control.custom_name) {
-            entry_json["custom_name"] = this->control.name;
+                folder_entry.index = this->FindFreeSlot(cur_folder_path);
+                folder_entry.entry_path = MakeEntryPath(cur_folder_path, folder_entry.index);
+                this->PutEntry(folder_entry);
+
+                if(LoadEntryRuntimeInfo(folder_entry)) {
+                    folder_entries.push_back(std::move(folder_entry));
+                }
+            }
+
+            this->indexes.erase(fs_path);
+            this->ops.push_back({
+                .type = EntryJournalOperationType::DeleteFolder,
+                .path = fs_path
+            });
         }
-        if(this->control.custom_author) {
-            entry_json["custom_author"] = this->control.author;
+
+        // Returns new entries present in the path where the entry (the folder actually) was removed
+        return folder_entries;
+    }
+
+    void EntryTransaction::Commit() {
+        if(this->ops.empty()) {
+            return;
         }
-        if(this->control.custom_version) {
-            entry_json["custom_version"] = this->control.version;
+
+        if(!AppendEntryJournalBatch(this->ops)) {
+            UL_LOG_WARN("Unable to append menu entry journal batch, applying it anyway...");
         }
-        if(this->control.custom_icon_path) {
-            entry_json["custom_icon_path"] = this->control.icon_path;
+        const auto changed_paths = ApplyEntryJournalOperations(this->ops);
+        SaveEntrySearchIndex();
+        if(g_OnEntriesChanged) {
+            g_OnEntriesChanged(changed_paths);
         }
 
-        switch(this->type) {
-            case EntryType::Application: {
-                entry_json["application_id"] = this->app_info.record.application_id;
-                break;
-            }
-            case EntryType::Homebrew: {
-                entry_json["nro_path"] = this->hb_info.nro_target.nro_path;
-                entry_json["nro_argv"] = this->hb_info.nro_target.nro_argv;
-                break;
-            }
-            case EntryType::Folder: {
-                entry_json["name"] = this->folder_info.name;
-                entry_json["fs_name"] = this->folder_info.fs_name;
-                break;
-            }
-            default:
-                break;
-        }
+        this->indexes.clear();
+        this->ops.clear();
+        this->pending_folder_renames.clear();
+    }
 
-        util::SaveJSON(this->entry_path, entry_json);
+    void Entry::MoveTo(const std::string &new_folder_path) {
+        EntryTransaction txn;
+        txn.Move(*this, new_folder_path);
+        txn.Commit();
     }
 
-    std::vector<Entry> Entry::Remove() {
-        fs::DeleteFile(this->entry_path);
+    bool Entry::MoveToIndex(const u32 new_index) {
+        EntryTransaction txn;
+        if(!txn.MoveToIndex(*this, new_index)) {
+            return false;
+        }
 
-        if(this->Is<EntryType::Folder>()) {
-            const auto fs_path = this->GetFolderPath();
+        txn.Commit();
+        return true;
+    }
 
-            auto folder_entries = LoadEntries(fs_path);
-            for(auto &entry: folder_entries) {
-                entry.MoveToParentFolder();
-            }
+    void Entry::OrderSwap(Entry &other_entry) {
+        EntryTransaction txn;
+        txn.Swap(*this, other_entry);
+        txn.Commit();
+    }
 
-            fs::DeleteDirectory(fs_path);
+    void Entry::Save() const {
+        EntryTransaction txn;
+        txn.Save(*this);
+        txn.Commit();
+    }
 
-            // Returns new entries present in the path where the entry (the folder actually) was removed
-            return folder_entries;
-        }
+    std::vector<Entry> Entry::Remove() {
+        EntryTransaction txn;
+        auto folder_entries = txn.Remove(*this);
+        txn.Commit();
+        return folder_entries;
+    }
 
-        return {};
+    void Entry::NotifyLaunched() {
+        this->stats.last_launch_time = time(nullptr);
+        this->Save();
     }
 
     void InitializeEntries() {
@@ -418,6 +1218,8 @@ namespace ul::menu {
 
         EnsureApplicationRecords();
 
+        ReplayEntryJournal();
+
         ConvertOldMenu(entry_idx);
 
         if(!fs::ExistsDirectory(MenuPath)) {
@@ -425,145 +1227,165 @@ namespace ul::menu {
 
             InitializeRemainingEntries(g_ApplicationRecords, entry_idx);
         }
+        else if(LoadIndexedEntries(MenuPath).outdated) {
+            UL_LOG_INFO("Refreshing menu entry stats...");
+            RefreshEntryStats(MenuPath);
+        }
     }
 
     void EnsureApplicationEntry(const NsApplicationRecord &app_record) {
-        // Just fill enough fields needed to save the path
-        const auto entry_idx = FindNextEntryIndex(MenuPath);
+        EntryTransaction txn;
+
+        // Just fill enough fields needed to save the entry
+        const auto entry_idx = txn.FindFreeSlot(MenuPath);
         Entry app_entry = {
             .type = EntryType::Application,
             .entry_path = MakeEntryPath(MenuPath, entry_idx),
+            .index = entry_idx,
 
             .app_info = {
                 .app_id = app_record.application_id,
                 .record = app_record
             }
         };
-        app_entry.Save();
+        os::GetApplicationOccupiedSize(app_record.application_id, app_entry.stats.size);
+        txn.Save(app_entry);
+        txn.Commit();
     }
 
-    std::vector<Entry> LoadEntries(const std::string &path) {
-        std::vector<Entry> entries;
-        UL_FS_FOR(path, entry_name, entry_path, is_dir, is_file, {
-            if(is_file && util::StringEndsWith(entry_name, ".m.json")) {
-                util::JSON entry_json;
-                if(R_SUCCEEDED(util::LoadJSONFromFile(entry_json, entry_path))) {
-                    const auto type = static_cast<EntryType>(entry_json.value("type", static_cast<u32>(EntryType::Invalid)));
-                    const auto entry_index_str = entry_name.substr(0, entry_name.length() - __builtin_strlen(".m.json"));
-                    const u32 entry_index = std::strtoul(entry_index_str.c_str(), nullptr, 10);
-                    const auto custom_name = entry_json.value("custom_name", "");
-                    const auto custom_author = entry_json.value("custom_author", "");
-                    const auto custom_version = entry_json.value("custom_version", "");
-                    const auto custom_icon_path = entry_json.value("custom_icon_path", "");
-
-                    Entry entry = {
-                        .type = type,
-                        .entry_path = entry_path,
-                        .index = entry_index,
-
-                        .control = {
-                            .name = custom_name,
-                            .custom_name = !custom_name.empty(),
-                            .author = custom_author,
-                            .custom_author = !custom_name.empty(),
-                            .version = custom_version,
-                            .custom_version = !custom_name.empty(),
-                            .icon_path = custom_icon_path,
-                            .custom_icon_path = !custom_name.empty(),
-                        }
-                    };
+    bool InitializeEntriesFromSnapshot(const void *snapshot_addr, const size_t snapshot_size) {
+        EnsureApplicationRecords();
 
-                    switch(type) {
-                        case EntryType::Application: {
-                            const auto application_id = entry_json.value("application_id", static_cast<u64>(0));
+        ScopedLock lk(g_EntryTreeLock);
+        g_EntrySnapshotAddress = snapshot_addr;
+        g_EntrySnapshotSize = snapshot_size;
+        if(!RefreshEntryTreeSnapshot()) {
+            g_EntrySnapshotAddress = nullptr;
+            g_EntrySnapshotSize = 0;
+            return false;
+        }
 
-                            if(!entry.control.custom_icon_path) {
-                                // Only set the icon if it's valid
-                                const auto cache_icon_path = GetApplicationCacheIconPath(application_id);
-                                if(fs::ExistsFile(cache_icon_path)) {
-                                    entry.control.icon_path = cache_icon_path;
-                                }
-                            }
+        return true;
+    }
 
-                            entry.app_info = {
-                                .app_id = application_id
-                            };
-                            if(R_FAILED(os::GetApplicationContentMetaStatus(application_id, entry.app_info.meta_status))) {
-                                UL_LOG_WARN("Invalid application entry with no application meta status");
-                            }
+    void LoadEntryTree() {
+        ScopedLock lk(g_EntryTreeLock);
+        g_EntryTree = {};
+        LoadEntryTreeFolder(MenuPath);
+        g_EntryTreeLoaded = true;
+
+        // Whoever loads the tree from the SD card owns the search index: only entries whose strings might have changed get resolved again
+        if(!g_EntrySearchIndexOwned) {
+            g_EntrySearchIndexDirty = !ReadEntrySearchIndex(g_EntrySearchIndex);
+            g_EntrySearchIndexOwned = true;
+            g_EntrySearchIndexLoaded = true;
+        }
+        RefreshEntrySearchIndex();
 
-                            const auto find_rec = std::find_if(g_ApplicationRecords.begin(), g_ApplicationRecords.end(), [&](const NsApplicationRecord &rec) -> bool {
-                                return rec.application_id == application_id;
-                            });
-                            if(find_rec != g_ApplicationRecords.end()) {
-                                entry.app_info.record = *find_rec;
-                            }
-                            else {
-                                UL_LOG_WARN("Invalid application entry with no application record");
-                            }
+        UL_LOG_INFO("Loaded menu entry tree with %zu folders (%zu searchable entries)", g_EntryTree.folders.size(), g_EntrySearchIndex.documents.size() - g_EntrySearchIndex.free_document_ids.size());
+    }
 
-                            entries.push_back(entry);
-                            break;
-                        }
-                        case EntryType::Homebrew: {
-                            const auto nro_path = entry_json.value("nro_path", "");
-                            const auto nro_argv = entry_json.value("nro_argv", "");
-
-                            if(!entry.control.custom_icon_path) {
-                                // Only set the icon if it's valid
-                                const auto cache_icon_path = GetHomebrewCacheIconPath(nro_path);
-                                if(fs::ExistsFile(cache_icon_path)) {
-                                    entry.control.icon_path = cache_icon_path;
-                                }
-                            }
+    void ReloadEntryTreeFolders(const std::vector<std::string> &folder_paths) {
+        ScopedLock lk(g_EntryTreeLock);
+        if(!g_EntryTreeLoaded) {
+            return;
+        }
 
-                            entry.hb_info = {
-                                .nro_target = loader::TargetInput::Create(nro_path, nro_argv, true, "")
-                            };
+        for(const auto &folder_path: folder_paths) {
+            // Subfolders not present yet (moved into this folder) are loaded too, while the ones moved/deleted are dropped below
+            g_EntryTree.folders.erase(folder_path);
+            LoadEntryTreeFolder(folder_path);
+        }
+        g_EntryTree.RemoveOrphanFolders();
+        SyncEntrySearchIndex(folder_paths);
+    }
 
-                            entries.push_back(entry);
-                            break;
-                        }
-                        case EntryType::Folder: {
-                            const auto name = entry_json.value("name", "");
-                            const auto fs_name = entry_json.value("fs_name", "");
+    void RefreshEntrySearchIndex() {
+        ScopedLock lk(g_EntryTreeLock);
+        std::vector<std::string> folder_paths;
+        for(const auto &[folder_path, index]: g_EntryTree.folders) {
+            folder_paths.push_back(folder_path);
+        }
+        SyncEntrySearchIndex(folder_paths);
+    }
 
-                            if(name.empty()) {
-                                UL_LOG_WARN("Invalid folder entry with empty name");
-                            }
-                            else if(fs_name.empty()) {
-                                UL_LOG_WARN("Invalid folder entry with empty filesystem-name");
-                            }
-                            else {
-                                entry.folder_info = {};
-                                util::CopyToStringBuffer(entry.folder_info.name, name);
-                                util::CopyToStringBuffer(entry.folder_info.fs_name, fs_name);
+    std::vector<std::string> ListEntryTreeHomebrewPaths() {
+        ScopedLock lk(g_EntryTreeLock);
+        std::vector<std::string> nro_paths;
+        for(const auto &[folder_path, index]: g_EntryTree.folders) {
+            for(const auto &entry: index.entries) {
+                if(entry.Is<EntryType::Homebrew>()) {
+                    nro_paths.push_back(entry.hb_info.nro_path);
+                }
+            }
+        }
+        return nro_paths;
+    }
 
-                                entries.push_back(entry);
-                            }
-                            break;
-                        }
-                        case EntryType::SpecialEntryMiiEdit:
-                        case EntryType::SpecialEntryWebBrowser:
-                        case EntryType::SpecialEntryUserPage:
-                        case EntryType::SpecialEntrySettings:
-                        case EntryType::SpecialEntryThemes:
-                        case EntryType::SpecialEntryControllers:
-                        case EntryType::SpecialEntryAlbum:
-                            entries.push_back(entry);
-                            break;
-                        default:
-                            break;
-                    }
+    bool WriteEntryTreeSnapshot(void *shmem_addr, const size_t shmem_size) {
+        ScopedLock lk(g_EntryTreeLock);
+        return WriteEntrySnapshot(shmem_addr, shmem_size, g_EntryTree);
+    }
+
+    void SetOnEntriesChanged(OnEntriesChangedCallback callback) {
+        g_OnEntriesChanged = callback;
+    }
+
+    std::vector<EntrySearchResult> SearchEntries(const std::string &query, const u32 max_count) {
+        ScopedLock lk(g_EntryTreeLock);
+        RefreshEntryTreeSnapshot();
+        if(!g_EntrySearchIndexLoaded) {
+            LoadEntrySearchIndex();
+        }
+
+        return g_EntrySearchIndex.Search(query, max_count);
+    }
+
+    std::vector<Entry> LoadEntries(const std::string &path, const bool load_runtime_info) {
+        EntryIndex index = {};
+        bool found_in_tree = false;
+        {
+            ScopedLock lk(g_EntryTreeLock);
+            if(RefreshEntryTreeSnapshot()) {
+                const auto find_folder = g_EntryTree.folders.find(path);
+                if(find_folder != g_EntryTree.folders.end()) {
+                    index = find_folder->second;
+                    found_in_tree = true;
                 }
             }
-        });
+        }
+        if(!found_in_tree) {
+            index = LoadIndexedEntries(path);
+        }
+        if(!load_runtime_info) {
+            return std::move(index.entries);
+        }
+
+        std::vector<Entry> entries;
+        entries.reserve(index.entries.size());
+        for(auto &entry: index.entries) {
+            if(LoadEntryRuntimeInfo(entry)) {
+                entries.push_back(std::move(entry));
+            }
+        }
 
         return entries;
     }
 
+    void ExportEntries(const std::string &path) {
+        const auto index = LoadIndexedEntries(path);
+        for(const auto &entry: index.entries) {
+            util::SaveJSON(entry.entry_path, ConvertEntryToJson(entry));
+
+            if(entry.Is<EntryType::Folder>()) {
+                ExportEntries(entry.GetFolderPath());
+            }
+        }
+    }
+
     Entry CreateFolderEntry(const std::string &base_path, const std::string &folder_name, const u32 index) {
-        const auto folder_path = MakeNextFolderPath(base_path, folder_name);
+        EntryTransaction txn;
+        const auto folder_path = txn.AllocateFolderPath(base_path, folder_name);
         fs::CreateDirectory(folder_path);
 
         Entry folder_entry = {
@@ -578,12 +1400,14 @@ namespace ul::menu {
                 .custom_icon_path = false
             },
 
-            .folder_info = {}
+            .folder_info = {
+                .name = folder_name,
+                .fs_name = fs::GetBaseName(folder_path)
+            }
         };
-        util::CopyToStringBuffer(folder_entry.folder_info.name, folder_name);
-        util::CopyToStringBuffer(folder_entry.folder_info.fs_name, fs::GetBaseName(folder_path));
 
-        folder_entry.Save();
+        txn.Save(folder_entry);
+        txn.Commit();
         return folder_entry;
     }
 
@@ -601,32 +1425,37 @@ namespace ul::menu {
             },
 
             .hb_info = {
-                .nro_target = loader::TargetInput::Create(nro_path, nro_argv, true, "")
+                .nro_path = nro_path,
+                .nro_argv = nro_argv
             }
         };
 
         hb_entry.TryLoadControlData();
+        hb_entry.Save();
+        return hb_entry;
+    }
 
-        // Only set the icon if it's valid
-        const auto cache_icon_path = GetHomebrewCacheIconPath(nro_path);
-        if(fs::ExistsFile(cache_icon_path)) {
-            hb_entry.control.icon_path = cache_icon_path;
+    std::vector<Entry> FindApplicationEntries(const u64 app_id, const std::string &path) {
+        // The whole tree is only walked if the index is missing/invalid or points to entries which aren't there anymore
+        ApplicationEntryIndex app_index;
+        if(!ReadApplicationEntryIndex(app_index)) {
+            RebuildApplicationEntryIndex(app_index);
         }
 
-        hb_entry.Save();
-        return hb_entry;
+        std::vector<Entry> app_entries;
+        if(!CheckApplicationEntryLocations(app_id, app_index.Find(app_id, path), app_entries)) {
+            RebuildApplicationEntryIndex(app_index);
+
+            app_entries.clear();
+            CheckApplicationEntryLocations(app_id, app_index.Find(app_id, path), app_entries);
+        }
+
+        return app_entries;
     }
 
     void DeleteApplicationEntry(const u64 app_id, const std::string &path) {
-        auto cur_entries = LoadEntries(path);
-        for(auto &entry: cur_entries) {
-            if(entry.Is<EntryType::Application>() && (entry.app_info.app_id == app_id)) {
-                entry.Remove();
-            }
-            else if(entry.Is<EntryType::Folder>()) {
-                const auto new_path = fs::JoinPath(path, entry.folder_info.fs_name);
-                DeleteApplicationEntry(app_id, new_path);
-            }
+        for(auto &entry: FindApplicationEntries(app_id, path)) {
+            entry.Remove();
         }
     }
 
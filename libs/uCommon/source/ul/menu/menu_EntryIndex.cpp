@@ -0,0 +1,468 @@
+#include <ul/menu/menu_EntryIndex.hpp>
+#include <ul/util/util_String.hpp>
+#include <ul/ul_Result.hpp>
+#include <algorithm>
+
+namespace ul::menu {
+
+    namespace {
+
+        constexpr u32 EntryIndexStringCount = static_cast<u32>(EntryIndexString::Count);
+
+        void GetEntryIndexStrings(const Entry &entry, std::string (&out_strs)[EntryIndexStringCount]) {
+            #define _UL_INDEX_STR(kind) out_strs[static_cast<u32>(EntryIndexString::kind)]
+
+            if(entry.control.custom_name) {
+                _UL_INDEX_STR(CustomName) = entry.control.name;
+            }
+            if(entry.control.custom_author) {
+                _UL_INDEX_STR(CustomAuthor) = entry.control.author;
+            }
+            if(entry.control.custom_version) {
+                _UL_INDEX_STR(CustomVersion) = entry.control.version;
+            }
+            if(entry.control.custom_icon_path) {
+                _UL_INDEX_STR(CustomIconPath) = entry.control.icon_path;
+            }
+
+            switch(entry.type) {
+                case EntryType::Homebrew: {
+                    _UL_INDEX_STR(NroPath) = entry.hb_info.nro_path;
+                    _UL_INDEX_STR(NroArgv) = entry.hb_info.nro_argv;
+                    break;
+                }
+                case EntryType::Folder: {
+                    _UL_INDEX_STR(FolderName) = entry.folder_info.name;
+                    _UL_INDEX_STR(FolderFsName) = entry.folder_info.fs_name;
+                    break;
+                }
+                default:
+                    break;
+            }
+
+            #undef _UL_INDEX_STR
+        }
+
+        inline void SetSlotUsed(std::vector<u64> &slot_bitmap, const u32 slot, const bool used) {
+            const auto word_idx = slot / EntryIndex::SlotBitmapWordBits;
+            if(word_idx >= slot_bitmap.size()) {
+                if(!used) {
+                    return;
+                }
+                slot_bitmap.resize(word_idx + 1, 0);
+            }
+
+            const auto bit = BIT64(slot % EntryIndex::SlotBitmapWordBits);
+            if(used) {
+                slot_bitmap.at(word_idx) |= bit;
+            }
+            else {
+                slot_bitmap.at(word_idx) &= ~bit;
+            }
+        }
+
+    }
+
+    bool EntryIndex::IsSlotUsed(const u32 slot) const {
+        const auto word_idx = slot / SlotBitmapWordBits;
+        if(word_idx >= this->slot_bitmap.size()) {
+            return false;
+        }
+
+        return this->slot_bitmap.at(word_idx) & BIT64(slot % SlotBitmapWordBits);
+    }
+
+    u32 EntryIndex::FindFreeSlot() {
+        // Slots below the hint are known to be used, thus the search starts at its word
+        for(auto word_idx = this->first_free_slot_hint / SlotBitmapWordBits; word_idx < this->slot_bitmap.size(); word_idx++) {
+            const auto word = this->slot_bitmap.at(word_idx);
+            if(word != UINT64_MAX) {
+                const u32 slot = word_idx * SlotBitmapWordBits + __builtin_ctzll(~word);
+                this->first_free_slot_hint = slot;
+                return slot;
+            }
+        }
+
+        const u32 slot = this->slot_bitmap.size() * SlotBitmapWordBits;
+        this->first_free_slot_hint = slot;
+        return slot;
+    }
+
+    bool EntryIndex::CheckSlotBitmap() const {
+        size_t used_slot_count = 0;
+        for(const auto word: this->slot_bitmap) {
+            used_slot_count += __builtin_popcountll(word);
+        }
+        if(used_slot_count != this->entries.size()) {
+            return false;
+        }
+
+        for(const auto &entry: this->entries) {
+            if(!this->IsSlotUsed(entry.index)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void EntryIndex::RebuildSlotBitmap() {
+        this->slot_bitmap.clear();
+        for(const auto &entry: this->entries) {
+            SetSlotUsed(this->slot_bitmap, entry.index, true);
+        }
+        this->first_free_slot_hint = 0;
+    }
+
+    Entry *EntryIndex::Find(const u32 slot) {
+        if(!this->IsSlotUsed(slot)) {
+            return nullptr;
+        }
+
+        for(auto &entry: this->entries) {
+            if(entry.index == slot) {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+    void EntryIndex::Upsert(const Entry &entry) {
+        auto cur_entry = this->Find(entry.index);
+        if(cur_entry != nullptr) {
+            *cur_entry = entry;
+        }
+        else {
+            this->entries.push_back(entry);
+            SetSlotUsed(this->slot_bitmap, entry.index, true);
+        }
+    }
+
+    void EntryIndex::Remove(const u32 slot) {
+        if(this->IsSlotUsed(slot)) {
+            this->entries.erase(std::remove_if(this->entries.begin(), this->entries.end(), [&](const Entry &entry) -> bool {
+                return entry.index == slot;
+            }), this->entries.end());
+
+            SetSlotUsed(this->slot_bitmap, slot, false);
+            this->first_free_slot_hint = std::min(this->first_free_slot_hint, slot);
+        }
+    }
+
+    std::vector<ApplicationEntryLocation> ApplicationEntryIndex::Find(const u64 app_id, const std::string &base_path) const {
+        std::vector<ApplicationEntryLocation> app_locations;
+        const auto [locations_begin, locations_end] = this->locations.equal_range(app_id);
+        for(auto it = locations_begin; it != locations_end; it++) {
+            if(IsPathWithin(it->second.folder_path, base_path)) {
+                app_locations.push_back(it->second);
+            }
+        }
+        return app_locations;
+    }
+
+    bool ApplicationEntryIndex::UpdateFolder(const std::string &folder_path, const EntryIndex &index) {
+        std::vector<std::pair<u64, u32>> old_app_entries;
+        for(auto it = this->locations.begin(); it != this->locations.end();) {
+            if(it->second.folder_path == folder_path) {
+                old_app_entries.push_back({ it->first, it->second.index });
+                it = this->locations.erase(it);
+            }
+            else {
+                it++;
+            }
+        }
+
+        std::vector<std::pair<u64, u32>> new_app_entries;
+        for(const auto &entry: index.entries) {
+            if(entry.Is<EntryType::Application>()) {
+                new_app_entries.push_back({ entry.app_info.app_id, entry.index });
+                this->locations.insert({ entry.app_info.app_id, { folder_path, entry.index } });
+            }
+        }
+
+        // Report whether anything changed, so that unnecessary writes can be skipped
+        std::sort(old_app_entries.begin(), old_app_entries.end());
+        std::sort(new_app_entries.begin(), new_app_entries.end());
+        return old_app_entries != new_app_entries;
+    }
+
+    void ApplicationEntryIndex::RenameFolder(const std::string &old_folder_path, const std::string &new_folder_path) {
+        for(auto &[app_id, location]: this->locations) {
+            if(IsPathWithin(location.folder_path, old_folder_path)) {
+                location.folder_path = new_folder_path + location.folder_path.substr(old_folder_path.length());
+            }
+        }
+    }
+
+    void ApplicationEntryIndex::RemoveFolder(const std::string &folder_path) {
+        std::erase_if(this->locations, [&](const auto &app_location) -> bool {
+            return IsPathWithin(app_location.second.folder_path, folder_path);
+        });
+    }
+
+    bool ParseEntryIndexRecord(const std::string &folder_path, const u8 *data, const size_t data_size, const size_t record_size, size_t &offset, Entry &out_entry) {
+        if((record_size > sizeof(EntryIndexRecord)) || ((offset + record_size) > data_size)) {
+            return false;
+        }
+
+        // Fields missing in older records are left zeroed
+        EntryIndexRecord record = {};
+        memcpy(&record, data + offset, record_size);
+        offset += record_size;
+
+        std::string strs[EntryIndexStringCount];
+        for(u32 i = 0; i < EntryIndexStringCount; i++) {
+            const auto str_len = record.string_lengths[i];
+            if((offset + str_len) > data_size) {
+                return false;
+            }
+
+            strs[i].assign(reinterpret_cast<const char*>(data + offset), str_len);
+            offset += str_len;
+        }
+
+        #define _UL_INDEX_STR(kind) strs[static_cast<u32>(EntryIndexString::kind)]
+
+        out_entry = {
+            .type = record.type,
+            .entry_path = MakeEntryPath(folder_path, record.index),
+            .index = record.index,
+
+            .control = {
+                .name = _UL_INDEX_STR(CustomName),
+                .custom_name = !_UL_INDEX_STR(CustomName).empty(),
+                .author = _UL_INDEX_STR(CustomAuthor),
+                .custom_author = !_UL_INDEX_STR(CustomAuthor).empty(),
+                .version = _UL_INDEX_STR(CustomVersion),
+                .custom_version = !_UL_INDEX_STR(CustomVersion).empty(),
+                .icon_path = _UL_INDEX_STR(CustomIconPath),
+                .custom_icon_path = !_UL_INDEX_STR(CustomIconPath).empty()
+            },
+
+            .stats = {
+                .size = record.size,
+                .last_launch_time = record.last_launch_time,
+                .child_count = record.child_count
+            }
+        };
+
+        switch(record.type) {
+            case EntryType::Application: {
+                out_entry.app_info = {
+                    .app_id = record.app_id
+                };
+                break;
+            }
+            case EntryType::Homebrew: {
+                out_entry.hb_info = {
+                    .nro_path = std::move(_UL_INDEX_STR(NroPath)),
+                    .nro_argv = std::move(_UL_INDEX_STR(NroArgv))
+                };
+                break;
+            }
+            case EntryType::Folder: {
+                out_entry.folder_info = {
+                    .name = std::move(_UL_INDEX_STR(FolderName)),
+                    .fs_name = std::move(_UL_INDEX_STR(FolderFsName))
+                };
+                break;
+            }
+            default:
+                break;
+        }
+
+        #undef _UL_INDEX_STR
+
+        return true;
+    }
+
+    void SerializeEntryIndexRecord(const Entry &entry, std::vector<u8> &out_data) {
+        std::string strs[EntryIndexStringCount];
+        GetEntryIndexStrings(entry, strs);
+
+        EntryIndexRecord record = {
+            .type = entry.type,
+            .index = entry.index,
+            .app_id = entry.Is<EntryType::Application>() ? entry.app_info.app_id : 0,
+            .size = entry.stats.size,
+            .last_launch_time = entry.stats.last_launch_time,
+            .child_count = entry.stats.child_count
+        };
+        for(u32 i = 0; i < EntryIndexStringCount; i++) {
+            record.string_lengths[i] = static_cast<u16>(std::min<size_t>(strs[i].length(), UINT16_MAX));
+        }
+
+        const auto record_ptr = reinterpret_cast<const u8*>(&record);
+        out_data.insert(out_data.end(), record_ptr, record_ptr + sizeof(record));
+        for(u32 i = 0; i < EntryIndexStringCount; i++) {
+            out_data.insert(out_data.end(), strs[i].begin(), strs[i].begin() + record.string_lengths[i]);
+        }
+    }
+
+    bool ParseEntryIndex(const std::string &folder_path, const u8 *data, const size_t data_size, EntryIndex &out_index) {
+        EntryIndexHeader header = {};
+        if(data_size < sizeof(header.magic) + sizeof(header.version)) {
+            return false;
+        }
+
+        memcpy(&header, data, std::min(data_size, sizeof(header)));
+        if(!header.IsValid() || (data_size < header.GetSize()) || (header.data_size != (data_size - header.GetSize()))) {
+            return false;
+        }
+
+        // Counts are checked before allocating anything, since indexes have no checksum
+        const auto record_size = EntryIndexRecord::GetSize(header.version);
+        if((header.entry_count > (header.data_size / record_size)) || (header.entry_count > EntryIndex::MaxSlotCount)) {
+            return false;
+        }
+
+        out_index = {};
+        out_index.entries.reserve(header.entry_count);
+
+        size_t offset = header.GetSize();
+        if(header.version >= 2) {
+            if(header.slot_bitmap_word_count > EntryIndex::MaxSlotBitmapWordCount) {
+                return false;
+            }
+            const auto slot_bitmap_size = header.slot_bitmap_word_count * sizeof(u64);
+            if((offset + slot_bitmap_size) > data_size) {
+                return false;
+            }
+
+            out_index.slot_bitmap.resize(header.slot_bitmap_word_count);
+            memcpy(out_index.slot_bitmap.data(), data + offset, slot_bitmap_size);
+            offset += slot_bitmap_size;
+            out_index.next_folder_name_idx = header.next_folder_name_idx;
+        }
+
+        for(u32 i = 0; i < header.entry_count; i++) {
+            Entry entry;
+            if(!ParseEntryIndexRecord(folder_path, data, data_size, record_size, offset, entry) || (entry.index >= EntryIndex::MaxSlotCount)) {
+                return false;
+            }
+            out_index.entries.push_back(std::move(entry));
+        }
+
+        if(offset != data_size) {
+            return false;
+        }
+
+        out_index.outdated = header.version < EntryIndexHeader::CurrentVersion;
+
+        // Older indexes lack the bitmap, and it might also be stale after an interrupted write
+        if(!out_index.CheckSlotBitmap()) {
+            if(header.version >= 2) {
+                UL_LOG_WARN("Stale menu entry slot bitmap at '%s', rebuilding it...", folder_path.c_str());
+            }
+            out_index.RebuildSlotBitmap();
+        }
+        return true;
+    }
+
+    void SerializeEntryIndex(const EntryIndex &index, std::vector<u8> &out_data) {
+        const auto slot_bitmap_size = index.slot_bitmap.size() * sizeof(u64);
+        out_data.resize(sizeof(EntryIndexHeader) + slot_bitmap_size);
+        memcpy(out_data.data() + sizeof(EntryIndexHeader), index.slot_bitmap.data(), slot_bitmap_size);
+
+        for(const auto &entry: index.entries) {
+            SerializeEntryIndexRecord(entry, out_data);
+        }
+
+        const EntryIndexHeader header = {
+            .magic = EntryIndexHeader::Magic,
+            .version = EntryIndexHeader::CurrentVersion,
+            .entry_count = static_cast<u32>(index.entries.size()),
+            .data_size = static_cast<u32>(out_data.size() - sizeof(EntryIndexHeader)),
+            .slot_bitmap_word_count = static_cast<u32>(index.slot_bitmap.size()),
+            .next_folder_name_idx = index.next_folder_name_idx
+        };
+        memcpy(out_data.data(), &header, sizeof(header));
+    }
+
+    bool ReadEntryIndex(const std::string &folder_path, EntryIndex &out_index) {
+        std::vector<u8> index_data;
+        if(!fs::ReadFileContents(MakeEntryIndexPath(folder_path), index_data)) {
+            return false;
+        }
+
+        if(!ParseEntryIndex(folder_path, index_data.data(), index_data.size(), out_index)) {
+            UL_LOG_WARN("Invalid menu entry index at '%s'", folder_path.c_str());
+            out_index = {};
+            return false;
+        }
+
+        return true;
+    }
+
+    bool WriteEntryIndex(const std::string &folder_path, const EntryIndex &index) {
+        std::vector<u8> index_data;
+        SerializeEntryIndex(index, index_data);
+        return fs::WriteFile(MakeEntryIndexPath(folder_path), index_data.data(), index_data.size(), true);
+    }
+
+    bool ReadApplicationEntryIndex(ApplicationEntryIndex &out_app_index) {
+        out_app_index = {};
+
+        std::vector<u8> app_index_data;
+        if(!fs::ReadFileContents(MakeApplicationEntryIndexPath(), app_index_data)) {
+            return false;
+        }
+
+        ApplicationEntryIndexHeader header;
+        if(app_index_data.size() < sizeof(header)) {
+            return false;
+        }
+        memcpy(&header, app_index_data.data(), sizeof(header));
+        if(!header.IsValid() || (header.data_size != (app_index_data.size() - sizeof(header)))) {
+            return false;
+        }
+
+        out_app_index.locations.reserve(header.location_count);
+        size_t offset = sizeof(header);
+        for(u32 i = 0; i < header.location_count; i++) {
+            ApplicationEntryIndexRecord record;
+            if((offset + sizeof(record)) > app_index_data.size()) {
+                out_app_index = {};
+                return false;
+            }
+            memcpy(&record, app_index_data.data() + offset, sizeof(record));
+            offset += sizeof(record);
+
+            if((offset + record.folder_path_length) > app_index_data.size()) {
+                out_app_index = {};
+                return false;
+            }
+            const std::string folder_path(reinterpret_cast<const char*>(app_index_data.data() + offset), record.folder_path_length);
+            offset += record.folder_path_length;
+
+            out_app_index.locations.insert({ record.app_id, { folder_path, record.index } });
+        }
+
+        return true;
+    }
+
+    bool WriteApplicationEntryIndex(const ApplicationEntryIndex &app_index) {
+        std::vector<u8> app_index_data(sizeof(ApplicationEntryIndexHeader));
+        for(const auto &[app_id, location]: app_index.locations) {
+            const ApplicationEntryIndexRecord record = {
+                .app_id = app_id,
+                .index = location.index,
+                .folder_path_length = static_cast<u32>(location.folder_path.length())
+            };
+
+            const auto record_ptr = reinterpret_cast<const u8*>(&record);
+            app_index_data.insert(app_index_data.end(), record_ptr, record_ptr + sizeof(record));
+            app_index_data.insert(app_index_data.end(), location.folder_path.begin(), location.folder_path.end());
+        }
+
+        const ApplicationEntryIndexHeader header = {
+            .magic = ApplicationEntryIndexHeader::Magic,
+            .version = ApplicationEntryIndexHeader::CurrentVersion,
+            .location_count = static_cast<u32>(app_index.locations.size()),
+            .data_size = static_cast<u32>(app_index_data.size() - sizeof(ApplicationEntryIndexHeader))
+        };
+        memcpy(app_index_data.data(), &header, sizeof(header));
+
+        return fs::WriteFile(MakeApplicationEntryIndexPath(), app_index_data.data(), app_index_data.size(), true);
+    }
+
+}
@@ -0,0 +1,136 @@
+#include <ul/menu/menu_EntryJournal.hpp>
+#include <ul/ul_Result.hpp>
+
+namespace ul::menu {
+
+    void SerializeEntryJournalBatch(const std::vector<EntryJournalOperation> &ops, std::vector<u8> &out_data) {
+        out_data.resize(sizeof(EntryJournalBatchHeader));
+        for(const auto &op: ops) {
+            const auto header_offset = out_data.size();
+            out_data.resize(header_offset + sizeof(EntryJournalOperationHeader));
+            out_data.insert(out_data.end(), op.path.begin(), op.path.end());
+            out_data.insert(out_data.end(), op.new_path.begin(), op.new_path.end());
+
+            const auto record_offset = out_data.size();
+            if(op.type == EntryJournalOperationType::PutEntry) {
+                SerializeEntryIndexRecord(op.entry, out_data);
+            }
+
+            const EntryJournalOperationHeader op_header = {
+                .type = op.type,
+                .value = op.value,
+                .path_length = static_cast<u16>(op.path.length()),
+                .new_path_length = static_cast<u16>(op.new_path.length()),
+                .entry_record_size = static_cast<u32>(out_data.size() - record_offset)
+            };
+            memcpy(out_data.data() + header_offset, &op_header, sizeof(op_header));
+        }
+
+        const auto data_size = out_data.size() - sizeof(EntryJournalBatchHeader);
+        const EntryJournalBatchHeader header = {
+            .magic = EntryJournalBatchHeader::Magic,
+            .op_count = static_cast<u32>(ops.size()),
+            .data_size = static_cast<u32>(data_size),
+            .data_crc32 = crc32Calculate(out_data.data() + sizeof(EntryJournalBatchHeader), data_size)
+        };
+        memcpy(out_data.data(), &header, sizeof(header));
+    }
+
+    bool ParseEntryJournalBatch(const u8 *data, const size_t data_size, size_t &offset, std::vector<EntryJournalOperation> &out_ops) {
+        EntryJournalBatchHeader header;
+        if((offset + sizeof(header)) > data_size) {
+            return false;
+        }
+        memcpy(&header, data + offset, sizeof(header));
+        if((header.magic != EntryJournalBatchHeader::Magic) || ((offset + sizeof(header) + header.data_size) > data_size)) {
+            return false;
+        }
+
+        const auto batch_data = data + offset + sizeof(header);
+        if(crc32Calculate(batch_data, header.data_size) != header.data_crc32) {
+            return false;
+        }
+
+        out_ops.clear();
+        out_ops.reserve(header.op_count);
+        size_t batch_offset = 0;
+        for(u32 i = 0; i < header.op_count; i++) {
+            EntryJournalOperationHeader op_header;
+            if((batch_offset + sizeof(op_header)) > header.data_size) {
+                return false;
+            }
+            memcpy(&op_header, batch_data + batch_offset, sizeof(op_header));
+            batch_offset += sizeof(op_header);
+
+            if((batch_offset + op_header.path_length + op_header.new_path_length + op_header.entry_record_size) > header.data_size) {
+                return false;
+            }
+
+            EntryJournalOperation op = {
+                .type = op_header.type,
+                .path = std::string(reinterpret_cast<const char*>(batch_data + batch_offset), op_header.path_length),
+                .new_path = std::string(reinterpret_cast<const char*>(batch_data + batch_offset + op_header.path_length), op_header.new_path_length),
+                .value = op_header.value
+            };
+            batch_offset += op_header.path_length + op_header.new_path_length;
+
+            if(op.type == EntryJournalOperationType::PutEntry) {
+                const auto record_end_offset = batch_offset + op_header.entry_record_size;
+                if(!ParseEntryIndexRecord(op.path, batch_data, record_end_offset, sizeof(EntryIndexRecord), batch_offset, op.entry) || (batch_offset != record_end_offset)) {
+                    return false;
+                }
+            }
+            else {
+                batch_offset += op_header.entry_record_size;
+            }
+
+            out_ops.push_back(std::move(op));
+        }
+
+        if(batch_offset != header.data_size) {
+            return false;
+        }
+
+        offset += sizeof(header) + header.data_size;
+        return true;
+    }
+
+    bool AppendEntryJournalBatch(const std::vector<EntryJournalOperation> &ops) {
+        // Every batch is fully applied once appended, thus a big journal can be dropped before appending the next batch
+        const auto journal_path = MakeEntryJournalPath();
+        if(fs::GetFileSize(journal_path) >= EntryJournalCompactSize) {
+            ClearEntryJournal();
+        }
+
+        std::vector<u8> batch_data;
+        SerializeEntryJournalBatch(ops, batch_data);
+        return fs::WriteFile(journal_path, batch_data.data(), batch_data.size(), false);
+    }
+
+    bool ReadEntryJournal(std::vector<std::vector<EntryJournalOperation>> &out_batches) {
+        out_batches.clear();
+
+        std::vector<u8> journal_data;
+        if(!fs::ReadFileContents(MakeEntryJournalPath(), journal_data)) {
+            return false;
+        }
+
+        size_t offset = 0;
+        while(offset < journal_data.size()) {
+            std::vector<EntryJournalOperation> ops;
+            if(!ParseEntryJournalBatch(journal_data.data(), journal_data.size(), offset, ops)) {
+                UL_LOG_WARN("Discarding incomplete menu entry journal batch at offset 0x%zX", offset);
+                break;
+            }
+
+            out_batches.push_back(std::move(ops));
+        }
+
+        return true;
+    }
+
+    void ClearEntryJournal() {
+        fs::DeleteFile(MakeEntryJournalPath());
+    }
+
+}
@@ -0,0 +1,410 @@
+#include <ul/menu/menu_EntrySearch.hpp>
+#include <ul/util/util_String.hpp>
+
+namespace ul::menu {
+
+    namespace {
+
+        std::string MakeLowerString(const std::string &str) {
+            // Non-ASCII (UTF-8) bytes are left as they are, they still match byte-wise
+            auto lower_str = str;
+            for(auto &c: lower_str) {
+                if((c >= 'A') && (c <= 'Z')) {
+                    c += 'a' - 'A';
+                }
+            }
+            return lower_str;
+        }
+
+        inline u32 MakeTrigram(const std::string &str, const size_t offset) {
+            return (static_cast<u8>(str.at(offset)) << 16) | (static_cast<u8>(str.at(offset + 1)) << 8) | static_cast<u8>(str.at(offset + 2));
+        }
+
+        void CollectTrigrams(const std::string &str, std::vector<u32> &out_trigrams) {
+            for(size_t i = 0; (i + 3) <= str.length(); i++) {
+                out_trigrams.push_back(MakeTrigram(str, i));
+            }
+        }
+
+        inline bool IsWordStart(const std::string &str, const size_t offset) {
+            return (offset == 0) || !std::isalnum(static_cast<u8>(str.at(offset - 1)));
+        }
+
+        std::vector<u32> GetDocumentTrigrams(const std::string &lower_name, const std::string &lower_author) {
+            std::vector<u32> trigrams;
+            CollectTrigrams(lower_name, trigrams);
+            CollectTrigrams(lower_author, trigrams);
+            std::sort(trigrams.begin(), trigrams.end());
+            trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+            return trigrams;
+        }
+
+    }
+
+    std::string EntrySearchIndex::MakeSource(const Entry &entry, const u32 stamp) {
+        std::string source;
+        switch(entry.type) {
+            case EntryType::Application: {
+                source = util::FormatProgramId(entry.app_info.app_id);
+                break;
+            }
+            case EntryType::Homebrew: {
+                source = entry.hb_info.nro_path;
+                break;
+            }
+            case EntryType::Folder: {
+                source = entry.folder_info.name;
+                break;
+            }
+            default:
+                break;
+        }
+
+        source += '\n';
+        if(entry.control.custom_name) {
+            source += entry.control.name;
+        }
+        source += '\n';
+        if(entry.control.custom_author) {
+            source += entry.control.author;
+        }
+        source += '\n';
+        source += std::to_string(stamp);
+        return source;
+    }
+
+    bool EntrySearchIndex::UpdateFolder(const std::string &folder_path, const EntryIndex &index, EntrySearchStringResolver resolver, EntrySearchSourceStamper stamper) {
+        auto changed = false;
+
+        // Slot -> document ID, whatever remains here afterwards is no longer in the folder
+        std::unordered_map<u32, u32> old_doc_ids;
+        const auto find_folder = this->folder_document_ids.find(folder_path);
+        if(find_folder != this->folder_document_ids.end()) {
+            for(const auto doc_id: find_folder->second) {
+                old_doc_ids[this->documents.at(doc_id).index] = doc_id;
+            }
+        }
+
+        std::vector<u32> new_doc_ids;
+        for(const auto &entry: index.entries) {
+            if(!entry.Is<EntryType::Application>() && !entry.Is<EntryType::Homebrew>() && !entry.Is<EntryType::Folder>()) {
+                continue;
+            }
+
+            auto source = MakeSource(entry, stamper(entry));
+            const auto find_doc = old_doc_ids.find(entry.index);
+            if(find_doc != old_doc_ids.end()) {
+                const auto &doc = this->documents.at(find_doc->second);
+                if((doc.type == entry.type) && (doc.source == source)) {
+                    new_doc_ids.push_back(find_doc->second);
+                    old_doc_ids.erase(find_doc);
+                    continue;
+                }
+            }
+
+            EntrySearchDocument doc = {
+                .type = entry.type,
+                .index = entry.index,
+                .folder_path = folder_path,
+                .source = std::move(source)
+            };
+            if(resolver(entry, doc.name, doc.author)) {
+                new_doc_ids.push_back(this->AddDocument(std::move(doc)));
+                changed = true;
+            }
+        }
+
+        for(const auto &[slot, doc_id]: old_doc_ids) {
+            this->RemoveDocument(doc_id);
+            changed = true;
+        }
+
+        if(new_doc_ids.empty()) {
+            this->folder_document_ids.erase(folder_path);
+        }
+        else {
+            this->folder_document_ids[folder_path] = std::move(new_doc_ids);
+        }
+        return changed;
+    }
+
+    void EntrySearchIndex::RenameFolder(const std::string &old_folder_path, const std::string &new_folder_path) {
+        std::vector<std::string> old_paths;
+        for(const auto &[folder_path, doc_ids]: this->folder_document_ids) {
+            if(IsPathWithin(folder_path, old_folder_path)) {
+                old_paths.push_back(folder_path);
+            }
+        }
+
+        for(const auto &old_path: old_paths) {
+            auto folder_node = this->folder_document_ids.extract(old_path);
+            folder_node.key() = new_folder_path + old_path.substr(old_folder_path.length());
+            for(const auto doc_id: folder_node.mapped()) {
+                this->documents.at(doc_id).folder_path = folder_node.key();
+            }
+            this->folder_document_ids.insert(std::move(folder_node));
+        }
+    }
+
+    void EntrySearchIndex::RemoveFolder(const std::string &folder_path) {
+        for(auto it = this->folder_document_ids.begin(); it != this->folder_document_ids.end();) {
+            if(IsPathWithin(it->first, folder_path)) {
+                for(const auto doc_id: it->second) {
+                    this->RemoveDocument(doc_id);
+                }
+                it = this->folder_document_ids.erase(it);
+            }
+            else {
+                it++;
+            }
+        }
+    }
+
+    u32 EntrySearchIndex::AddDocument(EntrySearchDocument &&doc) {
+        u32 doc_id;
+        if(!this->free_document_ids.empty()) {
+            doc_id = this->free_document_ids.back();
+            this->free_document_ids.pop_back();
+            this->documents.at(doc_id) = std::move(doc);
+        }
+        else {
+            doc_id = this->documents.size();
+            this->documents.push_back(std::move(doc));
+        }
+
+        if(this->trigrams_built) {
+            const auto &new_doc = this->documents.at(doc_id);
+            this->lower_names.resize(this->documents.size());
+            this->lower_authors.resize(this->documents.size());
+            this->lower_names.at(doc_id) = MakeLowerString(new_doc.name);
+            this->lower_authors.at(doc_id) = MakeLowerString(new_doc.author);
+
+            for(const auto trigram: GetDocumentTrigrams(this->lower_names.at(doc_id), this->lower_authors.at(doc_id))) {
+                auto &trigram_doc_ids = this->trigram_document_ids[trigram];
+                trigram_doc_ids.insert(std::lower_bound(trigram_doc_ids.begin(), trigram_doc_ids.end(), doc_id), doc_id);
+            }
+        }
+
+        return doc_id;
+    }
+
+    void EntrySearchIndex::RemoveDocument(const u32 doc_id) {
+        if(this->trigrams_built) {
+            for(const auto trigram: GetDocumentTrigrams(this->lower_names.at(doc_id), this->lower_authors.at(doc_id))) {
+                auto find_trigram = this->trigram_document_ids.find(trigram);
+                if(find_trigram != this->trigram_document_ids.end()) {
+                    auto &trigram_doc_ids = find_trigram->second;
+                    const auto find_doc_id = std::lower_bound(trigram_doc_ids.begin(), trigram_doc_ids.end(), doc_id);
+                    if((find_doc_id != trigram_doc_ids.end()) && (*find_doc_id == doc_id)) {
+                        trigram_doc_ids.erase(find_doc_id);
+                    }
+                    if(trigram_doc_ids.empty()) {
+                        this->trigram_document_ids.erase(find_trigram);
+                    }
+                }
+            }
+
+            this->lower_names.at(doc_id).clear();
+            this->lower_authors.at(doc_id).clear();
+        }
+
+        this->documents.at(doc_id) = {};
+        this->free_document_ids.push_back(doc_id);
+    }
+
+    void EntrySearchIndex::BuildTrigrams() {
+        this->trigram_document_ids.clear();
+        this->lower_names.resize(this->documents.size());
+        this->lower_authors.resize(this->documents.size());
+
+        for(u32 doc_id = 0; doc_id < this->documents.size(); doc_id++) {
+            const auto &doc = this->documents.at(doc_id);
+            if(!doc.IsValid()) {
+                continue;
+            }
+
+            this->lower_names.at(doc_id) = MakeLowerString(doc.name);
+            this->lower_authors.at(doc_id) = MakeLowerString(doc.author);
+            // Document IDs are visited in order, thus the lists stay sorted
+            for(const auto trigram: GetDocumentTrigrams(this->lower_names.at(doc_id), this->lower_authors.at(doc_id))) {
+                this->trigram_document_ids[trigram].push_back(doc_id);
+            }
+        }
+
+        this->trigrams_built = true;
+    }
+
+    std::vector<EntrySearchResult> EntrySearchIndex::Search(const std::string &query, const u32 max_count) {
+        const auto lower_query = MakeLowerString(query);
+        if(lower_query.empty()) {
+            return {};
+        }
+
+        if(!this->trigrams_built) {
+            this->BuildTrigrams();
+        }
+
+        // Candidates are taken from the query's rarest trigram, queries too short to have any just check every document
+        const std::vector<u32> *candidate_doc_ids = nullptr;
+        std::vector<u32> all_doc_ids;
+        if(lower_query.length() >= 3) {
+            for(size_t i = 0; (i + 3) <= lower_query.length(); i++) {
+                const auto find_trigram = this->trigram_document_ids.find(MakeTrigram(lower_query, i));
+                if(find_trigram == this->trigram_document_ids.end()) {
+                    return {};
+                }
+
+                if((candidate_doc_ids == nullptr) || (find_trigram->second.size() < candidate_doc_ids->size())) {
+                    candidate_doc_ids = &find_trigram->second;
+                }
+            }
+        }
+        else {
+            all_doc_ids.reserve(this->documents.size());
+            for(u32 doc_id = 0; doc_id < this->documents.size(); doc_id++) {
+                all_doc_ids.push_back(doc_id);
+            }
+            candidate_doc_ids = &all_doc_ids;
+        }
+
+        // Rank: name prefix, name word prefix, anywhere in the name, anywhere in the author
+        std::vector<std::pair<u32, u32>> matches;
+        for(const auto doc_id: *candidate_doc_ids) {
+            if(!this->documents.at(doc_id).IsValid()) {
+                continue;
+            }
+
+            const auto &lower_name = this->lower_names.at(doc_id);
+            const auto name_pos = lower_name.find(lower_query);
+            if(name_pos == 0) {
+                matches.push_back({ 0, doc_id });
+            }
+            else if(name_pos != std::string::npos) {
+                auto rank = 2;
+                for(auto pos = name_pos; pos != std::string::npos; pos = lower_name.find(lower_query, pos + 1)) {
+                    if(IsWordStart(lower_name, pos)) {
+                        rank = 1;
+                        break;
+                    }
+                }
+                matches.push_back({ rank, doc_id });
+            }
+            else if(this->lower_authors.at(doc_id).find(lower_query) != std::string::npos) {
+                matches.push_back({ 3, doc_id });
+            }
+        }
+
+        const auto result_count = std::min<size_t>(matches.size(), max_count);
+        std::partial_sort(matches.begin(), matches.begin() + result_count, matches.end(), [&](const std::pair<u32, u32> &match_a, const std::pair<u32, u32> &match_b) -> bool {
+            if(match_a.first != match_b.first) {
+                return match_a.first < match_b.first;
+            }
+            return this->lower_names.at(match_a.second) < this->lower_names.at(match_b.second);
+        });
+
+        std::vector<EntrySearchResult> results;
+        results.reserve(result_count);
+        for(size_t i = 0; i < result_count; i++) {
+            const auto &doc = this->documents.at(matches.at(i).second);
+            results.push_back({
+                .folder_path = doc.folder_path,
+                .index = doc.index,
+                .type = doc.type,
+                .name = doc.name
+            });
+        }
+        return results;
+    }
+
+    bool ReadEntrySearchIndex(EntrySearchIndex &out_search_index) {
+        out_search_index = {};
+
+        std::vector<u8> search_index_data;
+        if(!fs::ReadFileContents(MakeEntrySearchIndexPath(), search_index_data)) {
+            return false;
+        }
+
+        EntrySearchIndexHeader header;
+        if(search_index_data.size() < sizeof(header)) {
+            return false;
+        }
+        memcpy(&header, search_index_data.data(), sizeof(header));
+        if(!header.IsValid() || (header.data_size != (search_index_data.size() - sizeof(header)))) {
+            return false;
+        }
+
+        out_search_index.documents.reserve(header.document_count);
+        size_t offset = sizeof(header);
+        for(u32 i = 0; i < header.document_count; i++) {
+            EntrySearchIndexRecord record;
+            if((offset + sizeof(record)) > search_index_data.size()) {
+                out_search_index = {};
+                return false;
+            }
+            memcpy(&record, search_index_data.data() + offset, sizeof(record));
+            offset += sizeof(record);
+
+            const size_t strs_size = record.folder_path_length + record.source_length + record.name_length + record.author_length;
+            if((offset + strs_size) > search_index_data.size()) {
+                out_search_index = {};
+                return false;
+            }
+
+            const auto read_str = [&](const u16 str_len) -> std::string {
+                const std::string str(reinterpret_cast<const char*>(search_index_data.data() + offset), str_len);
+                offset += str_len;
+                return str;
+            };
+
+            EntrySearchDocument doc = {
+                .type = record.type,
+                .index = record.index
+            };
+            doc.folder_path = read_str(record.folder_path_length);
+            doc.source = read_str(record.source_length);
+            doc.name = read_str(record.name_length);
+            doc.author = read_str(record.author_length);
+
+            const auto folder_path = doc.folder_path;
+            out_search_index.folder_document_ids[folder_path].push_back(out_search_index.AddDocument(std::move(doc)));
+        }
+
+        return true;
+    }
+
+    bool WriteEntrySearchIndex(const EntrySearchIndex &search_index) {
+        std::vector<u8> search_index_data(sizeof(EntrySearchIndexHeader));
+        u32 doc_count = 0;
+        for(const auto &doc: search_index.documents) {
+            if(!doc.IsValid()) {
+                continue;
+            }
+
+            const EntrySearchIndexRecord record = {
+                .type = doc.type,
+                .index = doc.index,
+                .folder_path_length = static_cast<u16>(doc.folder_path.length()),
+                .source_length = static_cast<u16>(std::min<size_t>(doc.source.length(), UINT16_MAX)),
+                .name_length = static_cast<u16>(std::min<size_t>(doc.name.length(), UINT16_MAX)),
+                .author_length = static_cast<u16>(std::min<size_t>(doc.author.length(), UINT16_MAX))
+            };
+            const auto record_ptr = reinterpret_cast<const u8*>(&record);
+            search_index_data.insert(search_index_data.end(), record_ptr, record_ptr + sizeof(record));
+            search_index_data.insert(search_index_data.end(), doc.folder_path.begin(), doc.folder_path.begin() + record.folder_path_length);
+            search_index_data.insert(search_index_data.end(), doc.source.begin(), doc.source.begin() + record.source_length);
+            search_index_data.insert(search_index_data.end(), doc.name.begin(), doc.name.begin() + record.name_length);
+            search_index_data.insert(search_index_data.end(), doc.author.begin(), doc.author.begin() + record.author_length);
+            doc_count++;
+        }
+
+        const EntrySearchIndexHeader header = {
+            .magic = EntrySearchIndexHeader::Magic,
+            .version = EntrySearchIndexHeader::CurrentVersion,
+            .document_count = doc_count,
+            .data_size = static_cast<u32>(search_index_data.size() - sizeof(EntrySearchIndexHeader))
+        };
+        memcpy(search_index_data.data(), &header, sizeof(header));
+        return fs::WriteFile(MakeEntrySearchIndexPath(), search_index_data.data(), search_index_data.size(), true);
+    }
+
+}
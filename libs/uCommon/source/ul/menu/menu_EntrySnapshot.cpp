@@ -0,0 +1,149 @@
+#include <ul/menu/menu_EntrySnapshot.hpp>
+#include <unordered_set>
+
+namespace ul::menu {
+
+    void EntryTree::RenameFolder(const std::string &old_folder_path, const std::string &new_folder_path) {
+        std::vector<std::string> old_paths;
+        for(const auto &[folder_path, index]: this->folders) {
+            if(IsPathWithin(folder_path, old_folder_path)) {
+                old_paths.push_back(folder_path);
+            }
+        }
+
+        for(const auto &old_path: old_paths) {
+            auto folder_node = this->folders.extract(old_path);
+            folder_node.key() = new_folder_path + old_path.substr(old_folder_path.length());
+            for(auto &entry: folder_node.mapped().entries) {
+                entry.entry_path = MakeEntryPath(folder_node.key(), entry.index);
+            }
+            this->folders.insert(std::move(folder_node));
+        }
+    }
+
+    void EntryTree::RemoveFolder(const std::string &folder_path) {
+        std::erase_if(this->folders, [&](const auto &folder) -> bool {
+            return IsPathWithin(folder.first, folder_path);
+        });
+    }
+
+    void EntryTree::RemoveOrphanFolders() {
+        // Folders no longer referenced by any folder entry (moved/deleted elsewhere), removing one might leave its own subfolders orphaned
+        while(true) {
+            std::unordered_set<std::string> referenced_paths = { MenuPath };
+            for(const auto &[folder_path, index]: this->folders) {
+                for(const auto &entry: index.entries) {
+                    if(entry.Is<EntryType::Folder>()) {
+                        referenced_paths.insert(entry.GetFolderPath());
+                    }
+                }
+            }
+
+            const auto removed_count = std::erase_if(this->folders, [&](const auto &folder) -> bool {
+                return !referenced_paths.contains(folder.first);
+            });
+            if(removed_count == 0) {
+                break;
+            }
+        }
+    }
+
+    void SerializeEntrySnapshot(const EntryTree &tree, std::vector<u8> &out_data) {
+        std::vector<u8> index_data;
+        for(const auto &[folder_path, index]: tree.folders) {
+            SerializeEntryIndex(index, index_data);
+
+            const EntrySnapshotFolderRecord record = {
+                .folder_path_length = static_cast<u32>(folder_path.length()),
+                .index_data_size = static_cast<u32>(index_data.size())
+            };
+            const auto record_ptr = reinterpret_cast<const u8*>(&record);
+            out_data.insert(out_data.end(), record_ptr, record_ptr + sizeof(record));
+            out_data.insert(out_data.end(), folder_path.begin(), folder_path.end());
+            out_data.insert(out_data.end(), index_data.begin(), index_data.end());
+        }
+    }
+
+    bool ParseEntrySnapshot(const u8 *data, const size_t data_size, EntryTree &out_tree) {
+        out_tree = {};
+
+        size_t offset = 0;
+        while(offset < data_size) {
+            EntrySnapshotFolderRecord record;
+            if((offset + sizeof(record)) > data_size) {
+                out_tree = {};
+                return false;
+            }
+            memcpy(&record, data + offset, sizeof(record));
+            offset += sizeof(record);
+
+            if((offset + record.folder_path_length + record.index_data_size) > data_size) {
+                out_tree = {};
+                return false;
+            }
+            const std::string folder_path(reinterpret_cast<const char*>(data + offset), record.folder_path_length);
+            offset += record.folder_path_length;
+
+            EntryIndex index = {};
+            if(!ParseEntryIndex(folder_path, data + offset, record.index_data_size, index)) {
+                out_tree = {};
+                return false;
+            }
+            offset += record.index_data_size;
+
+            out_tree.folders.emplace(folder_path, std::move(index));
+        }
+
+        return true;
+    }
+
+    bool WriteEntrySnapshot(void *shmem_addr, const size_t shmem_size, const EntryTree &tree) {
+        std::vector<u8> snapshot_data;
+        SerializeEntrySnapshot(tree, snapshot_data);
+        const auto fits = (sizeof(EntrySnapshotHeader) + snapshot_data.size()) <= shmem_size;
+
+        auto header = reinterpret_cast<EntrySnapshotHeader*>(shmem_addr);
+        const auto generation = __atomic_load_n(&header->generation, __ATOMIC_RELAXED);
+        __atomic_store_n(&header->generation, generation + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        // A snapshot too big to be shared is published as invalid, thus uMenu just falls back to reading the menu from the SD card
+        header->magic = fits ? EntrySnapshotHeader::Magic : 0;
+        header->version = EntrySnapshotHeader::CurrentVersion;
+        header->folder_count = fits ? tree.folders.size() : 0;
+        header->data_size = fits ? snapshot_data.size() : 0;
+        if(fits) {
+            memcpy(reinterpret_cast<u8*>(shmem_addr) + sizeof(EntrySnapshotHeader), snapshot_data.data(), snapshot_data.size());
+        }
+
+        __atomic_store_n(&header->generation, generation + 2, __ATOMIC_RELEASE);
+        return fits;
+    }
+
+    bool ReadEntrySnapshot(const void *shmem_addr, const size_t shmem_size, u32 &out_generation, std::vector<u8> &out_data) {
+        const auto header = reinterpret_cast<const EntrySnapshotHeader*>(shmem_addr);
+        while(true) {
+            const auto generation = __atomic_load_n(&header->generation, __ATOMIC_ACQUIRE);
+            if((generation % 2) != 0) {
+                // Being written right now
+                svcSleepThread(100'000ul);
+                continue;
+            }
+
+            EntrySnapshotHeader header_copy;
+            memcpy(&header_copy, header, sizeof(header_copy));
+            const auto is_valid = header_copy.IsValid() && ((sizeof(EntrySnapshotHeader) + header_copy.data_size) <= shmem_size);
+            if(is_valid) {
+                const auto snapshot_data = reinterpret_cast<const u8*>(shmem_addr) + sizeof(EntrySnapshotHeader);
+                out_data.assign(snapshot_data, snapshot_data + header_copy.data_size);
+            }
+
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if(__atomic_load_n(&header->generation, __ATOMIC_RELAXED) == generation) {
+                out_generation = generation;
+                return is_valid;
+            }
+        }
+    }
+
+}
@@ -0,0 +1,460 @@
+#include <ul/menu/menu_IconPack.hpp>
+#include <ul/ul_Result.hpp>
+#include <algorithm>
+#include <unistd.h>
+
+namespace ul::menu {
+
+    namespace {
+
+        inline s64 GetOpenFileSize(FILE *f) {
+            if(fseek(f, 0, SEEK_END) != 0) {
+                return -1;
+            }
+            return ftell(f);
+        }
+
+        inline bool ReadAt(FILE *f, const u64 offset, void *data, const size_t size) {
+            if(fseek(f, offset, SEEK_SET) != 0) {
+                return false;
+            }
+            return (size == 0) || (fread(data, size, 1, f) == 1);
+        }
+
+        inline bool WriteAt(FILE *f, const u64 offset, const void *data, const size_t size) {
+            if(fseek(f, offset, SEEK_SET) != 0) {
+                return false;
+            }
+            return (size == 0) || (fwrite(data, size, 1, f) == 1);
+        }
+
+    }
+
+    IconPack::IconPack(const std::string &base_path, const std::string &name) : base_path(base_path), name(name), file(nullptr), writable(false), generation(0), pack_size(0), dead_size(0), index(), index_dirty(false), lock() {}
+
+    bool IconPack::LoadIndex() {
+        this->index.clear();
+        this->pack_size = sizeof(IconPackHeader);
+        this->dead_size = 0;
+        this->index_dirty = true;
+
+        std::vector<u8> index_data;
+        if(fs::ReadFileContents(this->GetIndexPath(), index_data) && (index_data.size() >= sizeof(IconPackIndexHeader))) {
+            IconPackIndexHeader header;
+            memcpy(&header, index_data.data(), sizeof(header));
+
+            // Indexes of other packs (or pointing past the end of this one) are never trusted, the whole pack is scanned instead
+            const auto file_size = GetOpenFileSize(this->file);
+            const auto valid = header.IsValid() && (header.generation == this->generation) && (header.pack_size >= sizeof(IconPackHeader)) && (static_cast<s64>(header.pack_size) <= file_size) && (index_data.size() == (sizeof(header) + header.entry_count * sizeof(IconPackIndexEntry)));
+            if(valid) {
+                this->index.reserve(header.entry_count);
+                for(u32 i = 0; i < header.entry_count; i++) {
+                    IconPackIndexEntry entry;
+                    memcpy(&entry, index_data.data() + sizeof(header) + i * sizeof(entry), sizeof(entry));
+                    this->index[entry.key] = entry;
+                }
+                this->pack_size = header.pack_size;
+                this->dead_size = header.dead_size;
+                this->index_dirty = false;
+            }
+            else {
+                UL_LOG_WARN("Icon pack index at '%s' is not valid, scanning the whole pack...", this->GetPackPath().c_str());
+            }
+        }
+
+        return this->ScanRecords(this->pack_size);
+    }
+
+    bool IconPack::ScanRecords(const u64 offset) {
+        const auto file_size = GetOpenFileSize(this->file);
+        if(file_size < 0) {
+            return false;
+        }
+
+        auto cur_offset = offset;
+        std::vector<u8> data;
+        while((cur_offset + sizeof(IconPackRecordHeader)) <= static_cast<u64>(file_size)) {
+            IconPackRecordHeader record_header;
+            if(!ReadAt(this->file, cur_offset, &record_header, sizeof(record_header))) {
+                break;
+            }
+            const auto data_offset = cur_offset + sizeof(record_header);
+            if((record_header.magic != IconPackRecordHeader::Magic) || ((data_offset + record_header.size) > static_cast<u64>(file_size))) {
+                break;
+            }
+
+            data.resize(record_header.size);
+            if(!ReadAt(this->file, data_offset, data.data(), data.size()) || (crc32Calculate(data.data(), data.size()) != record_header.data_crc32)) {
+                break;
+            }
+
+            this->ApplyRecord(record_header, cur_offset);
+            cur_offset = data_offset + record_header.size;
+        }
+        this->pack_size = cur_offset;
+
+        // Anything left is an interrupted append (or one still in progress by another process, when not writing ourselves)
+        if(this->writable && (cur_offset < static_cast<u64>(file_size))) {
+            UL_LOG_WARN("Dropping 0x%lX bytes of incomplete records from icon pack at '%s'", static_cast<u64>(file_size) - cur_offset, this->GetPackPath().c_str());
+            fflush(this->file);
+            if(ftruncate(fileno(this->file), cur_offset) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void IconPack::ApplyRecord(const IconPackRecordHeader &record_header, const u64 record_offset) {
+        this->index_dirty = true;
+        auto find_entry = this->index.find(record_header.key);
+        if(find_entry != this->index.end()) {
+            this->dead_size += sizeof(IconPackRecordHeader) + find_entry->second.size;
+        }
+
+        if(record_header.flags & IconPackRecordHeader::FlagRemoved) {
+            this->dead_size += sizeof(IconPackRecordHeader);
+            if(find_entry != this->index.end()) {
+                this->index.erase(find_entry);
+            }
+        }
+        else {
+            this->index[record_header.key] = {
+                .key = record_header.key,
+                .data_offset = record_offset + sizeof(IconPackRecordHeader),
+                .size = record_header.size,
+                .data_crc32 = record_header.data_crc32
+            };
+        }
+    }
+
+    bool IconPack::AppendRecord(const IconPackRecordHeader &record_header, const void *data) {
+        const auto record_offset = this->pack_size;
+        // Header and data go out in a single flush, and a partially written record is undone right away
+        if(!WriteAt(this->file, record_offset, &record_header, sizeof(record_header)) || !WriteAt(this->file, record_offset + sizeof(record_header), data, record_header.size) || (fflush(this->file) != 0)) {
+            fflush(this->file);
+            ftruncate(fileno(this->file), record_offset);
+            return false;
+        }
+
+        this->ApplyRecord(record_header, record_offset);
+        this->pack_size = record_offset + sizeof(record_header) + record_header.size;
+        return true;
+    }
+
+    bool IconPack::CreatePack(const u64 generation) {
+        if(this->file != nullptr) {
+            fclose(this->file);
+        }
+        fs::DeleteFile(this->GetIndexPath());
+
+        this->file = fopen(this->GetPackPath().c_str(), "w+b");
+        if(this->file == nullptr) {
+            return false;
+        }
+
+        const IconPackHeader header = {
+            .magic = IconPackHeader::Magic,
+            .version = IconPackHeader::CurrentVersion,
+            .generation = generation
+        };
+        if(!WriteAt(this->file, 0, &header, sizeof(header)) || (fflush(this->file) != 0)) {
+            fclose(this->file);
+            this->file = nullptr;
+            return false;
+        }
+
+        this->generation = generation;
+        this->index.clear();
+        this->pack_size = sizeof(header);
+        this->dead_size = 0;
+        this->index_dirty = true;
+        return true;
+    }
+
+    bool IconPack::Open(const bool writable) {
+        ScopedLock lk(this->lock);
+        this->Close();
+        this->writable = writable;
+
+        const auto pack_path = this->GetPackPath();
+        if(writable) {
+            // A compaction might have been interrupted right after removing the old pack
+            const auto tmp_pack_path = this->GetTemporaryPackPath();
+            if(!fs::ExistsFile(pack_path) && fs::ExistsFile(tmp_pack_path)) {
+                fs::RenameFile(tmp_pack_path, pack_path);
+            }
+            else {
+                fs::DeleteFile(tmp_pack_path);
+            }
+        }
+
+        this->file = fopen(pack_path.c_str(), writable ? "r+b" : "rb");
+        if(this->file == nullptr) {
+            return writable && this->CreatePack(randomGet64());
+        }
+
+        IconPackHeader header;
+        if(!ReadAt(this->file, 0, &header, sizeof(header)) || !header.IsValid()) {
+            UL_LOG_WARN("Icon pack at '%s' is not valid", this->GetPackPath().c_str());
+            if(writable) {
+                return this->CreatePack(randomGet64());
+            }
+            this->Close();
+            return false;
+        }
+
+        this->generation = header.generation;
+        if(!this->LoadIndex()) {
+            this->Close();
+            return false;
+        }
+        return true;
+    }
+
+    void IconPack::Close() {
+        ScopedLock lk(this->lock);
+        if(this->file != nullptr) {
+            fclose(this->file);
+            this->file = nullptr;
+        }
+        this->generation = 0;
+        this->pack_size = 0;
+        this->dead_size = 0;
+        this->index.clear();
+    }
+
+    bool IconPack::Refresh() {
+        ScopedLock lk(this->lock);
+        if(this->file == nullptr) {
+            return this->Open(this->writable);
+        }
+
+        // Reopen if the pack was replaced (compacted/recreated), otherwise just scan what was appended
+        IconPackHeader header;
+        const auto file_size = GetOpenFileSize(this->file);
+        if(!ReadAt(this->file, 0, &header, sizeof(header)) || !header.IsValid() || (header.generation != this->generation) || (file_size < static_cast<s64>(this->pack_size))) {
+            return this->Open(this->writable);
+        }
+        if(file_size > static_cast<s64>(this->pack_size)) {
+            return this->ScanRecords(this->pack_size);
+        }
+        return true;
+    }
+
+    bool IconPack::Find(const u64 key, IconPackIndexEntry &out_entry) {
+        ScopedLock lk(this->lock);
+        if(this->file == nullptr) {
+            if(!this->Open(false)) {
+                return false;
+            }
+        }
+
+        const auto find_entry = this->index.find(key);
+        if(find_entry == this->index.end()) {
+            return false;
+        }
+
+        out_entry = find_entry->second;
+        return true;
+    }
+
+    std::vector<u64> IconPack::ListKeys() {
+        ScopedLock lk(this->lock);
+        std::vector<u64> keys;
+        if((this->file != nullptr) || this->Open(false)) {
+            keys.reserve(this->index.size());
+            for(const auto &[key, entry]: this->index) {
+                keys.push_back(key);
+            }
+        }
+        return keys;
+    }
+
+    bool IconPack::Read(const u64 key, std::vector<u8> &out_data) {
+        ScopedLock lk(this->lock);
+        // Read-only packs are opened on first use, and kept open from then on
+        if(this->file == nullptr) {
+            if(!this->Open(false)) {
+                return false;
+            }
+        }
+
+        const auto find_entry = this->index.find(key);
+        if(find_entry == this->index.end()) {
+            return false;
+        }
+
+        out_data.resize(find_entry->second.size);
+        return ReadAt(this->file, find_entry->second.data_offset, out_data.data(), out_data.size());
+    }
+
+    bool IconPack::Put(const u64 key, const void *data, const size_t size) {
+        ScopedLock lk(this->lock);
+        if((this->file == nullptr) || !this->writable) {
+            return false;
+        }
+
+        const auto data_crc32 = crc32Calculate(data, size);
+        // Re-caching the very same icon (pretty common with homebrew updates) doesn't grow the pack
+        const auto find_entry = this->index.find(key);
+        if((find_entry != this->index.end()) && (find_entry->second.size == size) && (find_entry->second.data_crc32 == data_crc32)) {
+            return true;
+        }
+
+        const IconPackRecordHeader record_header = {
+            .magic = IconPackRecordHeader::Magic,
+            .size = static_cast<u32>(size),
+            .key = key,
+            .data_crc32 = data_crc32,
+            .flags = 0
+        };
+        return this->AppendRecord(record_header, data);
+    }
+
+    bool IconPack::Remove(const u64 key) {
+        ScopedLock lk(this->lock);
+        if((this->file == nullptr) || !this->writable) {
+            return false;
+        }
+        if(!this->index.contains(key)) {
+            return true;
+        }
+
+        const IconPackRecordHeader record_header = {
+            .magic = IconPackRecordHeader::Magic,
+            .size = 0,
+            .key = key,
+            .data_crc32 = crc32Calculate(nullptr, 0),
+            .flags = IconPackRecordHeader::FlagRemoved
+        };
+        return this->AppendRecord(record_header, nullptr);
+    }
+
+    bool IconPack::Compact() {
+        ScopedLock lk(this->lock);
+        if((this->file == nullptr) || !this->writable) {
+            return false;
+        }
+
+        // Live records are copied (in pack order) to a new pack, which then replaces the current one
+        std::vector<IconPackIndexEntry> entries;
+        entries.reserve(this->index.size());
+        for(const auto &[key, entry]: this->index) {
+            entries.push_back(entry);
+        }
+        std::sort(entries.begin(), entries.end(), [](const IconPackIndexEntry &entry_a, const IconPackIndexEntry &entry_b) {
+            return entry_a.data_offset < entry_b.data_offset;
+        });
+
+        const auto tmp_pack_path = this->GetTemporaryPackPath();
+        auto tmp_file = fopen(tmp_pack_path.c_str(), "wb");
+        if(tmp_file == nullptr) {
+            return false;
+        }
+
+        const IconPackHeader header = {
+            .magic = IconPackHeader::Magic,
+            .version = IconPackHeader::CurrentVersion,
+            .generation = this->generation + 1
+        };
+        auto ok = fwrite(&header, sizeof(header), 1, tmp_file) == 1;
+
+        std::unordered_map<u64, IconPackIndexEntry> new_index;
+        new_index.reserve(entries.size());
+        u64 new_pack_size = sizeof(header);
+        std::vector<u8> data;
+        for(const auto &entry: entries) {
+            if(!ok) {
+                break;
+            }
+
+            data.resize(entry.size);
+            const IconPackRecordHeader record_header = {
+                .magic = IconPackRecordHeader::Magic,
+                .size = entry.size,
+                .key = entry.key,
+                .data_crc32 = entry.data_crc32,
+                .flags = 0
+            };
+            ok = ReadAt(this->file, entry.data_offset, data.data(), data.size()) && (fwrite(&record_header, sizeof(record_header), 1, tmp_file) == 1) && ((data.size() == 0) || (fwrite(data.data(), data.size(), 1, tmp_file) == 1));
+
+            new_index[entry.key] = {
+                .key = entry.key,
+                .data_offset = new_pack_size + sizeof(record_header),
+                .size = entry.size,
+                .data_crc32 = entry.data_crc32
+            };
+            new_pack_size += sizeof(record_header) + entry.size;
+        }
+        fclose(tmp_file);
+
+        if(!ok) {
+            fs::DeleteFile(tmp_pack_path);
+            return false;
+        }
+
+        fclose(this->file);
+        this->file = nullptr;
+        const auto pack_path = this->GetPackPath();
+        fs::DeleteFile(pack_path);
+        if(!fs::RenameFile(tmp_pack_path, pack_path)) {
+            return false;
+        }
+
+        this->file = fopen(pack_path.c_str(), "r+b");
+        if(this->file == nullptr) {
+            return false;
+        }
+
+        UL_LOG_INFO("Compacted icon pack at '%s': 0x%lX -> 0x%lX bytes", this->GetPackPath().c_str(), this->pack_size, new_pack_size);
+        this->generation = header.generation;
+        this->index = std::move(new_index);
+        this->pack_size = new_pack_size;
+        this->dead_size = 0;
+        this->index_dirty = true;
+        return this->SaveIndex();
+    }
+
+    bool IconPack::SaveIndex() {
+        ScopedLock lk(this->lock);
+        if((this->file == nullptr) || !this->writable) {
+            return false;
+        }
+        if(!this->index_dirty) {
+            return true;
+        }
+        fflush(this->file);
+
+        std::vector<u8> index_data(sizeof(IconPackIndexHeader) + this->index.size() * sizeof(IconPackIndexEntry));
+        const IconPackIndexHeader header = {
+            .magic = IconPackIndexHeader::Magic,
+            .version = IconPackIndexHeader::CurrentVersion,
+            .generation = this->generation,
+            .pack_size = this->pack_size,
+            .dead_size = this->dead_size,
+            .entry_count = static_cast<u32>(this->index.size()),
+            .reserved = 0
+        };
+        memcpy(index_data.data(), &header, sizeof(header));
+        auto entry_offset = sizeof(header);
+        for(const auto &[key, entry]: this->index) {
+            memcpy(index_data.data() + entry_offset, &entry, sizeof(entry));
+            entry_offset += sizeof(entry);
+        }
+
+        // The index is only a shortcut, a missing one just means a full scan
+        const auto index_path = this->GetIndexPath();
+        const auto tmp_index_path = index_path + ".tmp";
+        if(!fs::WriteFile(tmp_index_path, index_data.data(), index_data.size(), true)) {
+            return false;
+        }
+        fs::DeleteFile(index_path);
+        if(!fs::RenameFile(tmp_index_path, index_path)) {
+            return false;
+        }
+
+        this->index_dirty = false;
+        return true;
+    }
+
+}
@@ -35,10 +35,44 @@ namespace ul::os {
         return records;
     }
 
+    bool FindApplicationRecord(const u64 app_id, NsApplicationRecord &out_record) {
+        // Same paging as above, but stopping as soon as the record is found
+        s32 cur_offset = 0;
+        while(true) {
+            s32 record_count = 0;
+            if(R_FAILED(nsListApplicationRecord(g_ApplicationRecordBuffer, ApplicationRecordBufferCount, cur_offset, &record_count))) {
+                return false;
+            }
+            if(record_count == 0) {
+                return false;
+            }
+
+            cur_offset += record_count;
+            for(s32 i = 0; i < record_count; i++) {
+                const auto &record = g_ApplicationRecordBuffer[i];
+                if(record.application_id == app_id) {
+                    out_record = record;
+                    return true;
+                }
+            }
+        }
+    }
+
     Result GetApplicationContentMetaStatus(const u64 app_id, NsApplicationContentMetaStatus &out_status) {
         s32 tmp_count;
         UL_RC_TRY(nsListApplicationContentMetaStatus(app_id, 0, std::addressof(out_status), 1, &tmp_count));
         return ResultSuccess;
     }
 
+    Result GetApplicationOccupiedSize(const u64 app_id, u64 &out_size) {
+        NsApplicationOccupiedSize occupied_size;
+        UL_RC_TRY(nsCalculateApplicationOccupiedSize(app_id, &occupied_size));
+
+        out_size = 0;
+        for(const auto &entity: occupied_size.layout) {
+            out_size += entity.app_size + entity.patch_size + entity.add_on_content_size;
+        }
+        return ResultSuccess;
+    }
+
 }
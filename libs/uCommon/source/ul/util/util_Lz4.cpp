@@ -0,0 +1,189 @@
+#include <ul/util/util_Lz4.hpp>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+namespace ul::util {
+
+    namespace {
+
+        constexpr size_t MinMatchLength = 4;
+        // Format constraints: the last 5 bytes are always literals, and the last match starts at least 12 bytes before the end
+        constexpr size_t LastLiteralCount = 5;
+        constexpr size_t MatchFindLimit = 12;
+        constexpr size_t MaxMatchOffset = 0xFFFF;
+
+        constexpr u32 HashBits = 12;
+
+        inline u32 Read32(const u8 *ptr) {
+            u32 val;
+            memcpy(&val, ptr, sizeof(val));
+            return val;
+        }
+
+        inline u32 Hash(const u32 val) {
+            return (val * 2654435761u) >> (32 - HashBits);
+        }
+
+        inline bool WriteLength(u8 *dst, const size_t dst_capacity, size_t &dst_offset, size_t length) {
+            while(length >= 0xFF) {
+                if(dst_offset >= dst_capacity) {
+                    return false;
+                }
+                dst[dst_offset++] = 0xFF;
+                length -= 0xFF;
+            }
+            if(dst_offset >= dst_capacity) {
+                return false;
+            }
+            dst[dst_offset++] = static_cast<u8>(length);
+            return true;
+        }
+
+        inline bool ReadLength(const u8 *src, const size_t src_size, size_t &src_offset, size_t &length) {
+            u8 val;
+            do {
+                if(src_offset >= src_size) {
+                    return false;
+                }
+                val = src[src_offset++];
+                length += val;
+            } while(val == 0xFF);
+            return true;
+        }
+
+        bool WriteSequence(const u8 *literals, const size_t literal_count, const size_t match_length, const size_t match_offset, u8 *dst, const size_t dst_capacity, size_t &dst_offset) {
+            if(dst_offset >= dst_capacity) {
+                return false;
+            }
+            const auto token_offset = dst_offset++;
+            u8 token = static_cast<u8>(std::min<size_t>(literal_count, 0xF) << 4);
+            if((literal_count >= 0xF) && !WriteLength(dst, dst_capacity, dst_offset, literal_count - 0xF)) {
+                return false;
+            }
+
+            if((dst_offset + literal_count) > dst_capacity) {
+                return false;
+            }
+            memcpy(dst + dst_offset, literals, literal_count);
+            dst_offset += literal_count;
+
+            // Last sequence: literals only
+            if(match_length > 0) {
+                if((dst_offset + 2) > dst_capacity) {
+                    return false;
+                }
+                dst[dst_offset++] = static_cast<u8>(match_offset & 0xFF);
+                dst[dst_offset++] = static_cast<u8>(match_offset >> 8);
+
+                const auto extra_match_length = match_length - MinMatchLength;
+                token |= static_cast<u8>(std::min<size_t>(extra_match_length, 0xF));
+                if((extra_match_length >= 0xF) && !WriteLength(dst, dst_capacity, dst_offset, extra_match_length - 0xF)) {
+                    return false;
+                }
+            }
+
+            dst[token_offset] = token;
+            return true;
+        }
+
+    }
+
+    size_t CompressLz4(const u8 *src, const size_t src_size, u8 *dst, const size_t dst_capacity) {
+        std::vector<u32> hash_table(1 << HashBits, 0);
+        size_t src_offset = 0;
+        size_t anchor = 0;
+        size_t dst_offset = 0;
+
+        if(src_size > MatchFindLimit) {
+            const auto match_start_limit = src_size - MatchFindLimit;
+            const auto match_end_limit = src_size - LastLiteralCount;
+            // The first position is skipped, since hash table entries are zero-initialized
+            src_offset = 1;
+            while(src_offset < match_start_limit) {
+                const auto cur_val = Read32(src + src_offset);
+                auto &hash_entry = hash_table[Hash(cur_val)];
+                const size_t ref_offset = hash_entry;
+                hash_entry = static_cast<u32>(src_offset);
+
+                if((ref_offset >= src_offset) || ((src_offset - ref_offset) > MaxMatchOffset) || (Read32(src + ref_offset) != cur_val)) {
+                    src_offset++;
+                    continue;
+                }
+
+                auto match_length = MinMatchLength;
+                while(((src_offset + match_length) < match_end_limit) && (src[ref_offset + match_length] == src[src_offset + match_length])) {
+                    match_length++;
+                }
+
+                if(!WriteSequence(src + anchor, src_offset - anchor, match_length, src_offset - ref_offset, dst, dst_capacity, dst_offset)) {
+                    return 0;
+                }
+                src_offset += match_length;
+                anchor = src_offset;
+            }
+        }
+
+        if(!WriteSequence(src + anchor, src_size - anchor, 0, 0, dst, dst_capacity, dst_offset)) {
+            return 0;
+        }
+        return dst_offset;
+    }
+
+    bool DecompressLz4(const u8 *src, const size_t src_size, u8 *dst, const size_t dst_size) {
+        size_t src_offset = 0;
+        size_t dst_offset = 0;
+        while(src_offset < src_size) {
+            const auto token = src[src_offset++];
+
+            size_t literal_count = token >> 4;
+            if((literal_count == 0xF) && !ReadLength(src, src_size, src_offset, literal_count)) {
+                return false;
+            }
+            if(((src_offset + literal_count) > src_size) || ((dst_offset + literal_count) > dst_size)) {
+                return false;
+            }
+            memcpy(dst + dst_offset, src + src_offset, literal_count);
+            src_offset += literal_count;
+            dst_offset += literal_count;
+
+            // The last sequence has no match
+            if(src_offset == src_size) {
+                break;
+            }
+
+            if((src_offset + 2) > src_size) {
+                return false;
+            }
+            const size_t match_offset = src[src_offset] | (src[src_offset + 1] << 8);
+            src_offset += 2;
+            if((match_offset == 0) || (match_offset > dst_offset)) {
+                return false;
+            }
+
+            size_t match_length = token & 0xF;
+            if((match_length == 0xF) && !ReadLength(src, src_size, src_offset, match_length)) {
+                return false;
+            }
+            match_length += MinMatchLength;
+            if((dst_offset + match_length) > dst_size) {
+                return false;
+            }
+
+            const auto match_src = dst + dst_offset - match_offset;
+            if(match_offset >= match_length) {
+                memcpy(dst + dst_offset, match_src, match_length);
+            }
+            else {
+                // Overlapping matches repeat the last match_offset bytes
+                for(size_t i = 0; i < match_length; i++) {
+                    dst[dst_offset + i] = match_src[i];
+                }
+            }
+            dst_offset += match_length;
+        }
+
+        return dst_offset == dst_size;
+    }
+
+}
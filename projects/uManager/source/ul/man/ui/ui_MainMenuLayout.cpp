@@ -137,7 +137,9 @@ namespace ul::man::ui {
         if(option == 0) {
             // Regenerate cache
             const auto cur_app_recs = os::ListApplicationRecords();
+            menu::ResetApplicationCache();
             menu::CacheApplications(cur_app_recs);
+            menu::ResetHomebrewCache();
             menu::CacheHomebrew();
 
             UL_RC_ASSERT(accountInitialize(AccountServiceType_System));
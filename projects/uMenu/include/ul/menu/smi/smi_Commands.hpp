@@ -223,4 +223,30 @@ namespace ul::menu::smi {
         );
     }
 
+    inline Result ReloadMenuEntries(const std::vector<std::string> &folder_paths) {
+        return SendCommand(SystemMessage::ReloadMenuEntries,
+            [&](ScopedStorageWriter &writer) {
+                // If the paths don't fit, no paths are sent and System just reloads the whole menu
+                size_t paths_size = sizeof(u32);
+                for(const auto &folder_path: folder_paths) {
+                    paths_size += sizeof(u32) + folder_path.length();
+                }
+                if((sizeof(CommandCommonHeader) + paths_size) > CommandStorageSize) {
+                    return writer.Push<u32>(0);
+                }
+
+                UL_RC_TRY(writer.Push(static_cast<u32>(folder_paths.size())));
+                for(const auto &folder_path: folder_paths) {
+                    UL_RC_TRY(writer.Push(static_cast<u32>(folder_path.length())));
+                    UL_RC_TRY(writer.PushData(folder_path.c_str(), folder_path.length()));
+                }
+                return ResultSuccess;
+            },
+            [](ScopedStorageReader &reader) {
+                // ...
+                return ResultSuccess;
+            }
+        );
+    }
+
 }
@@ -1,6 +1,7 @@
 
 #pragma once
 #include <ul/smi/smi_Protocol.hpp>
+#include <ul/cfg/cfg_Config.hpp>
 #include <functional>
 
 namespace ul::menu::smi {
@@ -13,4 +14,12 @@ namespace ul::menu::smi {
     void FinalizeMenuMessageHandler();
     void RegisterOnMessageDetect(OnMessageCallback callback, const MenuMessage desired_msg = MenuMessage::Invalid);
 
+    // Loads menu entries from System's in-memory menu snapshot, instead of reading them from the SD card
+    Result InitializeMenuEntries();
+
+    // System owns the config: we keep a copy, send it our changes, and only fetch it again if System's generation changed
+    Result LoadConfig(cfg::Config &out_cfg);
+    Result RefreshConfig(cfg::Config &cfg);
+    Result SetConfigEntry(const cfg::ConfigEntryDelta &delta);
+
 }
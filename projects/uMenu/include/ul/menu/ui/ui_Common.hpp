@@ -1,6 +1,7 @@
 
 #pragma once
 #include <ul/cfg/cfg_Config.hpp>
+#include <ul/menu/smi/smi_MenuMessageHandler.hpp>
 #include <pu/Plutonium>
 
 namespace ul::menu::ui {
@@ -24,7 +25,12 @@ namespace ul::menu::ui {
     void LoadSelectedUserIconTexture();
     pu::sdl2::TextureHandle::Ref GetSelectedUserIconTexture();
 
-    void SaveConfig();
+    // Changes are applied to our copy and sent to uSystem, which saves them
+    template<cfg::ConfigEntryId Id>
+    inline void SetConfigEntry(cfg::Config &cfg, const cfg::ConfigEntryValueType<Id> &t) {
+        UL_ASSERT_TRUE(cfg.SetEntry<Id>(t));
+        UL_RC_ASSERT(smi::SetConfigEntry(cfg::MakeConfigEntryDelta<Id>(t)));
+    }
 
     void RebootSystem();
     void ShutdownSystem();
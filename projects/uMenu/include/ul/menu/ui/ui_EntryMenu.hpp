@@ -4,6 +4,7 @@
 #include <ul/ul_Result.hpp>
 #include <ul/util/util_Enum.hpp>
 #include <pu/Plutonium>
+#include <atomic>
 
 namespace ul::menu::ui {
 
@@ -30,6 +31,9 @@ namespace ul::menu::ui {
             static constexpr u32 EntriesSwipePageIncrementSteps = 20;
             static constexpr u32 EntriesSwipeSingleIncrementSteps = 6;
             static constexpr u32 EntriesSwipeRewindIncrementSteps = 36;
+            static constexpr u32 EntryPrefetchPageCount = 1;
+            // Icons are also decoded/scaled there (see EnsureCacheScaledIcon)
+            static constexpr size_t EntryLoaderThreadStackSize = 0x20000;
 
             using FocusedEntryInputPressedCallback = std::function<void(const u64)>;
             using FocusedEntryChangedCallback = std::function<void(const bool, const bool, const bool)>;
@@ -88,6 +92,18 @@ namespace ul::menu::ui {
             u32 entries_base_swipe_neg_offset;
             pu::ui::SigmoidIncrementer<u32> entries_base_swipe_neg_offset_incr;
             u32 extra_entry_swipe_show_h_count;
+            Thread entry_loader_thread;
+            bool entry_loader_thread_started;
+            std::atomic_bool entry_loader_should_stop;
+            std::vector<Entry> entry_loader_pending_entries;
+            u32 entry_loader_icon_size;
+            Mutex entry_loader_lock;
+            std::vector<std::pair<Entry, bool>> entry_loader_loaded_entries;
+
+            static void EntryLoaderThread(void *menu_ptr);
+            void StartEntryLoader(std::vector<Entry> &&pending_entries);
+            void StopEntryLoader();
+            void ApplyLoadedEntries();
 
             inline bool IsNotInSwipe() {
                 return this->swipe_mode == SwipeMode::None;
@@ -142,6 +158,7 @@ namespace ul::menu::ui {
         public:
             EntryMenu(const s32 x, const s32 y, const std::string &path, FocusedEntryInputPressedCallback cur_entry_input_cb, FocusedEntryChangedCallback cur_entry_changed_cb, FocusedEntryChangeStartedCallback cur_entry_change_started_cb);
             PU_SMART_CTOR(EntryMenu)
+            ~EntryMenu();
 
             void Initialize(const u32 last_idx);
 
@@ -193,6 +210,7 @@ namespace ul::menu::ui {
             void OnInput(const u64 keys_down, const u64 keys_up, const u64 keys_held, const pu::ui::TouchPoint touch_pos) override;
 
             void MoveTo(const std::string &new_path = "", const bool force_pop_idx = false);
+            void MoveToEntry(const std::string &folder_path, const std::vector<u32> &folder_entry_idxs, const u32 entry_idx);
 
             void OrganizeUpdateEntries(const s32 prev_entry_suspended_override = -1);
             void NotifyEntryAdded(const Entry &entry);
@@ -31,9 +31,12 @@ namespace ul::menu::ui {
                 if(key & MetaDpadNpadButton) {
                     str += "\uE0EA ";
                 }
-                if(key & MetaAnyStickNpadButton) {
+                if((key & MetaAnyStickNpadButton) == MetaAnyStickNpadButton) {
                     str += "\uE100 ";
                 }
+                else if(key & HidNpadButton_StickR) {
+                    str += "\uE105 ";
+                }
 
                 if(key & HidNpadButton_A) {
                     str += "\uE0E0 ";
@@ -8,6 +8,7 @@
 #include <ul/menu/ui/ui_EntryMenu.hpp>
 #include <ul/menu/ui/ui_Common.hpp>
 #include <ul/menu/menu_Entries.hpp>
+#include <ul/menu/menu_EntrySearch.hpp>
 #include <ul/cfg/cfg_Config.hpp>
 
 namespace ul::menu::ui {
@@ -19,6 +20,7 @@ namespace ul::menu::ui {
             static constexpr s64 MessagesWaitTimeSeconds = 2;
             static constexpr s64 TimeDotsDisplayChangeWaitTimeSeconds = 1;
             static constexpr u32 LogoSize = 90;
+            static constexpr u32 MaxSearchResultCount = 4;
 
         private:
             enum class SuspendedImageMode {
@@ -58,6 +60,7 @@ namespace ul::menu::ui {
             QuickMenu::Ref quick_menu;
             InputBar::Ref input_bar;
             std::chrono::steady_clock::time_point startup_tp;
+            std::chrono::steady_clock::time_point last_cache_stats_log_tp;
             bool start_time_elapsed;
             u8 min_alpha;
             SuspendedImageMode mode;
@@ -92,7 +95,10 @@ namespace ul::menu::ui {
             pu::audio::Sfx entry_remove_sfx;
             pu::audio::Sfx error_sfx;
 
+            void UpdateMenuPaths(const std::string &new_path);
             void DoMoveTo(const std::string &new_path);
+            void HandleSearchEntries();
+            void MoveToSearchResult(const EntrySearchResult &result);
             void menu_EntryInputPressed(const u64 keys_down);
             void menu_FocusedEntryChanged(const bool has_prev_entry, const bool is_prev_entry_suspended, const bool is_cur_entry_suspended);
 
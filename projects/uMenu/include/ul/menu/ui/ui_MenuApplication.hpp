@@ -320,7 +320,7 @@ namespace ul::menu::ui {
                 }
                 else if(entry.Is<EntryType::Homebrew>()) {
                     // Enough to compare the NRO path
-                    return memcmp(this->system_status.suspended_hb_target_ipt.nro_path, entry.hb_info.nro_target.nro_path, sizeof(entry.hb_info.nro_target.nro_path)) == 0;
+                    return entry.hb_info.nro_path == this->system_status.suspended_hb_target_ipt.nro_path;
                 }
 
                 return false;
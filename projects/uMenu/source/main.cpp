@@ -90,10 +90,18 @@ namespace {
 
     void MainLoop() {
         // After initializing RomFs, start initializing the rest of stuff here
-        ul::menu::InitializeEntries();
+        const auto entries_rc = ul::menu::smi::InitializeMenuEntries();
+        if(R_FAILED(entries_rc)) {
+            UL_LOG_WARN("Unable to load menu entries from uSystem: %s, loading them from the SD card...", ul::util::FormatResultDisplay(entries_rc).c_str());
+            ul::menu::InitializeEntries();
+        }
 
-        // Load menu config
-        g_Config = ul::cfg::LoadConfig();
+        // Load menu config (kept in memory by uSystem)
+        const auto cfg_rc = ul::menu::smi::LoadConfig(g_Config);
+        if(R_FAILED(cfg_rc)) {
+            UL_LOG_WARN("Unable to load config from uSystem: %s, loading it from the SD card...", ul::util::FormatResultDisplay(cfg_rc).c_str());
+            g_Config = ul::cfg::LoadConfig();
+        }
 
         // Cache active theme if needed
         if(g_SystemStatus.reload_theme_cache) {
@@ -101,8 +109,7 @@ namespace {
         }
 
         // Load active theme if set
-        std::string active_theme_name;
-        UL_ASSERT_TRUE(g_Config.GetEntry(ul::cfg::ConfigEntryId::ActiveThemeName, active_theme_name));
+        const auto active_theme_name = g_Config.GetEntry<ul::cfg::ConfigEntryId::ActiveThemeName>();
         if(!active_theme_name.empty()) {
             const auto rc = ul::cfg::TryLoadTheme(active_theme_name, g_ActiveTheme);
             if(R_SUCCEEDED(rc)) {
@@ -111,7 +118,7 @@ namespace {
             else {
                 g_ActiveTheme = {};
                 UL_LOG_WARN("Unable to load active theme '%s': %s, resetting to default theme...", active_theme_name.c_str(), ul::util::FormatResultDisplay(rc).c_str());
-                UL_ASSERT_TRUE(g_Config.SetEntry(ul::cfg::ConfigEntryId::ActiveThemeName, g_ActiveTheme.name));
+                UL_ASSERT_TRUE(g_Config.SetEntry<ul::cfg::ConfigEntryId::ActiveThemeName>(g_ActiveTheme.name));
                 ul::cfg::RemoveActiveThemeCache();
             }
         }
@@ -1,6 +1,9 @@
 #include <ul/menu/smi/smi_MenuMessageHandler.hpp>
+#include <ul/menu/smi/smi_Commands.hpp>
+#include <ul/menu/menu_Entries.hpp>
 #include <ul/sf/sf_Base.hpp>
 #include <ul/util/util_Scope.hpp>
+#include <ul/util/util_String.hpp>
 #include <atomic>
 
 namespace ul::menu::smi {
@@ -21,7 +24,35 @@ namespace ul::menu::smi {
             );
         }
 
+        inline Result privateServiceGetMenuEntrySnapshot(Service *srv, Handle *out_shmem_handle, u64 *out_shmem_size) {
+            return serviceDispatchOut(srv, 2, *out_shmem_size,
+                .out_handle_attrs = { SfOutHandleAttr_HipcCopy },
+                .out_handles = out_shmem_handle
+            );
+        }
+
+        inline Result privateServiceGetConfig(Service *srv, void *out_cfg_buf, const size_t out_cfg_buf_size, u32 *out_generation) {
+            return serviceDispatchOut(srv, 3, *out_generation,
+                .buffer_attrs = { SfBufferAttr_HipcMapAlias | SfBufferAttr_Out },
+                .buffers = { { out_cfg_buf, out_cfg_buf_size } },
+            );
+        }
+
+        inline Result privateServiceSetConfigEntry(Service *srv, const cfg::ConfigEntryDelta *delta, u32 *out_generation) {
+            return serviceDispatchOut(srv, 4, *out_generation,
+                .buffer_attrs = { SfBufferAttr_HipcMapAlias | SfBufferAttr_In },
+                .buffers = { { delta, sizeof(cfg::ConfigEntryDelta) } },
+            );
+        }
+
+        inline Result privateServiceGetConfigGeneration(Service *srv, u32 *out_generation) {
+            return serviceDispatchOut(srv, 5, *out_generation);
+        }
+
         Service g_PrivateService;
+        SharedMemory g_MenuEntrySnapshotSharedMemory;
+        // Generation of System's config our copy matches
+        u32 g_ConfigGeneration = 0;
 
         Result InitializePrivateService() {
             if(serviceIsActive(&g_PrivateService)) {
@@ -42,6 +73,20 @@ namespace ul::menu::smi {
             return privateServiceTryPopMessageContext(&g_PrivateService, out_msg_ctx);
         }
 
+        Result MapMenuEntrySnapshot() {
+            if(shmemGetAddr(&g_MenuEntrySnapshotSharedMemory) != nullptr) {
+                return ResultSuccess;
+            }
+
+            Handle shmem_handle;
+            u64 shmem_size;
+            UL_RC_TRY(privateServiceGetMenuEntrySnapshot(&g_PrivateService, &shmem_handle, &shmem_size));
+
+            shmemLoadRemote(&g_MenuEntrySnapshotSharedMemory, shmem_handle, shmem_size, Perm_R);
+            UL_RC_TRY(shmemMap(&g_MenuEntrySnapshotSharedMemory));
+            return ResultSuccess;
+        }
+
     }
 
     namespace {
@@ -105,6 +150,67 @@ namespace ul::menu::smi {
         g_Initialized = false;
     }
 
+    Result InitializeMenuEntries() {
+        UL_RC_TRY(InitializePrivateService());
+
+        // Our changes are written to the SD card as usual, System just reloads the affected folders
+        menu::SetOnEntriesChanged([](const std::vector<std::string> &folder_paths) {
+            const auto rc = ReloadMenuEntries(folder_paths);
+            if(R_FAILED(rc)) {
+                UL_LOG_WARN("Unable to notify menu entry changes: %s", util::FormatResultDisplay(rc).c_str());
+            }
+        });
+
+        UL_RC_TRY(MapMenuEntrySnapshot());
+        if(!menu::InitializeEntriesFromSnapshot(shmemGetAddr(&g_MenuEntrySnapshotSharedMemory), g_MenuEntrySnapshotSharedMemory.size)) {
+            return ResultInvalidMenuEntrySnapshot;
+        }
+
+        return ResultSuccess;
+    }
+
+    Result LoadConfig(cfg::Config &out_cfg) {
+        UL_RC_TRY(InitializePrivateService());
+
+        u8 cfg_buf[cfg::ConfigMaxSerializedSize];
+        u32 generation;
+        UL_RC_TRY(privateServiceGetConfig(&g_PrivateService, cfg_buf, sizeof(cfg_buf), &generation));
+
+        cfg::Config cfg;
+        if(!cfg::DeserializeConfig(cfg_buf, sizeof(cfg_buf), cfg)) {
+            return ResultInvalidConfigEntry;
+        }
+
+        out_cfg = std::move(cfg);
+        g_ConfigGeneration = generation;
+        return ResultSuccess;
+    }
+
+    Result RefreshConfig(cfg::Config &cfg) {
+        UL_RC_TRY(InitializePrivateService());
+
+        u32 generation;
+        UL_RC_TRY(privateServiceGetConfigGeneration(&g_PrivateService, &generation));
+        if(generation == g_ConfigGeneration) {
+            return ResultSuccess;
+        }
+
+        return LoadConfig(cfg);
+    }
+
+    Result SetConfigEntry(const cfg::ConfigEntryDelta &delta) {
+        UL_RC_TRY(InitializePrivateService());
+
+        u32 generation;
+        UL_RC_TRY(privateServiceSetConfigEntry(&g_PrivateService, &delta, &generation));
+
+        // If anything else changed meanwhile, our copy stays outdated (and gets reloaded on the next refresh)
+        if(generation == (g_ConfigGeneration + 1)) {
+            g_ConfigGeneration = generation;
+        }
+        return ResultSuccess;
+    }
+
     void RegisterOnMessageDetect(OnMessageCallback callback, const MenuMessage desired_msg) {
         ScopedLock lk(g_CallbackTableLock);
 
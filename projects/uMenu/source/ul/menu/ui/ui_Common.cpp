@@ -114,11 +114,6 @@ namespace ul::menu::ui {
         return g_UserIconTexture;
     }
 
-    void SaveConfig() {
-        cfg::SaveConfig(g_Config);
-        UL_RC_ASSERT(smi::ReloadConfig());
-    }
-
     void RebootSystem() {
         PushPowerSystemAppletMessage(system::GeneralChannelMessage::Unk_Reboot);
     }
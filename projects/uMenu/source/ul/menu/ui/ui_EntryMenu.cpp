@@ -4,6 +4,7 @@
 #include <ul/menu/smi/smi_Commands.hpp>
 #include <ul/util/util_String.hpp>
 #include <ul/acc/acc_Accounts.hpp>
+#include <ul/menu/menu_Cache.hpp>
 
 extern ul::menu::ui::MenuApplication::Ref g_MenuApplication;
 extern ul::cfg::Config g_Config;
@@ -15,12 +16,105 @@ namespace ul::menu::ui {
         u32 g_EntryHeightCount = 0;
 
         void SetEntryHeightCount(const u32 count) {
-            UL_ASSERT_TRUE(g_Config.SetEntry(cfg::ConfigEntryId::MenuEntryHeightCount, static_cast<u64>(count)));
-            SaveConfig();
+            SetConfigEntry<cfg::ConfigEntryId::MenuEntryHeightCount>(g_Config, count);
 
             g_EntryHeightCount = count;
         }
 
+        inline bool HasCacheIcon(const Entry &entry) {
+            return (entry.Is<EntryType::Application>() || entry.Is<EntryType::Homebrew>()) && !entry.control.custom_icon_path;
+        }
+
+        inline bool ReadCacheScaledIcon(const Entry &entry, const u32 size, std::vector<u8> &out_rgba_data) {
+            return entry.Is<EntryType::Application>() ? ReadApplicationCacheScaledIcon(entry.app_info.app_id, size, out_rgba_data) : ReadHomebrewCacheScaledIcon(entry.hb_info.nro_path, size, out_rgba_data);
+        }
+
+        inline bool WriteCacheScaledIcon(const Entry &entry, const u32 size, const std::vector<u8> &rgba_data) {
+            return entry.Is<EntryType::Application>() ? WriteApplicationCacheScaledIcon(entry.app_info.app_id, size, rgba_data) : WriteHomebrewCacheScaledIcon(entry.hb_info.nro_path, size, rgba_data);
+        }
+
+        // Area-averaging downscale (cached icons are bigger than any entry size), since SDL's software scaling is nearest-neighbour only
+        void ScaleRgba(const u8 *src_rgba, const u32 src_w, const u32 src_h, u8 *dst_rgba, const u32 dst_size) {
+            for(u32 dst_y = 0; dst_y < dst_size; dst_y++) {
+                const auto src_y_start = (dst_y * src_h) / dst_size;
+                const auto src_y_end = std::max(((dst_y + 1) * src_h) / dst_size, src_y_start + 1);
+                for(u32 dst_x = 0; dst_x < dst_size; dst_x++) {
+                    const auto src_x_start = (dst_x * src_w) / dst_size;
+                    const auto src_x_end = std::max(((dst_x + 1) * src_w) / dst_size, src_x_start + 1);
+
+                    u32 sum[4] = {};
+                    for(auto src_y = src_y_start; src_y < src_y_end; src_y++) {
+                        for(auto src_x = src_x_start; src_x < src_x_end; src_x++) {
+                            const auto src_px = src_rgba + (src_y * src_w + src_x) * 4;
+                            for(u32 c = 0; c < 4; c++) {
+                                sum[c] += src_px[c];
+                            }
+                        }
+                    }
+
+                    const auto px_count = (src_y_end - src_y_start) * (src_x_end - src_x_start);
+                    const auto dst_px = dst_rgba + (dst_y * dst_size + dst_x) * 4;
+                    for(u32 c = 0; c < 4; c++) {
+                        dst_px[c] = static_cast<u8>(sum[c] / px_count);
+                    }
+                }
+            }
+        }
+
+        // Decodes the cached (JPEG) icon and scales it to the entry size, this only uses software surfaces thus it's fine outside the render thread
+        bool DecodeCacheScaledIcon(const Entry &entry, const u32 size, std::vector<u8> &out_rgba_data) {
+            std::vector<u8> icon_data;
+            const auto icon_found = entry.Is<EntryType::Application>() ? ReadApplicationCacheIcon(entry.app_info.app_id, icon_data) : ReadHomebrewCacheIcon(entry.hb_info.nro_path, icon_data);
+            if(!icon_found) {
+                return false;
+            }
+
+            auto icon_srf = IMG_Load_RW(SDL_RWFromConstMem(icon_data.data(), icon_data.size()), 1);
+            if(icon_srf == nullptr) {
+                return false;
+            }
+            auto rgba_srf = SDL_ConvertSurfaceFormat(icon_srf, SDL_PIXELFORMAT_ABGR8888, 0);
+            SDL_FreeSurface(icon_srf);
+            if(rgba_srf == nullptr) {
+                return false;
+            }
+
+            std::vector<u8> src_rgba_data(rgba_srf->w * rgba_srf->h * 4);
+            for(s32 y = 0; y < rgba_srf->h; y++) {
+                memcpy(src_rgba_data.data() + y * rgba_srf->w * 4, reinterpret_cast<const u8*>(rgba_srf->pixels) + y * rgba_srf->pitch, rgba_srf->w * 4);
+            }
+            out_rgba_data.resize(size * size * 4);
+            ScaleRgba(src_rgba_data.data(), rgba_srf->w, rgba_srf->h, out_rgba_data.data(), size);
+            SDL_FreeSurface(rgba_srf);
+            return true;
+        }
+
+        void EnsureCacheScaledIcon(const Entry &entry, const u32 size) {
+            std::vector<u8> rgba_data;
+            if(HasCacheIcon(entry) && !ReadCacheScaledIcon(entry, size, rgba_data) && DecodeCacheScaledIcon(entry, size, rgba_data)) {
+                WriteCacheScaledIcon(entry, size, rgba_data);
+            }
+        }
+
+        pu::sdl2::TextureHandle::Ref TryLoadCacheIconTexture(const Entry &entry, const u32 size) {
+            // Usually the scaled icon is already there (prepared by the entry loader, or by a previous load), thus it's just inflated into the texture
+            std::vector<u8> rgba_data;
+            if(!ReadCacheScaledIcon(entry, size, rgba_data)) {
+                if(!DecodeCacheScaledIcon(entry, size, rgba_data)) {
+                    return nullptr;
+                }
+                WriteCacheScaledIcon(entry, size, rgba_data);
+            }
+
+            auto icon_tex = SDL_CreateTexture(pu::ui::render::GetMainRenderer(), SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STATIC, size, size);
+            if(icon_tex == nullptr) {
+                return nullptr;
+            }
+            SDL_UpdateTexture(icon_tex, nullptr, rgba_data.data(), size * 4);
+            SDL_SetTextureBlendMode(icon_tex, SDL_BLENDMODE_BLEND);
+            return pu::sdl2::TextureHandle::New(icon_tex);
+        }
+
     }
 
     void EntryMenu::SwipeSingleLeft() {
@@ -81,11 +175,13 @@ namespace ul::menu::ui {
     pu::sdl2::TextureHandle::Ref EntryMenu::LoadEntryIconTexture(const Entry &entry) {
         auto icon_path = entry.control.icon_path;
         if(icon_path.empty()) {
-            if(entry.Is<EntryType::Application>()) {
-                icon_path = "ui/Main/EntryIcon/DefaultApplication";
-            }
-            else if(entry.Is<EntryType::Homebrew>()) {
-                icon_path = "ui/Main/EntryIcon/DefaultHomebrew";
+            if(entry.Is<EntryType::Application>() || entry.Is<EntryType::Homebrew>()) {
+                // Non-custom icons come from the cache icon packs (a single open pack per cache)
+                auto cache_icon = TryLoadCacheIconTexture(entry, this->entry_size);
+                if(cache_icon != nullptr) {
+                    return cache_icon;
+                }
+                icon_path = entry.Is<EntryType::Application>() ? "ui/Main/EntryIcon/DefaultApplication" : "ui/Main/EntryIcon/DefaultHomebrew";
             }
             else if(entry.Is<EntryType::Folder>()) {
                 return this->folder_entry_icon;
@@ -121,9 +217,11 @@ namespace ul::menu::ui {
 
     bool EntryMenu::LoadEntry(const u32 idx) {
         if(idx < this->cur_entries.size()) {
-            const auto &entry = this->cur_entries.at(idx);
+            auto &entry = this->cur_entries.at(idx);
             if(!entry.Is<EntryType::Invalid>()) {
                 this->entry_icons.at(idx) = this->LoadEntryIconTexture(entry);
+                // Entries are loaded outwards from the focused one (one per side and frame), thus visible entries get their meta status first
+                entry.TryLoadApplicationMetaStatus();
 
                 auto &entry_alpha = this->load_img_entry_alphas.at(idx);
                 entry_alpha = 0;
@@ -136,6 +234,80 @@ namespace ul::menu::ui {
         return false;
     }
 
+    void EntryMenu::EntryLoaderThread(void *menu_ptr) {
+        auto menu = reinterpret_cast<EntryMenu*>(menu_ptr);
+        for(auto &entry: menu->entry_loader_pending_entries) {
+            if(menu->entry_loader_should_stop) {
+                break;
+            }
+
+            const auto is_valid = entry.LoadRuntimeInfo();
+            if(is_valid) {
+                // Prepare the scaled icon beforehand, so that showing it later is just a matter of inflating it
+                EnsureCacheScaledIcon(entry, menu->entry_loader_icon_size);
+            }
+
+            ScopedLock lk(menu->entry_loader_lock);
+            menu->entry_loader_loaded_entries.push_back({ std::move(entry), is_valid });
+        }
+
+        FlushCaches();
+    }
+
+    void EntryMenu::StartEntryLoader(std::vector<Entry> &&pending_entries) {
+        this->StopEntryLoader();
+        if(pending_entries.empty()) {
+            return;
+        }
+
+        this->entry_loader_pending_entries = std::move(pending_entries);
+        this->entry_loader_icon_size = this->entry_size;
+        this->entry_loader_should_stop = false;
+        UL_RC_ASSERT(threadCreate(&this->entry_loader_thread, &EntryLoaderThread, this, nullptr, EntryLoaderThreadStackSize, 49, -2));
+        UL_RC_ASSERT(threadStart(&this->entry_loader_thread));
+        this->entry_loader_thread_started = true;
+    }
+
+    void EntryMenu::StopEntryLoader() {
+        if(this->entry_loader_thread_started) {
+            this->entry_loader_should_stop = true;
+            threadWaitForExit(&this->entry_loader_thread);
+            threadClose(&this->entry_loader_thread);
+            this->entry_loader_thread_started = false;
+        }
+
+        this->entry_loader_pending_entries.clear();
+        this->entry_loader_loaded_entries.clear();
+    }
+
+    void EntryMenu::ApplyLoadedEntries() {
+        std::vector<std::pair<Entry, bool>> loaded_entries;
+        {
+            ScopedLock lk(this->entry_loader_lock);
+            std::swap(loaded_entries, this->entry_loader_loaded_entries);
+        }
+
+        for(auto &[entry, is_valid]: loaded_entries) {
+            // The entry might have been moved/removed in the meantime
+            if((entry.index >= this->cur_entries.size()) || (this->cur_entries.at(entry.index).entry_path != entry.entry_path)) {
+                continue;
+            }
+
+            const auto idx = entry.index;
+            if(is_valid) {
+                this->cur_entries.at(idx) = std::move(entry);
+                // Reload the icon if it was already loaded without the runtime info
+                if(this->entry_icons.at(idx) != nullptr) {
+                    this->LoadEntry(idx);
+                }
+            }
+            else {
+                this->cur_entries.at(idx).type = EntryType::Invalid;
+                this->entry_icons.at(idx) = {};
+            }
+        }
+    }
+
     void EntryMenu::NotifyFocusedEntryChanged(const s32 prev_entry_idx, const s32 is_prev_entry_suspended_override) {
         auto has_prev_entry = prev_entry_idx >= 0;
         bool is_prev_entry_suspended = false;
@@ -174,7 +346,7 @@ namespace ul::menu::ui {
         return entry;
     }
 
-    EntryMenu::EntryMenu(const s32 x, const s32 y, const std::string &path, FocusedEntryInputPressedCallback cur_entry_input_cb, FocusedEntryChangedCallback cur_entry_changed_cb, FocusedEntryChangeStartedCallback cur_entry_change_started_cb) : x(x), y(y), cur_entry_idx(0), entry_idx_stack(), cur_entry_input_cb(cur_entry_input_cb), cur_entry_changed_cb(cur_entry_changed_cb), cur_entry_change_started_cb(cur_entry_change_started_cb), enabled(true), selected_entry_idx(-1), empty_entry_icon(nullptr), selected_entry_icon(nullptr), entry_h_margin(EntryVerticalMargin), entries_to_add(), entries_to_remove(), pending_load_img_entry_start_idx(UINT32_MAX), pending_load_img_entry_ext_idx(UINT32_MAX), pending_load_img_done(false), entry_page_count(0), entry_total_count(0), swipe_mode(SwipeMode::None), entries_base_swipe_neg_offset(0), entries_base_swipe_neg_offset_incr(), extra_entry_swipe_show_h_count(0) {
+    EntryMenu::EntryMenu(const s32 x, const s32 y, const std::string &path, FocusedEntryInputPressedCallback cur_entry_input_cb, FocusedEntryChangedCallback cur_entry_changed_cb, FocusedEntryChangeStartedCallback cur_entry_change_started_cb) : x(x), y(y), cur_entry_idx(0), entry_idx_stack(), cur_entry_input_cb(cur_entry_input_cb), cur_entry_changed_cb(cur_entry_changed_cb), cur_entry_change_started_cb(cur_entry_change_started_cb), enabled(true), selected_entry_idx(-1), empty_entry_icon(nullptr), selected_entry_icon(nullptr), entry_h_margin(EntryVerticalMargin), entries_to_add(), entries_to_remove(), pending_load_img_entry_start_idx(UINT32_MAX), pending_load_img_entry_ext_idx(UINT32_MAX), pending_load_img_done(false), entry_page_count(0), entry_total_count(0), swipe_mode(SwipeMode::None), entries_base_swipe_neg_offset(0), entries_base_swipe_neg_offset_incr(), extra_entry_swipe_show_h_count(0), entry_loader_thread(), entry_loader_thread_started(false), entry_loader_should_stop(false), entry_loader_pending_entries(), entry_loader_icon_size(0), entry_loader_lock(), entry_loader_loaded_entries() {
         this->cursor_over_icon = TryFindLoadImage("ui/Main/OverIcon/Cursor");
         this->cursor_size = 0;
         this->border_over_icon = TryFindLoadImage("ui/Main/OverIcon/Border");
@@ -200,10 +372,12 @@ namespace ul::menu::ui {
         this->after_transition_entry_idx = -1;
     }
 
+    EntryMenu::~EntryMenu() {
+        this->StopEntryLoader();
+    }
+
     void EntryMenu::Initialize(const u32 last_idx) {
-        u64 entry_height_count;
-        UL_ASSERT_TRUE(g_Config.GetEntry(cfg::ConfigEntryId::MenuEntryHeightCount, entry_height_count));
-        g_EntryHeightCount = entry_height_count;
+        g_EntryHeightCount = g_Config.GetEntry<cfg::ConfigEntryId::MenuEntryHeightCount>();
         this->ComputeSizes(g_EntryHeightCount);
 
         this->entry_idx_stack.push(last_idx);
@@ -211,6 +385,8 @@ namespace ul::menu::ui {
     }
 
     void EntryMenu::OnRender(pu::ui::render::Renderer::Ref &drawer, const s32 x, const s32 y) {
+        this->ApplyLoadedEntries();
+
         const auto loaded_pending_load_img_entry_ext_idx = this->pending_load_img_entry_ext_idx;
         if(!this->pending_load_img_done) {
             const auto has_left = this->pending_load_img_entry_start_idx >= this->pending_load_img_entry_ext_idx;
@@ -225,6 +401,7 @@ namespace ul::menu::ui {
             }
 
             if(!has_left && !has_right) {
+                FlushCaches();
                 this->pending_load_img_done = true;
                 this->pending_load_img_entry_ext_idx = UINT32_MAX;
             }
@@ -453,10 +630,42 @@ namespace ul::menu::ui {
             this->entry_idx_stack.pop();
         }
 
+        this->StopEntryLoader();
         this->cur_entries.clear();
-        this->cur_entries = LoadEntries(this->cur_path);
+        // Runtime info is only loaded here for the visible page (plus some prefetched ones), the rest is loaded in the background
+        this->cur_entries = LoadEntries(this->cur_path, false);
         this->OrganizeEntries();
         this->ComputeSizes(g_EntryHeightCount);
+
+        const auto prefetch_count = EntryPrefetchPageCount * this->entry_page_count;
+        const auto base_idx = this->base_entry_idx_x * g_EntryHeightCount;
+        const auto sync_load_start_idx = (base_idx > prefetch_count) ? (base_idx - prefetch_count) : 0;
+        const auto sync_load_end_idx = base_idx + this->entry_page_count + prefetch_count;
+        std::vector<Entry> pending_entries;
+        for(u32 i = 0; i < this->cur_entries.size(); i++) {
+            auto &entry = this->cur_entries.at(i);
+            if(entry.Is<EntryType::Invalid>()) {
+                continue;
+            }
+
+            if((i >= sync_load_start_idx) && (i < sync_load_end_idx)) {
+                if(!entry.LoadRuntimeInfo()) {
+                    entry.type = EntryType::Invalid;
+                }
+            }
+            else {
+                pending_entries.push_back(entry);
+            }
+        }
+
+        // Load the remaining ones in the same order icons are loaded (outwards from the focused entry)
+        const auto cur_entry_idx = this->cur_entry_idx;
+        std::stable_sort(pending_entries.begin(), pending_entries.end(), [cur_entry_idx](const Entry &entry_a, const Entry &entry_b) -> bool {
+            const auto dist_a = (entry_a.index > cur_entry_idx) ? (entry_a.index - cur_entry_idx) : (cur_entry_idx - entry_a.index);
+            const auto dist_b = (entry_b.index > cur_entry_idx) ? (entry_b.index - cur_entry_idx) : (cur_entry_idx - entry_b.index);
+            return dist_a < dist_b;
+        });
+        this->StartEntryLoader(std::move(pending_entries));
         
         for(auto &entry_icon : this->entry_icons) {
             if(entry_icon != this->selected_entry_icon) {
@@ -479,22 +688,35 @@ namespace ul::menu::ui {
         this->pending_load_img_entry_ext_idx = 1;
         this->pending_load_img_done = false;
 
-        if(!reloading && !going_back) {
+        if(!reloading && !going_back && !force_pop_idx) {
             this->entry_idx_stack.push(old_entry_idx);
         }
     }
 
+    void EntryMenu::MoveToEntry(const std::string &folder_path, const std::vector<u32> &folder_entry_idxs, const u32 entry_idx) {
+        // Indexes are stacked as if every folder on the way had been opened one by one, thus going back works as usual
+        this->entry_idx_stack = {};
+        for(const auto folder_entry_idx: folder_entry_idxs) {
+            this->entry_idx_stack.push(folder_entry_idx);
+        }
+        this->entry_idx_stack.push(entry_idx);
+
+        this->MoveTo(folder_path, true);
+    }
+
     void EntryMenu::OrganizeEntries() {
         std::vector<Entry> tmp_entries;
+        tmp_entries.reserve(this->cur_entries.size() + this->entries_to_add.size());
         
-        for(const auto &entry: this->cur_entries) {
+        // Entries are moved (not copied) into place, the old list is discarded afterwards anyway
+        for(auto &entry: this->cur_entries) {
             if(!entry.Is<EntryType::Invalid>()) {
                 while(tmp_entries.size() < (entry.index + 1)) {
                     auto &tmp_entry = tmp_entries.emplace_back();
                     tmp_entry.type = EntryType::Invalid;
                 }
 
-                tmp_entries.at(entry.index) = entry;
+                tmp_entries.at(entry.index) = std::move(entry);
             }
         }
         
@@ -508,7 +730,7 @@ namespace ul::menu::ui {
             this->entry_icons.at(rem_entry.index) = {};
         }
 
-        for(const auto &add_entry: this->entries_to_add) {
+        for(auto &add_entry: this->entries_to_add) {
             UL_LOG_WARN("Adding entry of type %d at %d", (u32)add_entry.type, add_entry.index);
             if(add_entry.type != EntryType::Invalid) {
                 while(tmp_entries.size() < (add_entry.index + 1)) {
@@ -517,7 +739,7 @@ namespace ul::menu::ui {
                     tmp_entry.type = EntryType::Invalid;
                 }
 
-                tmp_entries.at(add_entry.index) = add_entry;
+                tmp_entries.at(add_entry.index) = std::move(add_entry);
             }
         }
 
@@ -560,6 +782,9 @@ namespace ul::menu::ui {
 
     void EntryMenu::IncrementEntryHeightCount() {
         auto h_count = g_EntryHeightCount;
+        if(h_count >= cfg::GetConfigEntrySchema(cfg::ConfigEntryId::MenuEntryHeightCount).max_u64) {
+            return;
+        }
         h_count++;
 
         g_MenuApplication->SetBackgroundFade();
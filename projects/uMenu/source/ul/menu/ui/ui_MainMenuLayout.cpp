@@ -16,11 +16,11 @@ namespace ul::menu::ui {
 
     namespace {
 
-        inline loader::TargetInput CreateLaunchTargetInput(const loader::TargetInput &base_params) {
+        inline loader::TargetInput CreateLaunchTargetInput(const EntryHomebrewInfo &base_params) {
             loader::TargetInput ipt = {};
             util::CopyToStringBuffer(ipt.nro_path, base_params.nro_path);
-            if(strlen(base_params.nro_argv) > 0) {
-                const auto default_argv = std::string(base_params.nro_path) + " " + base_params.nro_argv;
+            if(!base_params.nro_argv.empty()) {
+                const auto default_argv = base_params.nro_path + " " + base_params.nro_argv;
                 util::CopyToStringBuffer(ipt.nro_argv, default_argv);
             }
             else {
@@ -30,10 +30,10 @@ namespace ul::menu::ui {
         }
 
         inline bool IsEntryNonRemovable(const Entry &entry) {
-            if(strcmp(entry.hb_info.nro_target.nro_path, ul::HbmenuPath) == 0) {
+            if(entry.hb_info.nro_path == ul::HbmenuPath) {
                 return true;
             }
-            if(strcmp(entry.hb_info.nro_target.nro_path, ul::ManagerPath) == 0) {
+            if(entry.hb_info.nro_path == ul::ManagerPath) {
                 return true;
             }
 
@@ -52,17 +52,96 @@ namespace ul::menu::ui {
 
     }
 
+    void MainMenuLayout::UpdateMenuPaths(const std::string &new_path) {
+        util::CopyToStringBuffer(g_MenuFsPathBuffer, new_path);
+        util::CopyToStringBuffer(g_MenuPathBuffer, this->cur_folder_path);
+        UL_RC_ASSERT(smi::UpdateMenuPaths(g_MenuFsPathBuffer, g_MenuPathBuffer));
+    }
+
     void MainMenuLayout::DoMoveTo(const std::string &new_path) {
         // Empty path used as a "reload" argumnet
         if(!new_path.empty()) {
-            util::CopyToStringBuffer(g_MenuFsPathBuffer, new_path);
-            util::CopyToStringBuffer(g_MenuPathBuffer, this->cur_folder_path);
-            UL_RC_ASSERT(smi::UpdateMenuPaths(g_MenuFsPathBuffer, g_MenuPathBuffer));
+            this->UpdateMenuPaths(new_path);
         }
 
         this->entry_menu->MoveTo(new_path);
     }
 
+    void MainMenuLayout::HandleSearchEntries() {
+        SwkbdConfig cfg;
+        UL_RC_ASSERT(swkbdCreate(&cfg, 0));
+        swkbdConfigSetGuideText(&cfg, GetLanguageString("swkbd_search_entries_guide").c_str());
+        char query[500] = {};
+        const auto rc = swkbdShow(&cfg, query, sizeof(query));
+        swkbdClose(&cfg);
+        if(R_FAILED(rc)) {
+            return;
+        }
+
+        // Searching is fully done in memory, no folders are loaded here
+        const auto results = SearchEntries(query, MaxSearchResultCount);
+        if(results.empty()) {
+            g_MenuApplication->ShowNotification(GetLanguageString("search_entries_none"));
+            return;
+        }
+
+        std::vector<std::string> options;
+        for(const auto &result: results) {
+            options.push_back(result.name);
+        }
+        options.push_back(GetLanguageString("cancel"));
+        const auto option = g_MenuApplication->DisplayDialog(GetLanguageString("search_entries"), GetLanguageString("search_entries_results"), options, true);
+        if((option >= 0) && (static_cast<size_t>(option) < results.size())) {
+            this->MoveToSearchResult(results.at(option));
+        }
+    }
+
+    void MainMenuLayout::MoveToSearchResult(const EntrySearchResult &result) {
+        // Walk down to the result's folder, for the (displayed) folder names and the entry indexes to go back through
+        std::string folder_path = MenuPath;
+        std::string folder_names = "";
+        std::vector<u32> folder_entry_idxs;
+        const auto rel_folder_path = result.folder_path.substr(folder_path.length());
+        size_t cur_pos = 0;
+        while(cur_pos < rel_folder_path.length()) {
+            auto next_pos = rel_folder_path.find('/', cur_pos);
+            if(next_pos == std::string::npos) {
+                next_pos = rel_folder_path.length();
+            }
+            const auto fs_name = rel_folder_path.substr(cur_pos, next_pos - cur_pos);
+            cur_pos = next_pos + 1;
+            if(fs_name.empty()) {
+                continue;
+            }
+
+            const auto entries = LoadEntries(folder_path, false);
+            const auto find_folder = std::find_if(entries.begin(), entries.end(), [&](const Entry &entry) -> bool {
+                return entry.Is<EntryType::Folder>() && (entry.folder_info.fs_name == fs_name);
+            });
+            if(find_folder == entries.end()) {
+                // The menu changed after the search index was saved
+                g_MenuApplication->ShowNotification(GetLanguageString("search_entries_none"));
+                return;
+            }
+
+            folder_entry_idxs.push_back(find_folder->index);
+            folder_names = fs::JoinPath(folder_names, find_folder->folder_info.name);
+            folder_path = fs::JoinPath(folder_path, fs_name);
+        }
+
+        pu::audio::PlaySfx(this->open_folder_sfx);
+        this->cur_folder_path = folder_names;
+        this->cur_path_text->SetText(this->cur_folder_path);
+
+        g_MenuApplication->SetBackgroundFade();
+        g_MenuApplication->FadeOut();
+
+        this->UpdateMenuPaths(folder_path);
+        this->entry_menu->MoveToEntry(folder_path, folder_entry_idxs, result.index);
+
+        g_MenuApplication->FadeIn();
+    }
+
     void MainMenuLayout::menu_EntryInputPressed(const u64 keys_down) {
         if(keys_down & HidNpadButton_B) {
             if(this->entry_menu->IsAnySelected()) {
@@ -191,6 +270,7 @@ namespace ul::menu::ui {
 
                                 const auto rc = smi::LaunchApplication(cur_entry.app_info.record.application_id);
                                 if(R_SUCCEEDED(rc)) {
+                                    cur_entry.NotifyLaunched();
                                     g_MenuApplication->Finalize();
                                     return;
                                 }
@@ -314,14 +394,14 @@ namespace ul::menu::ui {
                         if(option == 0) {
                             SwkbdConfig cfg;
                             UL_RC_ASSERT(swkbdCreate(&cfg, 0));
-                            swkbdConfigSetInitialText(&cfg, cur_entry.folder_info.name);
+                            swkbdConfigSetInitialText(&cfg, cur_entry.folder_info.name.c_str());
                             swkbdConfigSetGuideText(&cfg, GetLanguageString("swkbd_folder_name_guide").c_str());
                             char new_folder_name[500] = {};
                             const auto rc = swkbdShow(&cfg, new_folder_name, sizeof(new_folder_name));
                             swkbdClose(&cfg);
                             
                             if(R_SUCCEEDED(rc)) {
-                                util::CopyToStringBuffer(cur_entry.folder_info.name, new_folder_name);
+                                cur_entry.folder_info.name = new_folder_name;
                                 cur_entry.Save();
                                 this->entry_menu->OrganizeUpdateEntries();
                                 g_MenuApplication->ShowNotification(GetLanguageString("menu_folder_renamed"));
@@ -416,6 +496,11 @@ namespace ul::menu::ui {
             pu::audio::PlaySfx(this->page_move_sfx);
             this->entry_menu->MoveToNextPage();
         }
+        else if(keys_down & HidNpadButton_StickR) {
+            if(!this->entry_menu->IsAnySelected()) {
+                this->HandleSearchEntries();
+            }
+        }
     }
 
     void MainMenuLayout::menu_FocusedEntryChanged(const bool has_prev_entry, const bool is_prev_entry_suspended, const bool is_cur_entry_suspended) {
@@ -430,10 +515,10 @@ namespace ul::menu::ui {
             auto &cur_entry = this->entry_menu->GetFocusedEntry();
             if(cur_entry.Is<EntryType::Folder>()) {
                 this->SetTopMenuFolder();
-                // TODO: show folder entry count?
-                // this->cur_entry_author_text->SetText(std::to_string(folder_entry_count) + " " + ((folder_entry_count == 1) ? "One entry" : "Multiple entries";
                 this->cur_entry_main_text->SetText(cur_entry.folder_info.name);
-                this->cur_entry_sub_text->SetVisible(false);
+                // Folder stats are kept in the folder entry itself, thus no need to load the folder's entries
+                const auto folder_entry_count = cur_entry.stats.child_count;
+                this->cur_entry_sub_text->SetText(std::to_string(folder_entry_count) + " " + GetLanguageString((folder_entry_count == 1) ? "folder_entry_single" : "folder_entry_mult"));
             }
             else if(cur_entry.Is<EntryType::SpecialEntryMiiEdit>()) {
                 this->SetTopMenuDefault();
@@ -622,6 +707,7 @@ namespace ul::menu::ui {
         this->Add(this->quick_menu);
 
         this->startup_tp = std::chrono::steady_clock::now();
+        this->last_cache_stats_log_tp = this->startup_tp;
 
         this->post_suspend_sfx = pu::audio::LoadSfx(TryGetActiveThemeResource("sound/Main/PostSuspend.wav"));
         this->cursor_move_sfx = pu::audio::LoadSfx(TryGetActiveThemeResource("sound/Main/CursorMove.wav"));
@@ -781,6 +867,10 @@ namespace ul::menu::ui {
 
         this->input_bar->AddSetInput(HidNpadButton_ZL | HidNpadButton_ZR, GetLanguageString("input_quick_menu"));
 
+        if(!this->entry_menu->IsAnySelected()) {
+            this->input_bar->AddSetInput(HidNpadButton_StickR, GetLanguageString("input_search_entries"));
+        }
+
         ///////////////////////////////
 
         const auto now_tp = std::chrono::steady_clock::now();
@@ -828,6 +918,11 @@ namespace ul::menu::ui {
             this->battery_charging_top_icon->SetVisible(is_charging);
         }
 
+        if(std::chrono::duration_cast<std::chrono::seconds>(now_tp - this->last_cache_stats_log_tp).count() >= CacheStatsLogIntervalSeconds) {
+            LogCacheStats();
+            this->last_cache_stats_log_tp = now_tp;
+        }
+
         if(!this->start_time_elapsed) {
             // Wait a bit before handling sent messages
             if(std::chrono::duration_cast<std::chrono::seconds>(now_tp - this->startup_tp).count() >= MessagesWaitTimeSeconds) {
@@ -990,9 +1085,10 @@ namespace ul::menu::ui {
         if(option == 0) {
             pu::audio::PlaySfx(this->launch_hb_sfx);
             
-            const auto proper_ipt = CreateLaunchTargetInput(hb_entry.hb_info.nro_target);
+            const auto proper_ipt = CreateLaunchTargetInput(hb_entry.hb_info);
             UL_RC_ASSERT(smi::LaunchHomebrewLibraryApplet(proper_ipt.nro_path, proper_ipt.nro_argv));
 
+            Entry(hb_entry).NotifyLaunched();
             g_MenuApplication->Finalize();
         }
         else if(option == 1) {
@@ -1008,10 +1104,11 @@ namespace ul::menu::ui {
                 if(launch) {
                     pu::audio::PlaySfx(this->launch_hb_sfx);
                     
-                    const auto ipt = CreateLaunchTargetInput(hb_entry.hb_info.nro_target);
+                    const auto ipt = CreateLaunchTargetInput(hb_entry.hb_info);
                     const auto rc = smi::LaunchHomebrewApplication(ipt.nro_path, ipt.nro_argv);
 
                     if(R_SUCCEEDED(rc)) {
+                        Entry(hb_entry).NotifyLaunched();
                         g_MenuApplication->Finalize();
                         return;
                     }
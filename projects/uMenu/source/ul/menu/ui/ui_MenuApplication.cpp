@@ -28,7 +28,7 @@ namespace ul::menu::ui {
         this->pending_gc_mount_rc = ResultSuccess;
         LoadCommonTextures();
 
-        UL_ASSERT_TRUE(g_Config.GetEntry(cfg::ConfigEntryId::HomebrewApplicationTakeoverApplicationId, this->takeover_app_id));
+        this->takeover_app_id = g_Config.GetEntry<cfg::ConfigEntryId::HomebrewApplicationTakeoverApplicationId>();
 
         u8 *screen_capture_buf = nullptr;
         if(this->IsSuspended()) {
@@ -215,9 +215,7 @@ namespace ul::menu::ui {
     void MenuApplication::SetTakeoverApplicationId(const u64 app_id) {
         this->takeover_app_id = app_id;
 
-        // No need to save config, uSystem deals with that
-        UL_ASSERT_TRUE(g_Config.SetEntry(cfg::ConfigEntryId::HomebrewApplicationTakeoverApplicationId, this->takeover_app_id));
-        SaveConfig();
+        SetConfigEntry<cfg::ConfigEntryId::HomebrewApplicationTakeoverApplicationId>(g_Config, this->takeover_app_id);
     }
 
     void MenuApplication::ShowNotification(const std::string &text, const u64 timeout) {
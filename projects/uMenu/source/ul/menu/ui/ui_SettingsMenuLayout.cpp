@@ -5,6 +5,7 @@
 #include <ul/acc/acc_Accounts.hpp>
 #include <ul/os/os_System.hpp>
 #include <ul/util/util_Scope.hpp>
+#include <ul/menu/menu_Cache.hpp>
 
 extern SetSysFirmwareVersion g_FwVersion;
 
@@ -35,6 +36,10 @@ namespace ul::menu::ui {
             return t ? GetLanguageString("set_true_value") : GetLanguageString("set_false_value");
         }
 
+        inline std::string FormatCacheSize(const u64 size) {
+            return std::to_string(size / (1024 * 1024)) + " MB";
+        }
+
         constexpr u32 ExosphereApiVersionConfigItem = 65000;
         constexpr u32 ExosphereEmummcType = 65007;
         constexpr u32 ExosphereSupportedHosVersion = 65011;
@@ -111,6 +116,11 @@ namespace ul::menu::ui {
     void SettingsMenuLayout::Reload(const bool reset_idx) {
         // TODO (long term): implement more settings!
 
+        const auto cfg_rc = smi::RefreshConfig(g_Config);
+        if(R_FAILED(cfg_rc)) {
+            UL_LOG_WARN("Unable to refresh config from uSystem: %s", util::FormatResultDisplay(cfg_rc).c_str());
+        }
+
         const auto prev_idx = this->settings_menu->GetSelectedIndex();
         this->settings_menu->ClearItems();
 
@@ -128,8 +138,7 @@ namespace ul::menu::ui {
         UL_RC_ASSERT(timeGetDeviceLocationName(&loc));
         this->PushSettingItem(GetLanguageString("set_console_timezone"), EncodeForSettings<std::string>(loc.name), -1);
 
-        bool viewer_usb_enabled;
-        UL_ASSERT_TRUE(g_Config.GetEntry(cfg::ConfigEntryId::ViewerUsbEnabled, viewer_usb_enabled));
+        const auto viewer_usb_enabled = g_Config.GetEntry<cfg::ConfigEntryId::ViewerUsbEnabled>();
         this->PushSettingItem(GetLanguageString("set_viewer_enabled"), EncodeForSettings(viewer_usb_enabled), 1);
 
         auto connected_wifi_name = GetLanguageString("set_wifi_none");
@@ -189,6 +198,11 @@ namespace ul::menu::ui {
         const auto ip_str = net::GetConsoleIpAddress();
         this->PushSettingItem(GetLanguageString("set_ip_addr"), EncodeForSettings(ip_str), -1);
 
+        const auto cache_stats = GetCacheStats();
+        this->PushSettingItem(GetLanguageString("set_cache_usage"), EncodeForSettings<std::string>(FormatCacheSize(cache_stats.total_size) + " / " + FormatCacheSize(cache_stats.budget_size)), -1);
+        this->PushSettingItem(GetLanguageString("set_cache_hits"), EncodeForSettings<std::string>(std::to_string(cache_stats.GetHitCount()) + " / " + std::to_string(cache_stats.GetMissCount())), -1);
+        this->PushSettingItem(GetLanguageString("set_cache_evictions"), EncodeForSettings<std::string>(std::to_string(cache_stats.eviction_count) + " (" + FormatCacheSize(cache_stats.evicted_size) + ")"), -1);
+
         this->settings_menu->SetSelectedIndex(reset_idx ? 0 : prev_idx);
     }
 
@@ -226,12 +240,11 @@ namespace ul::menu::ui {
                 break;
             }
             case 1: {
-                bool viewer_usb_enabled;
-                UL_ASSERT_TRUE(g_Config.GetEntry(cfg::ConfigEntryId::ViewerUsbEnabled, viewer_usb_enabled));
+                auto viewer_usb_enabled = g_Config.GetEntry<cfg::ConfigEntryId::ViewerUsbEnabled>();
                 auto sopt = g_MenuApplication->DisplayDialog(GetLanguageString("set_viewer_enabled"), GetLanguageString("set_viewer_info") + "\n" + (viewer_usb_enabled ? GetLanguageString("set_viewer_disable_conf") : GetLanguageString("set_viewer_enable_conf")), { GetLanguageString("yes"), GetLanguageString("cancel") }, true);
                 if(sopt == 0) {
                     viewer_usb_enabled = !viewer_usb_enabled;
-                    UL_ASSERT_TRUE(g_Config.SetEntry(cfg::ConfigEntryId::ViewerUsbEnabled, viewer_usb_enabled));
+                    SetConfigEntry<cfg::ConfigEntryId::ViewerUsbEnabled>(g_Config, viewer_usb_enabled);
                     reload_need = true;
                     g_MenuApplication->ShowNotification(GetLanguageString("set_changed_reboot"));
                 }
@@ -330,7 +343,6 @@ namespace ul::menu::ui {
 
         if(reload_need) {
             pu::audio::PlaySfx(this->setting_save_sfx);
-            SaveConfig();
             this->Reload(false);
         }
     }
@@ -62,13 +62,12 @@ namespace ul::menu::ui {
         
         for(const auto &theme: this->loaded_themes) {
             if(theme.IsValid()) {
-                std::string theme_icon_path;
-                const auto rc = cfg::TryCacheLoadThemeIcon(theme, theme_icon_path);
-                if(R_FAILED(rc)) {
-                    UL_LOG_WARN("Theme '%s' unable to load image: %s", theme.name.c_str(), util::FormatResultDisplay(rc).c_str());
+                // Icons are already cached by FindThemes
+                if(theme.icon_path.empty()) {
+                    UL_LOG_WARN("Theme '%s' has no cached icon", theme.name.c_str());
                 }
 
-                auto theme_icon = pu::sdl2::TextureHandle::New(pu::ui::render::LoadImage(theme_icon_path));
+                auto theme_icon = pu::sdl2::TextureHandle::New(pu::ui::render::LoadImage(theme.icon_path));
                 this->loaded_theme_icons.push_back(theme_icon);
 
                 auto theme_item = pu::ui::elm::MenuItem::New(theme.manifest.name + " (v" + theme.manifest.release + ", " + theme.manifest.author + ")");
@@ -106,8 +105,7 @@ namespace ul::menu::ui {
                 const auto option = g_MenuApplication->DisplayDialog(selected_theme.manifest.name, theme_conf_msg, { GetLanguageString("yes"), GetLanguageString("cancel") }, true, this->loaded_theme_icons.at(idx));
                 if(option == 0) {
                     g_ActiveTheme = selected_theme;
-                    UL_ASSERT_TRUE(g_Config.SetEntry(cfg::ConfigEntryId::ActiveThemeName, g_ActiveTheme.name));
-                    SaveConfig();
+                    SetConfigEntry<cfg::ConfigEntryId::ActiveThemeName>(g_Config, g_ActiveTheme.name);
                     g_MenuApplication->ShowNotification(GetLanguageString("theme_cache"));
 
                     pu::audio::PlaySfx(this->theme_change_sfx);
@@ -122,8 +120,7 @@ namespace ul::menu::ui {
                 const auto option = g_MenuApplication->DisplayDialog(GetLanguageString("theme_reset"), GetLanguageString("theme_reset_conf"), { GetLanguageString("yes"), GetLanguageString("cancel") }, true);
                 if(option == 0) {
                     g_ActiveTheme = {};
-                    UL_ASSERT_TRUE(g_Config.SetEntry(cfg::ConfigEntryId::ActiveThemeName, g_ActiveTheme.name));
-                    SaveConfig();
+                    SetConfigEntry<cfg::ConfigEntryId::ActiveThemeName>(g_Config, g_ActiveTheme.name);
                     g_MenuApplication->ShowNotification(GetLanguageString("theme_cache"));
 
                     pu::audio::PlaySfx(this->theme_change_sfx);
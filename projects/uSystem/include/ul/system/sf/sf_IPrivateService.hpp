@@ -2,6 +2,7 @@
 #pragma once
 #include <stratosphere.hpp>
 #include <ul/system/smi/smi_SystemProtocol.hpp>
+#include <ul/cfg/cfg_Config.hpp>
 
 namespace ul::system::sf {
 
@@ -9,11 +10,19 @@ namespace ul::system::sf {
         smi::MenuMessageContext actual_ctx;
     };
 
+    struct ConfigEntryDelta : ::ams::sf::LargeData, ::ams::sf::PrefersMapAliasTransferMode {
+        cfg::ConfigEntryDelta actual_delta;
+    };
+
 }
 
 #define UL_SYSTEM_SF_I_PRIVATE_SERVICE_INTERFACE_INFO(C, H) \
     AMS_SF_METHOD_INFO(C, H, 0, Result, Initialize, (const ::ams::sf::ClientProcessId &client_pid), (client_pid)) \
-    AMS_SF_METHOD_INFO(C, H, 1, Result, TryPopMessageContext, (::ams::sf::Out<::ul::system::sf::MenuMessageContext> out_msg), (out_msg))
+    AMS_SF_METHOD_INFO(C, H, 1, Result, TryPopMessageContext, (::ams::sf::Out<::ul::system::sf::MenuMessageContext> out_msg), (out_msg)) \
+    AMS_SF_METHOD_INFO(C, H, 2, Result, GetMenuEntrySnapshot, (::ams::sf::OutCopyHandle out_shmem_h, ::ams::sf::Out<u64> out_shmem_size), (out_shmem_h, out_shmem_size)) \
+    AMS_SF_METHOD_INFO(C, H, 3, Result, GetConfig, (const ::ams::sf::OutBuffer &out_cfg_buf, ::ams::sf::Out<u32> out_generation), (out_cfg_buf, out_generation)) \
+    AMS_SF_METHOD_INFO(C, H, 4, Result, SetConfigEntry, (const ::ul::system::sf::ConfigEntryDelta &delta, ::ams::sf::Out<u32> out_generation), (delta, out_generation)) \
+    AMS_SF_METHOD_INFO(C, H, 5, Result, GetConfigGeneration, (::ams::sf::Out<u32> out_generation), (out_generation))
 
 AMS_SF_DEFINE_INTERFACE(ams::ul::system::sf, IPrivateService, UL_SYSTEM_SF_I_PRIVATE_SERVICE_INTERFACE_INFO, 0xCAFEBABE)
 
@@ -28,6 +37,10 @@ namespace ul::system::sf {
 
             ::ams::Result Initialize(const ::ams::sf::ClientProcessId &client_pid);
             ::ams::Result TryPopMessageContext(::ams::sf::Out<MenuMessageContext> out_msg);
+            ::ams::Result GetMenuEntrySnapshot(::ams::sf::OutCopyHandle out_shmem_h, ::ams::sf::Out<u64> out_shmem_size);
+            ::ams::Result GetConfig(const ::ams::sf::OutBuffer &out_cfg_buf, ::ams::sf::Out<u32> out_generation);
+            ::ams::Result SetConfigEntry(const ConfigEntryDelta &delta, ::ams::sf::Out<u32> out_generation);
+            ::ams::Result GetConfigGeneration(::ams::sf::Out<u32> out_generation);
     };
     static_assert(::ams::ul::system::sf::IsIPrivateService<PrivateService>);
 
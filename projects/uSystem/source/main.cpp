@@ -5,6 +5,7 @@
 #include <ul/system/system_Message.hpp>
 #include <ul/cfg/cfg_Config.hpp>
 #include <ul/menu/menu_Entries.hpp>
+#include <ul/menu/menu_EntrySnapshot.hpp>
 #include <ul/menu/menu_Cache.hpp>
 #include <ul/acc/acc_Accounts.hpp>
 #include <ul/os/os_Applications.hpp>
@@ -12,6 +13,7 @@
 #include <ul/util/util_Size.hpp>
 #include <ul/fs/fs_Stdio.hpp>
 #include <queue>
+#include <atomic>
 
 extern "C" {
 
@@ -40,6 +42,16 @@ using namespace ul::system;
 
 ul::RecursiveMutex g_MenuMessageQueueLock;
 std::queue<ul::smi::MenuMessageContext> *g_MenuMessageQueue;
+SharedMemory g_MenuEntrySnapshotSharedMemory;
+
+// The config is owned by us: uMenu sends single entry changes, which get saved (coalesced) from the main loop
+ul::Mutex g_ConfigLock;
+ul::cfg::Config g_Config;
+// Increased on every change, so that uMenu can check whether its copy is outdated
+u32 g_ConfigGeneration = 0;
+// System ticks of the first/last unsaved changes (zero if there are none)
+u64 g_ConfigChangeStartTick = 0;
+u64 g_ConfigChangeLastTick = 0;
 
 namespace {
 
@@ -81,7 +93,11 @@ namespace {
     bool g_LoaderOpenedAsApplication = false;
     bool g_AppletActive = false;
     AppletOperationMode g_OperationMode;
-    ul::cfg::Config g_Config;
+
+    // Changes are saved once none came for a while, but never later than the max delay
+    constexpr u64 ConfigSaveDelayNs = 1'000'000'000ul;
+    constexpr u64 ConfigSaveMaxDelayNs = 5'000'000'000ul;
+    u32 g_AppliedConfigGeneration = 0;
 
     char g_CurrentMenuFsPath[FS_MAX_PATH] = {};
     char g_CurrentMenuPath[FS_MAX_PATH] = {};
@@ -90,6 +106,17 @@ namespace {
     alignas(ams::os::MemoryPageSize) constinit u8 g_EventManagerThreadStack[16_KB];
     Thread g_EventManagerThread;
 
+    // Only uMenu is shown (no application, not even suspended), thus background work (like cache verification) may run
+    std::atomic_bool g_ConsoleIdle = false;
+
+    // Cache verification goes one entry per step, only once the console has been idle for a while, with passes spaced out
+    constexpr u64 CacheVerifierStepIntervalNs = 500'000'000ul;
+    constexpr u64 CacheVerifierIdleDelayNs = 30'000'000'000ul;
+    constexpr u64 CacheVerifierPassIntervalNs = 30 * 60 * 1'000'000'000ul;
+
+    alignas(ams::os::MemoryPageSize) constinit u8 g_CacheVerifierThreadStack[16_KB];
+    Thread g_CacheVerifierThread;
+
     enum class UsbMode : u32 {
         Invalid,
         Rgba,
@@ -131,12 +158,63 @@ namespace {
 
 namespace {
 
+    template<ul::cfg::ConfigEntryId Id>
+    inline ul::cfg::ConfigEntryValueType<Id> GetConfigEntry() {
+        ul::ScopedLock lk(g_ConfigLock);
+        return g_Config.GetEntry<Id>();
+    }
+
+    void ApplyConfig() {
+        la::SetMenuProgramId(GetConfigEntry<ul::cfg::ConfigEntryId::MenuTakeoverProgramId>());
+    }
+
     void LoadConfig() {
-        g_Config = ul::cfg::LoadConfig();
+        {
+            ul::ScopedLock lk(g_ConfigLock);
+            g_Config = ul::cfg::LoadConfig();
+            g_ConfigGeneration++;
+            g_AppliedConfigGeneration = g_ConfigGeneration;
+        }
+
+        ApplyConfig();
+    }
+
+    void SaveConfigChanges(const bool force) {
+        ul::cfg::Config cfg;
+        {
+            ul::ScopedLock lk(g_ConfigLock);
+            if(g_ConfigChangeStartTick == 0) {
+                return;
+            }
+
+            if(!force) {
+                const auto cur_tick = armGetSystemTick();
+                if((armTicksToNs(cur_tick - g_ConfigChangeLastTick) < ConfigSaveDelayNs) && (armTicksToNs(cur_tick - g_ConfigChangeStartTick) < ConfigSaveMaxDelayNs)) {
+                    return;
+                }
+            }
+
+            cfg = g_Config;
+            g_ConfigChangeStartTick = 0;
+            g_ConfigChangeLastTick = 0;
+        }
+
+        // Saved outside the lock, IPC shouldn't wait for the SD card
+        ul::cfg::SaveConfig(cfg);
+    }
+
+    void HandleConfigChanges() {
+        bool changed;
+        {
+            ul::ScopedLock lk(g_ConfigLock);
+            changed = g_ConfigGeneration != g_AppliedConfigGeneration;
+            g_AppliedConfigGeneration = g_ConfigGeneration;
+        }
+        if(changed) {
+            ApplyConfig();
+        }
 
-        u64 menu_program_id;
-        UL_ASSERT_TRUE(g_Config.GetEntry(ul::cfg::ConfigEntryId::MenuTakeoverProgramId, menu_program_id));
-        la::SetMenuProgramId(menu_program_id);
+        SaveConfigChanges(false);
     }
 
     inline void PushMenuMessageContext(const ul::smi::MenuMessageContext msg_ctx) {
@@ -152,6 +230,12 @@ namespace {
         g_MenuMessageQueue->push(msg_ctx);
     }
 
+    void PublishMenuEntrySnapshot() {
+        if(!ul::menu::WriteEntryTreeSnapshot(shmemGetAddr(&g_MenuEntrySnapshotSharedMemory), g_MenuEntrySnapshotSharedMemory.size)) {
+            UL_LOG_WARN("Menu entry snapshot doesn't fit in shared memory, uMenu will load entries from the SD card...");
+        }
+    }
+
     ul::smi::SystemStatus CreateStatus() {
         ul::smi::SystemStatus status = {
             .selected_user = g_SelectedUser,
@@ -242,10 +326,12 @@ namespace {
                         break;
                     }
                     case GeneralChannelMessage::Unk_Shutdown: {
+                        SaveConfigChanges(true);
                         UL_RC_ASSERT(appletStartShutdownSequence());
                         break;
                     }
                     case GeneralChannelMessage::Unk_Reboot: {
+                        SaveConfigChanges(true);
                         UL_RC_ASSERT(appletStartRebootSequence());
                         break;
                     }
@@ -430,8 +516,7 @@ namespace {
                                 return ul::ResultAlreadyQueued;
                             }
 
-                            u64 hb_application_takeover_program_id;
-                            UL_ASSERT_TRUE(g_Config.GetEntry(ul::cfg::ConfigEntryId::HomebrewApplicationTakeoverApplicationId, hb_application_takeover_program_id));
+                            const auto hb_application_takeover_program_id = GetConfigEntry<ul::cfg::ConfigEntryId::HomebrewApplicationTakeoverApplicationId>();
                             if(hb_application_takeover_program_id == 0) {
                                 return ul::ResultNoHomebrewTakeoverApplication;
                             }
@@ -465,6 +550,8 @@ namespace {
                             break;
                         }
                         case ul::smi::SystemMessage::ReloadConfig: {
+                            // Don't lose changes not saved yet
+                            SaveConfigChanges(true);
                             LoadConfig();
                             break;
                         }
@@ -486,6 +573,29 @@ namespace {
                             g_CurrentMenuIndex = menu_index;
                             break;
                         }
+                        case ul::smi::SystemMessage::ReloadMenuEntries: {
+                            u32 folder_path_count;
+                            UL_RC_TRY(reader.Pop(folder_path_count));
+
+                            if(folder_path_count == 0) {
+                                ul::menu::LoadEntryTree();
+                            }
+                            else {
+                                std::vector<std::string> folder_paths;
+                                for(u32 i = 0; i < folder_path_count; i++) {
+                                    u32 folder_path_len;
+                                    UL_RC_TRY(reader.Pop(folder_path_len));
+
+                                    std::string folder_path(folder_path_len, '\0');
+                                    UL_RC_TRY(reader.PopData(folder_path.data(), folder_path_len));
+                                    folder_paths.push_back(std::move(folder_path));
+                                }
+                                ul::menu::ReloadEntryTreeFolders(folder_paths);
+                            }
+
+                            PublishMenuEntrySnapshot();
+                            break;
+                        }
                         case ul::smi::SystemMessage::OpenUserPage: {
                             g_UserPageAppletLaunchFlag = true;
                             break;
@@ -706,8 +816,7 @@ namespace {
         }
         if(g_LoaderLaunchFlag.magic == ul::loader::TargetInput::Magic) {
             if(!la::IsActive()) {
-                u64 hb_applet_takeover_program_id;
-                UL_ASSERT_TRUE(g_Config.GetEntry(ul::cfg::ConfigEntryId::HomebrewAppletTakeoverProgramId, hb_applet_takeover_program_id));
+                const auto hb_applet_takeover_program_id = GetConfigEntry<ul::cfg::ConfigEntryId::HomebrewAppletTakeoverProgramId>();
 
                 // TODO (new): consider not asserting and sending the error result to menu instead? same for various other asserts in this code...
                 UL_RC_ASSERT(ecs::RegisterLaunchAsApplet(hb_applet_takeover_program_id, 0, "/ulaunch/bin/uLoader/applet", &g_LoaderLaunchFlag, sizeof(g_LoaderLaunchFlag)));
@@ -718,8 +827,7 @@ namespace {
         }
         if(!la::IsActive()) {
             const auto cur_id = la::GetLastAppletId();
-            u64 hb_applet_takeover_program_id;
-            UL_ASSERT_TRUE(g_Config.GetEntry(ul::cfg::ConfigEntryId::HomebrewAppletTakeoverProgramId, hb_applet_takeover_program_id));
+            const auto hb_applet_takeover_program_id = GetConfigEntry<ul::cfg::ConfigEntryId::HomebrewAppletTakeoverProgramId>();
             if(IsUsedLibraryApplet(cur_id) || (cur_id == la::GetAppletIdForProgramId(hb_applet_takeover_program_id))) {
                 // A user may have been created...
                 if(cur_id == AppletId_LibraryAppletPlayerSelect) {
@@ -776,6 +884,10 @@ namespace {
             }
         }
 
+        g_ConsoleIdle = la::IsMenu() && !app::IsActive();
+
+        HandleConfigChanges();
+
         svcSleepThread(10'000'000ul);
     }
 
@@ -839,12 +951,13 @@ namespace {
                     UL_LOG_INFO("Application records changed! diff:");
 
                     const auto diff_records = ListChangedRecords();
+                    // This also recaches updated applications, which aren't part of the diff
+                    const auto cached_app_ids = ul::menu::CacheApplications(g_CurrentRecords);
                     for(const auto &record: diff_records) {
                         if(std::find_if(g_CurrentRecords.begin(), g_CurrentRecords.end(), [&](const NsApplicationRecord &rec) -> bool {
                             return rec.application_id == record.application_id;
                         }) != g_CurrentRecords.end()) {
                             UL_LOG_INFO("- [new] 0x%lX", record.application_id);
-                            ul::menu::CacheSingleApplication(record.application_id);
                             ul::menu::EnsureApplicationEntry(record);
                         }
                         else {
@@ -852,6 +965,12 @@ namespace {
                             ul::menu::DeleteApplicationEntry(record.application_id, ul::MenuPath);
                         }
                     }
+
+                    // uMenu refreshes cached icons/strings along with the snapshot, which entry changes alone don't republish (updates, already present entries)
+                    if(!cached_app_ids.empty()) {
+                        ul::menu::RefreshEntrySearchIndex();
+                        PublishMenuEntrySnapshot();
+                    }
                 }
                 if(ev_idx == 1) {
                     eventClear(&gc_mount_fail_event);
@@ -873,6 +992,45 @@ namespace {
         }
     }
 
+    void CacheVerifierMain(void*) {
+        u64 idle_start_tick = 0;
+        u64 last_pass_end_tick = 0;
+        while(true) {
+            svcSleepThread(CacheVerifierStepIntervalNs);
+
+            if(!g_ConsoleIdle) {
+                idle_start_tick = 0;
+                continue;
+            }
+            const auto cur_tick = armGetSystemTick();
+            if(idle_start_tick == 0) {
+                idle_start_tick = cur_tick;
+            }
+            if(armTicksToNs(cur_tick - idle_start_tick) < CacheVerifierIdleDelayNs) {
+                continue;
+            }
+            if((last_pass_end_tick != 0) && (armTicksToNs(cur_tick - last_pass_end_tick) < CacheVerifierPassIntervalNs)) {
+                continue;
+            }
+
+            switch(ul::menu::VerifyNextCacheEntry()) {
+                case ul::menu::CacheVerifyResult::Repaired:
+                case ul::menu::CacheVerifyResult::Dropped: {
+                    // uMenu refreshes cached icons/strings along with the snapshot
+                    ul::menu::RefreshEntrySearchIndex();
+                    PublishMenuEntrySnapshot();
+                    break;
+                }
+                case ul::menu::CacheVerifyResult::PassFinished: {
+                    last_pass_end_tick = cur_tick;
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+    }
+
     inline size_t CaptureJpegScreenshot() {
         u64 size;
         const auto rc = capsscCaptureJpegScreenShot(&size, g_UsbViewerBufferDataOffset, PlainRgbaScreenBufferSize, ViLayerStack_Default, UINT64_MAX);
@@ -922,25 +1080,59 @@ namespace {
         ul::fs::DeleteDirectory(ul::OldHomebrewCachePath);
         ul::fs::DeleteDirectory(ul::OldAccountCachePath);
 
-        ul::fs::CleanDirectory(ul::RootCachePath);
+        // Application/homebrew caches are kept across boots (see menu_Cache.hpp) and verified in the background, the active theme cache and the theme catalog are kept and just updated by uMenu (see cfg_Config.hpp), the rest of the cache is started over
+        ul::fs::CreateDirectory(ul::RootCachePath);
+        std::vector<std::string> old_cache_paths;
+        UL_FS_FOR(ul::RootCachePath, cache_name, cache_path, is_dir, is_file, {
+            if((cache_path != ul::ApplicationCachePath) && (cache_path != ul::HomebrewCachePath) && (cache_path != ul::menu::MakeCacheBudgetStatsPath()) && (cache_path != ul::ActiveThemeCachePath) && (cache_path != ul::ThemePreviewCachePath)) {
+                old_cache_paths.push_back(cache_path);
+            }
+        });
+        for(const auto &old_cache_path: old_cache_paths) {
+            if(ul::fs::ExistsDirectory(old_cache_path)) {
+                ul::fs::DeleteDirectory(old_cache_path);
+            }
+            else {
+                ul::fs::DeleteFile(old_cache_path);
+            }
+        }
 
         ul::util::CopyToStringBuffer(g_CurrentMenuFsPath, ul::MenuPath);
 
+        // Config is needed from here on (cache worker count, cache budget)
+        LoadConfig();
+
         CacheAccounts();
 
+        ul::menu::SetCacheWorkerCount(GetConfigEntry<ul::cfg::ConfigEntryId::CacheWorkerCount>());
+        ul::menu::SetCacheBudgetSize(GetConfigEntry<ul::cfg::ConfigEntryId::CacheBudgetSize>());
+
         g_CurrentRecords = ul::os::ListApplicationRecords();
         ul::menu::CacheApplications(g_CurrentRecords);
         ul::menu::CacheHomebrew();
 
-        LoadConfig();
+        // The menu is loaded once here, and kept in memory (and shared with uMenu) from now on
+        ul::menu::InitializeEntries();
+        ul::menu::LoadEntryTree();
+        // Only now it's known which homebrew the menu references
+        ul::menu::EnforceCacheBudget(ul::menu::ListEntryTreeHomebrewPaths());
+        UL_RC_ASSERT(shmemCreate(&g_MenuEntrySnapshotSharedMemory, ul::menu::EntrySnapshotSharedMemorySize, Perm_Rw, Perm_R));
+        UL_RC_ASSERT(shmemMap(&g_MenuEntrySnapshotSharedMemory));
+        PublishMenuEntrySnapshot();
+        ul::menu::SetOnEntriesChanged([](const std::vector<std::string>&) {
+            PublishMenuEntrySnapshot();
+        });
 
         UL_RC_ASSERT(sf::Initialize());
 
         UL_RC_ASSERT(threadCreate(&g_EventManagerThread, EventManagerMain, nullptr, g_EventManagerThreadStack, sizeof(g_EventManagerThreadStack), 0x2C, -2));
         UL_RC_ASSERT(threadStart(&g_EventManagerThread));
 
-        bool viewer_usb_enabled;
-        UL_ASSERT_TRUE(g_Config.GetEntry(ul::cfg::ConfigEntryId::ViewerUsbEnabled, viewer_usb_enabled));
+        // Least urgent priority uSystem is allowed to use (see uSystem.json)
+        UL_RC_ASSERT(threadCreate(&g_CacheVerifierThread, CacheVerifierMain, nullptr, g_CacheVerifierThreadStack, sizeof(g_CacheVerifierThreadStack), 0x3B, -2));
+        UL_RC_ASSERT(threadStart(&g_CacheVerifierThread));
+
+        const auto viewer_usb_enabled = GetConfigEntry<ul::cfg::ConfigEntryId::ViewerUsbEnabled>();
 
         if(viewer_usb_enabled) {
             UL_RC_ASSERT(usbCommsInitialize());
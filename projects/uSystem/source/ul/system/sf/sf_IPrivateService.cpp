@@ -4,6 +4,12 @@
 
 extern ul::RecursiveMutex g_MenuMessageQueueLock;
 extern std::queue<ul::smi::MenuMessageContext> *g_MenuMessageQueue;
+extern SharedMemory g_MenuEntrySnapshotSharedMemory;
+extern ul::Mutex g_ConfigLock;
+extern ul::cfg::Config g_Config;
+extern u32 g_ConfigGeneration;
+extern u64 g_ConfigChangeStartTick;
+extern u64 g_ConfigChangeLastTick;
 
 namespace ul::system::sf {
 
@@ -44,4 +50,66 @@ namespace ul::system::sf {
         }
     }
 
+    ::ams::Result PrivateService::GetMenuEntrySnapshot(::ams::sf::OutCopyHandle out_shmem_h, ::ams::sf::Out<u64> out_shmem_size) {
+        if(!this->initialized) {
+            return ResultInvalidProcess;
+        }
+
+        // Menu only gets read-only access (see shared memory creation)
+        out_shmem_h.SetValue(shmemGetHandle(&g_MenuEntrySnapshotSharedMemory), false);
+        out_shmem_size.SetValue(g_MenuEntrySnapshotSharedMemory.size);
+        return ResultSuccess;
+    }
+
+    ::ams::Result PrivateService::GetConfig(const ::ams::sf::OutBuffer &out_cfg_buf, ::ams::sf::Out<u32> out_generation) {
+        if(!this->initialized) {
+            return ResultInvalidProcess;
+        }
+
+        std::vector<u8> cfg_data;
+        {
+            ScopedLock lk(g_ConfigLock);
+            cfg::SerializeConfig(g_Config, cfg_data);
+            out_generation.SetValue(g_ConfigGeneration);
+        }
+
+        if(cfg_data.size() > out_cfg_buf.GetSize()) {
+            return ResultInvalidConfigBufferSize;
+        }
+        memcpy(out_cfg_buf.GetPointer(), cfg_data.data(), cfg_data.size());
+        return ResultSuccess;
+    }
+
+    ::ams::Result PrivateService::SetConfigEntry(const ConfigEntryDelta &delta, ::ams::sf::Out<u32> out_generation) {
+        if(!this->initialized) {
+            return ResultInvalidProcess;
+        }
+
+        ScopedLock lk(g_ConfigLock);
+        if(!cfg::ApplyConfigEntryDelta(g_Config, delta.actual_delta)) {
+            return ResultInvalidConfigEntry;
+        }
+
+        // Saved later (see the main loop), so that several quick changes end up in a single save
+        const auto cur_tick = armGetSystemTick();
+        if(g_ConfigChangeStartTick == 0) {
+            g_ConfigChangeStartTick = cur_tick;
+        }
+        g_ConfigChangeLastTick = cur_tick;
+
+        g_ConfigGeneration++;
+        out_generation.SetValue(g_ConfigGeneration);
+        return ResultSuccess;
+    }
+
+    ::ams::Result PrivateService::GetConfigGeneration(::ams::sf::Out<u32> out_generation) {
+        if(!this->initialized) {
+            return ResultInvalidProcess;
+        }
+
+        ScopedLock lk(g_ConfigLock);
+        out_generation.SetValue(g_ConfigGeneration);
+        return ResultSuccess;
+    }
+
 }